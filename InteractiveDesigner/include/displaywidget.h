@@ -4,6 +4,9 @@
 #include <QWidget>
 #include <QLabel>
 #include <QScrollArea>
+#include <QCache>
+#include <QList>
+#include <QPoint>
 
 class DisplayWidget : public QWidget
 {
@@ -12,21 +15,91 @@ class DisplayWidget : public QWidget
 public:
 	explicit DisplayWidget(QWidget *parent = nullptr);
 
+signals:
+	/**
+	 * \brief Emitted in viewport mode when visible tiles are not rendered yet
+	 * \param zoom Zoom level of the tiles, at least 1 since level 0 is the image
+	 * \param tiles Coordinates of the tiles in the grid of tiles of the zoom level
+	 */
+	void tilesNeeded(int zoom, const QList<QPoint>& tiles);
+
 public slots:
 	void setImage(const QImage &newImage);
+
+	/**
+	 * \brief Replace the image by a more complete version of it, for example during rendering.
+	 * Zoom and position are kept if the size of the image does not change.
+	 */
+	void updateImage(const QImage &newImage);
+
+	/**
+	 * \brief Discard the tiles of viewport mode and request the visible ones again, for example when the noise changed.
+	 */
+	void invalidateTiles();
 	void normalSize();
 	void fitToWindow(bool fitToWindow);
 	void zoomIn();
 	void zoomOut();
 
+	/**
+	 * \brief In viewport mode, the visible region of the image is rendered at screen resolution in tiles,
+	 * zooming renders more details instead of scaling the pixels of the image.
+	 * \param viewportMode True to enable the viewport mode
+	 */
+	void setViewportMode(bool viewportMode);
+
+	/**
+	 * \brief Add rendered tiles to the tiles displayed in viewport mode
+	 */
+	void setTiles(int zoom, const QList<QPoint>& tiles, const QList<QImage>& images);
+
+protected:
+	void paintEvent(QPaintEvent* event) override;
+	void resizeEvent(QResizeEvent* event) override;
+	void mousePressEvent(QMouseEvent* event) override;
+	void mouseMoveEvent(QMouseEvent* event) override;
+	void wheelEvent(QWheelEvent* event) override;
+
 private:
 	void scaleImage(double factor);
 	void adjustScrollBar(QScrollBar *scrollBar, double factor) const;
 
+	/**
+	 * \brief Change the zoom level in viewport mode, the point under position stays in place
+	 */
+	void SetZoom(int zoom, const QPoint& position);
+
+	/**
+	 * \brief Size of the image at the current zoom level
+	 */
+	QSize ZoomedSize() const;
+
+	/**
+	 * \brief Range of tiles covering the widget at the current zoom level
+	 */
+	QRect VisibleTiles() const;
+
+	/**
+	 * \brief Request the visible tiles that are not rendered yet
+	 */
+	void RequestTiles();
+
+	static quint64 TileKey(int zoom, int x, int y);
+
+	static constexpr int MAXIMUM_ZOOM = 8;
+
 	QImage m_image;
 	QLabel* m_imageLabel;
 	QScrollArea* m_scrollArea;
 	double m_scaleFactor;
+
+	bool m_viewportMode;
+	int m_zoom;
+	// Position of the top left corner of the widget in the image at the current zoom level
+	QPoint m_offset;
+	QPoint m_lastMousePosition;
+	// Tiles of all zoom levels but 0, the least recently used ones are removed first
+	QCache<quint64, QImage> m_tiles;
 };
 
 #endif // DISPLAYWIDGET_H
\ No newline at end of file
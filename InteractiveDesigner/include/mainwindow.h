@@ -3,6 +3,8 @@
 
 #include <QtWidgets/QMainWindow>
 #include <QtWidgets/QProgressDialog>
+#include <QPointer>
+#include <QTimer>
 
 #include "parameterdock.h"
 #include "noiserenderer.h"
@@ -21,20 +23,47 @@ public:
 
 private slots:
 	void StartRendering();
+	void RenderingUpdated();
 	void RenderingFinished();
+
+	/**
+	 * \brief Called when a cancelled rendering is stopped and not restarted
+	 */
+	void RenderingCancelled();
 	void Save();
 
+	/**
+	 * \brief Enable or disable the live preview, the image is rendered again each time a parameter changes
+	 */
+	void SetLivePreview(bool livePreview);
+	void ParametersChanged();
+	void LiveRender();
+
 private:
 	void SetupUi();
 	void CreateActions();
 
 	static const NoiseParameters default_noise_parameters;
 
+	/**
+	 * \brief Time in ms without parameter change before the live preview starts rendering
+	 */
+	static constexpr int LIVE_PREVIEW_DELAY = 200;
+
+	/**
+	 * \brief Time in ms during which a message is shown in the status bar
+	 */
+	static constexpr int STATUS_MESSAGE_TIMEOUT = 3000;
+
 	Ui::MainWindowClass* ui;
 
 	ParameterDock* m_parameterDock;
 
-	QProgressDialog* m_progressDialog;
+	// The dialog deletes itself when closed
+	QPointer<QProgressDialog> m_progressDialog;
+
+	bool m_livePreview;
+	QTimer* m_liveTimer;
 
 	NoiseRenderer* m_noiseRenderer;
 };
@@ -2,9 +2,17 @@
 #define NOISERENDERER_H
 
 #include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
 
 #include <QObject>
 #include <QImage>
+#include <QList>
+#include <QPoint>
+#include <QSize>
+#include <QRect>
+#include <QTimer>
 #include <QtConcurrent>
 
 #include <opencv2/core/core.hpp>
@@ -12,6 +20,12 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include "noiseparameters.h"
+#include "tilequeue.h"
+
+template <typename I>
+class Noise;
+class PerlinControlFunction;
+class LichtenbergControlFunction;
 
 class NoiseRenderer : public QObject
 {
@@ -27,7 +41,7 @@ public:
 	void setParameters(const NoiseParameters& parameters);
 
 	/**
-	 * \brief Return the rendered image as a QImage
+	 * \brief Return the rendered image as a QImage, during the rendering only the finished tiles are drawn
 	 * \return The rendered image
 	 */
 	QImage resultQImage() const;
@@ -40,9 +54,48 @@ public:
 
 	/**
 	 * \brief Start the rendering of the image
+	 * \param preview True to first render a coarse preview of the whole image, then refine it
 	 * \return True if the rendering successfully started, false otherwise
 	 */
-	bool start();
+	bool start(bool preview = false);
+
+	/**
+	 * \brief Cancel the rendering, render threads stop at the next tile and finished is not emitted
+	 */
+	void cancel();
+
+	/**
+	 * \brief Cancel the rendering if it is running, then render the image again with a preview.
+	 * The new rendering starts as soon as render threads are stopped.
+	 */
+	void restart();
+
+	/**
+	 * \brief Check whether the image is being rendered
+	 */
+	bool isRunning() const;
+
+	/**
+	 * \brief Size in pixels of the square tiles rendered by renderTiles
+	 */
+	static constexpr int TILE_SIZE = 256;
+
+	/**
+	 * \brief Render tiles of the last rendered image in the background, at any zoom level.
+	 * At zoom 0, pixels of tiles are the pixels of the rendered image, each zoom level halves their size.
+	 * Tiles are remapped to gray with the range of the rendered image so that they match it.
+	 * If tiles are already being rendered, the request replaces the previous waiting one.
+	 * \param zoom Zoom level of the tiles
+	 * \param tiles Coordinates of the tiles in the grid of tiles of the zoom level
+	 */
+	void renderTiles(int zoom, const QList<QPoint>& tiles);
+
+	/**
+	 * \brief Size in pixels of the rendered image at a zoom level
+	 * \param zoom Zoom level
+	 * \return The size of the image, empty if no image has been rendered
+	 */
+	QSize zoomedSize(int zoom) const;
 
 signals:
 	/**
@@ -50,12 +103,37 @@ signals:
 	 */
 	void finished();
 
+	/**
+	 * \brief Emitted during the computation when new tiles of the image are finished
+	 */
+	void imageUpdated();
+
+	/**
+	 * \brief Emitted when a cancelled computation is stopped, unless it is restarted
+	 */
+	void cancelled();
+
+	/**
+	 * \brief Emitted when tiles requested by renderTiles are rendered
+	 */
+	void tilesRendered(int zoom, const QList<QPoint>& tiles, const QList<QImage>& images);
+
 private slots:
 	/**
 	 * \brief Called when rendering is finished
 	 */
 	void OnRenderingFinished();
 
+	/**
+	 * \brief Called regularly during rendering to draw the finished tiles
+	 */
+	void OnStreamTimeout();
+
+	/**
+	 * \brief Called when rendering of tiles is finished
+	 */
+	void OnTilesFinished();
+
 private:
 
 	/**
@@ -91,25 +169,168 @@ private:
 		}
 	};
 
+	/**
+	 * \brief An image being rendered, shared by the render threads and the GUI thread.
+	 * Each tile of the result is written by a single render thread, then pushed in the queue of finished tiles.
+	 * With a preview, all tiles are first rendered with one sample per block of pixels in the preview,
+	 * and pushed in the queue with their index plus the number of tiles. Then they are rendered in the result.
+	 */
+	struct RenderJob
+	{
+		NoiseParameters parameters;
+		VectorDouble2D result;
+		// One sample every previewStep pixels, empty without preview
+		VectorDouble2D preview;
+		int previewStep;
+		int tilesX;
+		int tilesY;
+		TileQueue finishedTiles;
+		// Checked by render threads before each tile
+		std::atomic<bool> cancelled;
+
+		RenderJob(const NoiseParameters& p, bool withPreview);
+
+		int tiles() const;
+
+		QRect tileRect(int tile) const;
+	};
+
+	typedef Noise<PerlinControlFunction> TerrainNoise;
+	typedef Noise<LichtenbergControlFunction> LichtenbergNoise;
+
+	/**
+	 * \brief Tiles rendered in the background, from the image of a generation
+	 */
+	struct TileBatch
+	{
+		int generation = 0;
+		int zoom = 0;
+		QList<QPoint> tiles;
+		QList<QImage> images;
+	};
+
 	void ConfigureFutureWatcher();
 
 	/**
-	 * \brief Render the terrain noise in a QImage.
-	 * \return An image of the noise.
+	 * \brief Return the function evaluating the noise defined by parameters, built from the engines
 	 */
-	VectorDouble2D RenderTerrain() const;
+	std::function<double(double, double)> Evaluator(const NoiseParameters& parameters);
 
 	/**
-	 * \brief Render the Lichtenberg noise in a QImage.
-	 * \return An image of the noise.
+	 * \brief Start the rendering of the waiting tiles
 	 */
-	VectorDouble2D RenderLichtenberg() const;
+	void StartTiles();
 
-	QFutureWatcher<VectorDouble2D>* m_futureImageWatcher;
+	/**
+	 * \brief Render tiles of an image in gray levels
+	 * \param evaluate Function evaluating the noise
+	 * \param generation Generation of the image the tiles belong to
+	 * \param parameters The parameters of the image at zoom 0
+	 * \param minimum Value remapped to black
+	 * \param maximum Value remapped to white
+	 * \param zoom Zoom level of the tiles
+	 * \param tiles Coordinates of the tiles
+	 * \return The rendered tiles.
+	 */
+	static TileBatch RenderTiles(std::function<double(double, double)> evaluate, int generation, const NoiseParameters& parameters, double minimum, double maximum, int zoom, const QList<QPoint>& tiles);
+
+	/**
+	 * \brief Check whether two sets of parameters define the same noise function.
+	 * The resolution of the image is not part of the function.
+	 */
+	static bool SameFunction(const NoiseParameters& a, const NoiseParameters& b);
+
+	/**
+	 * \brief Return the terrain noise for parameters, reuse the previous one if the function did not change.
+	 */
+	std::shared_ptr<const TerrainNoise> TerrainEngine(const NoiseParameters& parameters);
+
+	/**
+	 * \brief Return the Lichtenberg noise for parameters, reuse the previous one if the function did not change.
+	 */
+	std::shared_ptr<const LichtenbergNoise> LichtenbergEngine(const NoiseParameters& parameters);
+
+	/**
+	 * \brief Render the noise tile by tile.
+	 * \param evaluate Function evaluating the noise
+	 * \param job The image to render
+	 */
+	static void RenderImage(std::function<double(double, double)> evaluate, std::shared_ptr<RenderJob> job);
+
+	/**
+	 * \brief Remap values to gray levels in a rectangle of an image
+	 * \param values Values of the image, one value every step pixels
+	 * \param rect Rectangle of the image
+	 * \param minimum Value remapped to black
+	 * \param maximum Value remapped to white
+	 * \param image Gray level image
+	 * \param step Number of pixels sharing the same value in each direction
+	 */
+	static void ConvertRect(const VectorDouble2D& values, const QRect& rect, double minimum, double maximum, QImage& image, int step = 1);
+
+	/**
+	 * \brief Draw a tile popped from the queue of finished tiles of the job in the back image
+	 */
+	void DrawStreamedTile(int index);
+
+	/**
+	 * \brief Size in pixels of the square tiles streamed during the rendering of the image
+	 */
+	static constexpr int STREAM_TILE_SIZE = 64;
+
+	/**
+	 * \brief Time in ms between two updates of the image during the rendering
+	 */
+	static constexpr int STREAM_INTERVAL = 50;
+
+	/**
+	 * \brief Size in pixels of the blocks of the preview, a divisor of STREAM_TILE_SIZE
+	 */
+	static constexpr int PREVIEW_STEP = 4;
+
+	QFutureWatcher<void>* m_futureImageWatcher;
 
 	NoiseParameters m_parameters;
 
+	// Noises kept between renderings with the parameters they were built with,
+	// a rendering running in the background keeps its noise alive
+	std::shared_ptr<const TerrainNoise> m_terrainNoise;
+	NoiseParameters m_terrainNoiseParameters;
+	std::shared_ptr<const LichtenbergNoise> m_lichtenbergNoise;
+	NoiseParameters m_lichtenbergNoiseParameters;
+
+	// Image being rendered
+	std::shared_ptr<RenderJob> m_job;
+	QTimer* m_streamTimer;
+	// Range of the values of the tiles finished so far
+	double m_streamMinimum;
+	double m_streamMaximum;
+
+	// Images are double buffered: tiles are drawn in the back image while the front one is displayed.
+	// After a swap, tiles drawn in the previous back image are still missing from the new back image,
+	// they are stored as indices in the queue of finished tiles.
+	QImage m_frontImage;
+	QImage m_backImage;
+	QList<int> m_backMissingTiles;
+	// Whether the rendering should start again when the cancelled one is stopped
+	bool m_restartPending;
+
 	VectorDouble2D m_result;
+	// Parameters and range of values of the rendered image
+	NoiseParameters m_resultParameters;
+	double m_resultMinimum;
+	double m_resultMaximum;
+
+	QFutureWatcher<TileBatch>* m_futureTilesWatcher;
+	// Incremented each time the rendered image changes, tiles rendered from a previous image are dropped
+	int m_tileGeneration;
+	// Tiles waiting for the rendering of the previous ones
+	int m_waitingZoom;
+	QList<QPoint> m_waitingTiles;
+	// Tiles being rendered
+	int m_renderingGeneration;
+	int m_renderingZoom;
+	QList<QPoint> m_renderingTiles;
 };
 
 #endif // NOISERENDERER_H
\ No newline at end of file
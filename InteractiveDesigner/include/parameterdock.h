@@ -29,6 +29,12 @@ public:
 	 */
 	NoiseParameters parameters() const;
 
+signals:
+	/**
+	 * \brief Emitted when the user edits any parameter
+	 */
+	void parametersChanged();
+
 private:
 	Ui::ParameterDock* ui;
 };
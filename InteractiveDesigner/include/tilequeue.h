@@ -0,0 +1,70 @@
+#ifndef TILEQUEUE_H
+#define TILEQUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cassert>
+
+/**
+ * \brief Queue of the indices of finished tiles, filled by the render threads and emptied by the GUI thread.
+ * Each tile is pushed at most once, so the queue never wraps around and needs no lock:
+ * a thread reserves a slot with an atomic counter, fills it, then publishes it with a flag.
+ */
+class TileQueue
+{
+public:
+	/**
+	 * \brief Create an empty queue
+	 * \param capacity Number of tiles that can be pushed
+	 */
+	explicit TileQueue(int capacity) :
+		m_tiles(capacity),
+		m_published(new std::atomic<bool>[capacity]),
+		m_reserved(0),
+		m_consumed(0)
+	{
+		for (int i = 0; i < capacity; i++)
+		{
+			m_published[i].store(false, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * \brief Push a finished tile, can be called by several threads at the same time
+	 */
+	void push(int tile)
+	{
+		const int slot = m_reserved.fetch_add(1, std::memory_order_relaxed);
+		assert(slot < int(m_tiles.size()));
+
+		m_tiles[slot] = tile;
+		m_published[slot].store(true, std::memory_order_release);
+	}
+
+	/**
+	 * \brief Pop the next finished tile, can only be called by one thread
+	 * \param tile The finished tile
+	 * \return False if no tile is finished since the last call
+	 */
+	bool pop(int& tile)
+	{
+		if (m_consumed >= int(m_tiles.size()) || !m_published[m_consumed].load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		tile = m_tiles[m_consumed];
+		m_consumed++;
+
+		return true;
+	}
+
+private:
+	std::vector<int> m_tiles;
+	std::unique_ptr<std::atomic<bool>[]> m_published;
+	std::atomic<int> m_reserved;
+	int m_consumed;
+};
+
+#endif // TILEQUEUE_H
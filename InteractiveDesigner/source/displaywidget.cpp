@@ -1,15 +1,34 @@
 #include "displaywidget.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 #include <QPainter>
 #include <QPaintEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
 #include <QVBoxLayout>
 #include <QScrollBar>
 
+#include "noiserenderer.h"
+
+namespace
+{
+	const int TILE_SIZE = NoiseRenderer::TILE_SIZE;
+
+	// Number of tiles kept in memory, 64 KB each
+	const int MAXIMUM_TILES = 1024;
+}
+
 DisplayWidget::DisplayWidget(QWidget *parent)
 	: QWidget(parent),
 	m_imageLabel(new QLabel),
 	m_scrollArea(new QScrollArea),
-	m_scaleFactor(1.0)
+	m_scaleFactor(1.0),
+	m_viewportMode(false),
+	m_zoom(0),
+	m_tiles(MAXIMUM_TILES)
 {
 	m_imageLabel->setBackgroundRole(QPalette::Base);
 	m_imageLabel->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
@@ -30,8 +49,37 @@ void DisplayWidget::setImage(const QImage& newImage)
 	m_imageLabel->setPixmap(QPixmap::fromImage(m_image));
 	m_scaleFactor = 1.0;
 
-	m_scrollArea->setVisible(true);
+	m_scrollArea->setVisible(!m_viewportMode);
 	m_imageLabel->adjustSize();
+
+	// Tiles of the previous image are discarded
+	m_tiles.clear();
+
+	RequestTiles();
+	update();
+}
+
+void DisplayWidget::updateImage(const QImage& newImage)
+{
+	if (m_image.isNull() || newImage.size() != m_image.size())
+	{
+		setImage(newImage);
+		return;
+	}
+
+	// The label scales its content, so its size and the scroll bars do not change
+	m_image = newImage;
+	m_imageLabel->setPixmap(QPixmap::fromImage(m_image));
+
+	update();
+}
+
+void DisplayWidget::invalidateTiles()
+{
+	m_tiles.clear();
+
+	RequestTiles();
+	update();
 }
 
 void DisplayWidget::normalSize()
@@ -52,12 +100,151 @@ void DisplayWidget::fitToWindow(bool fitToWindow)
 
 void DisplayWidget::zoomIn()
 {
-	scaleImage(1.25);
+	if (m_viewportMode)
+	{
+		SetZoom(m_zoom + 1, rect().center());
+	}
+	else
+	{
+		scaleImage(1.25);
+	}
 }
 
 void DisplayWidget::zoomOut()
 {
-	scaleImage(0.8);
+	if (m_viewportMode)
+	{
+		SetZoom(m_zoom - 1, rect().center());
+	}
+	else
+	{
+		scaleImage(0.8);
+	}
+}
+
+void DisplayWidget::setViewportMode(bool viewportMode)
+{
+	m_viewportMode = viewportMode;
+	m_scrollArea->setVisible(!m_viewportMode && !m_image.isNull());
+
+	RequestTiles();
+	update();
+}
+
+void DisplayWidget::setTiles(int zoom, const QList<QPoint>& tiles, const QList<QImage>& images)
+{
+	assert(tiles.size() == images.size());
+
+	for (int k = 0; k < tiles.size(); k++)
+	{
+		m_tiles.insert(TileKey(zoom, tiles[k].x(), tiles[k].y()), new QImage(images[k]));
+	}
+
+	update();
+}
+
+void DisplayWidget::paintEvent(QPaintEvent* event)
+{
+	if (!m_viewportMode)
+	{
+		QWidget::paintEvent(event);
+		return;
+	}
+
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().color(QPalette::Dark));
+
+	// At zoom 0, the image is displayed as it is
+	if (m_zoom == 0)
+	{
+		painter.drawImage(-m_offset, m_image);
+		return;
+	}
+
+	const QRect visibleTiles = VisibleTiles();
+	for (int y = visibleTiles.top(); y <= visibleTiles.bottom(); y++)
+	{
+		for (int x = visibleTiles.left(); x <= visibleTiles.right(); x++)
+		{
+			const QPoint position(x * TILE_SIZE - m_offset.x(), y * TILE_SIZE - m_offset.y());
+
+			const QImage* tile = m_tiles.object(TileKey(m_zoom, x, y));
+			if (tile != nullptr)
+			{
+				painter.drawImage(position, *tile);
+				continue;
+			}
+
+			// While the tile is rendered, display the part of a coarser tile or of the image covering it
+			const QRect target(position, QSize(TILE_SIZE, TILE_SIZE));
+			for (int level = 1; level <= m_zoom; level++)
+			{
+				const int factor = 1 << level;
+				const int size = TILE_SIZE / factor;
+
+				if (level == m_zoom)
+				{
+					const QRect source(x * size, y * size, size, size);
+					painter.drawImage(target, m_image, source);
+					break;
+				}
+
+				const QImage* coarseTile = m_tiles.object(TileKey(m_zoom - level, x / factor, y / factor));
+				if (coarseTile != nullptr)
+				{
+					const QRect source((x % factor) * size, (y % factor) * size, size, size);
+					painter.drawImage(target, *coarseTile, source);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void DisplayWidget::resizeEvent(QResizeEvent* event)
+{
+	QWidget::resizeEvent(event);
+
+	RequestTiles();
+}
+
+void DisplayWidget::mousePressEvent(QMouseEvent* event)
+{
+	m_lastMousePosition = event->position().toPoint();
+}
+
+void DisplayWidget::mouseMoveEvent(QMouseEvent* event)
+{
+	if (!m_viewportMode || !(event->buttons() & Qt::LeftButton))
+	{
+		return;
+	}
+
+	// Pan the view, tiles already rendered are reused
+	const QPoint position = event->position().toPoint();
+	m_offset -= position - m_lastMousePosition;
+	m_lastMousePosition = position;
+
+	RequestTiles();
+	update();
+}
+
+void DisplayWidget::wheelEvent(QWheelEvent* event)
+{
+	if (!m_viewportMode)
+	{
+		QWidget::wheelEvent(event);
+		return;
+	}
+
+	if (event->angleDelta().y() > 0)
+	{
+		SetZoom(m_zoom + 1, event->position().toPoint());
+	}
+	else if (event->angleDelta().y() < 0)
+	{
+		SetZoom(m_zoom - 1, event->position().toPoint());
+	}
 }
 
 void DisplayWidget::scaleImage(double factor)
@@ -73,3 +260,93 @@ void DisplayWidget::adjustScrollBar(QScrollBar* scrollBar, double factor) const
 {
 	scrollBar->setValue(int(factor * scrollBar->value() + ((factor - 1) * scrollBar->pageStep() / 2)));
 }
+
+void DisplayWidget::SetZoom(int zoom, const QPoint& position)
+{
+	zoom = std::clamp(zoom, 0, MAXIMUM_ZOOM);
+	if (zoom == m_zoom)
+	{
+		return;
+	}
+
+	// Pixel p at a zoom level is pixel 2p at the next one
+	const QPoint pixel = m_offset + position;
+	if (zoom > m_zoom)
+	{
+		m_offset = pixel * (1 << (zoom - m_zoom)) - position;
+	}
+	else
+	{
+		m_offset = pixel / (1 << (m_zoom - zoom)) - position;
+	}
+	m_zoom = zoom;
+
+	RequestTiles();
+	update();
+}
+
+QSize DisplayWidget::ZoomedSize() const
+{
+	if (m_image.isNull())
+	{
+		return QSize();
+	}
+
+	const int scale = 1 << m_zoom;
+
+	return QSize((m_image.width() - 1) * scale + 1, (m_image.height() - 1) * scale + 1);
+}
+
+QRect DisplayWidget::VisibleTiles() const
+{
+	const QSize size = ZoomedSize();
+	if (size.isEmpty())
+	{
+		return QRect();
+	}
+
+	const int tilesX = (size.width() + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (size.height() + TILE_SIZE - 1) / TILE_SIZE;
+
+	const int left = std::max(0, int(std::floor(double(m_offset.x()) / TILE_SIZE)));
+	const int top = std::max(0, int(std::floor(double(m_offset.y()) / TILE_SIZE)));
+	const int right = std::min(tilesX - 1, int(std::floor(double(m_offset.x() + width() - 1) / TILE_SIZE)));
+	const int bottom = std::min(tilesY - 1, int(std::floor(double(m_offset.y() + height() - 1) / TILE_SIZE)));
+
+	return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void DisplayWidget::RequestTiles()
+{
+	// Zoom 0 is the image itself
+	if (!m_viewportMode || m_zoom == 0)
+	{
+		return;
+	}
+
+	QList<QPoint> missingTiles;
+
+	const QRect visibleTiles = VisibleTiles();
+	for (int y = visibleTiles.top(); y <= visibleTiles.bottom(); y++)
+	{
+		for (int x = visibleTiles.left(); x <= visibleTiles.right(); x++)
+		{
+			if (!m_tiles.contains(TileKey(m_zoom, x, y)))
+			{
+				missingTiles.append(QPoint(x, y));
+			}
+		}
+	}
+
+	if (!missingTiles.empty())
+	{
+		emit tilesNeeded(m_zoom, missingTiles);
+	}
+}
+
+quint64 DisplayWidget::TileKey(int zoom, int x, int y)
+{
+	assert(zoom >= 0 && x >= 0 && y >= 0);
+
+	return (quint64(zoom) << 56) | (quint64(y) << 28) | quint64(x);
+}
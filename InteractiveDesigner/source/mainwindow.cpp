@@ -31,6 +31,8 @@ MainWindow::MainWindow(QWidget *parent)
 	: QMainWindow(parent),
 	ui(new Ui::MainWindowClass),
 	m_progressDialog(nullptr),
+	m_livePreview(false),
+	m_liveTimer(new QTimer(this)),
 	m_noiseRenderer(new NoiseRenderer(this, default_noise_parameters))
 {
 	SetupUi();
@@ -44,6 +46,14 @@ MainWindow::~MainWindow()
 
 void MainWindow::StartRendering()
 {
+	// A live rendering is cancelled and started again with the current parameters, like a parameter change
+	if (m_livePreview || m_noiseRenderer->isRunning())
+	{
+		m_liveTimer->stop();
+		LiveRender();
+		return;
+	}
+
 	m_noiseRenderer->setParameters(m_parameterDock->parameters());
 	const bool isStarted = m_noiseRenderer->start();
 
@@ -54,6 +64,7 @@ void MainWindow::StartRendering()
 		m_progressDialog->setAttribute(Qt::WA_DeleteOnClose);
 		m_progressDialog->setRange(0, 0);
 		m_progressDialog->setValue(0);
+		connect(m_progressDialog, &QProgressDialog::canceled, m_noiseRenderer, &NoiseRenderer::cancel);
 
 		m_progressDialog->exec();
 	}
@@ -64,15 +75,41 @@ void MainWindow::StartRendering()
 	}
 }
 
+void MainWindow::RenderingUpdated()
+{
+	ui->display_widget->updateImage(m_noiseRenderer->resultQImage());
+}
+
 void MainWindow::RenderingFinished()
 {
-	ui->display_widget->setImage(m_noiseRenderer->resultQImage());
+	if (m_livePreview)
+	{
+		// Keep the zoom and position while the user edits the parameters
+		ui->display_widget->updateImage(m_noiseRenderer->resultQImage());
+		ui->display_widget->invalidateTiles();
+	}
+	else
+	{
+		ui->display_widget->setImage(m_noiseRenderer->resultQImage());
+	}
 
 	// Close the progress dialog
 	if (m_progressDialog != nullptr)
 	{
 		m_progressDialog->reset();
 	}
+
+	statusBar()->clearMessage();
+}
+
+void MainWindow::RenderingCancelled()
+{
+	if (m_progressDialog != nullptr)
+	{
+		m_progressDialog->reset();
+	}
+
+	statusBar()->showMessage(tr("Rendering cancelled"), STATUS_MESSAGE_TIMEOUT);
 }
 
 void MainWindow::Save()
@@ -99,6 +136,36 @@ void MainWindow::Save()
 	}
 }
 
+void MainWindow::SetLivePreview(bool livePreview)
+{
+	m_livePreview = livePreview;
+
+	if (m_livePreview)
+	{
+		LiveRender();
+	}
+	else
+	{
+		m_liveTimer->stop();
+	}
+}
+
+void MainWindow::ParametersChanged()
+{
+	// Consecutive changes, like typing a number, only start one rendering
+	if (m_livePreview)
+	{
+		m_liveTimer->start();
+	}
+}
+
+void MainWindow::LiveRender()
+{
+	// The rendering in progress is cancelled at the next tile, then the new one starts with a preview
+	m_noiseRenderer->setParameters(m_parameterDock->parameters());
+	m_noiseRenderer->restart();
+}
+
 void MainWindow::SetupUi()
 {
 	ui->setupUi(this);
@@ -107,6 +174,9 @@ void MainWindow::SetupUi()
 	m_parameterDock->setParameters(default_noise_parameters);
 	addDockWidget(Qt::RightDockWidgetArea, m_parameterDock);
 	ui->menuWindow->addAction(m_parameterDock->toggleViewAction());
+
+	m_liveTimer->setSingleShot(true);
+	m_liveTimer->setInterval(LIVE_PREVIEW_DELAY);
 }
 
 void MainWindow::CreateActions()
@@ -121,7 +191,15 @@ void MainWindow::CreateActions()
 	connect(ui->actionFit_to_Window, &QAction::triggered, ui->display_widget, &DisplayWidget::fitToWindow);
 	connect(ui->actionZoom_In_25, &QAction::triggered, ui->display_widget, &DisplayWidget::zoomIn);
 	connect(ui->actionZoom_Out_25, &QAction::triggered, ui->display_widget, &DisplayWidget::zoomOut);
+	connect(ui->actionViewport_Rendering, &QAction::toggled, ui->display_widget, &DisplayWidget::setViewportMode);
 	
 	connect(ui->actionRender, &QAction::triggered, this, &MainWindow::StartRendering);
+	connect(ui->actionLive_Preview, &QAction::toggled, this, &MainWindow::SetLivePreview);
+	connect(m_parameterDock, &ParameterDock::parametersChanged, this, &MainWindow::ParametersChanged);
+	connect(m_liveTimer, &QTimer::timeout, this, &MainWindow::LiveRender);
+	connect(m_noiseRenderer, &NoiseRenderer::imageUpdated, this, &MainWindow::RenderingUpdated);
 	connect(m_noiseRenderer, &NoiseRenderer::finished, this, &MainWindow::RenderingFinished);
+	connect(m_noiseRenderer, &NoiseRenderer::cancelled, this, &MainWindow::RenderingCancelled);
+	connect(ui->display_widget, &DisplayWidget::tilesNeeded, m_noiseRenderer, &NoiseRenderer::renderTiles);
+	connect(m_noiseRenderer, &NoiseRenderer::tilesRendered, ui->display_widget, &DisplayWidget::setTiles);
 }
@@ -4,11 +4,24 @@
 #include "perlincontrolfunction.h"
 #include "imagecontrolfunction.h"
 #include "noise.h"
+#include "executor.h"
 
 NoiseRenderer::NoiseRenderer(QObject *parent, const NoiseParameters& parameters)
 	: QObject(parent),
-	m_futureImageWatcher(new QFutureWatcher<VectorDouble2D>(this)),
-	m_parameters(parameters)
+	m_futureImageWatcher(new QFutureWatcher<void>(this)),
+	m_parameters(parameters),
+	m_streamTimer(new QTimer(this)),
+	m_streamMinimum(0.0),
+	m_streamMaximum(0.0),
+	m_restartPending(false),
+	m_resultParameters(parameters),
+	m_resultMinimum(0.0),
+	m_resultMaximum(0.0),
+	m_futureTilesWatcher(new QFutureWatcher<TileBatch>(this)),
+	m_tileGeneration(0),
+	m_waitingZoom(0),
+	m_renderingGeneration(0),
+	m_renderingZoom(0)
 {
 	ConfigureFutureWatcher();
 }
@@ -18,43 +31,46 @@ void NoiseRenderer::setParameters(const NoiseParameters& parameters)
 	m_parameters = parameters;
 }
 
-QImage NoiseRenderer::resultQImage() const
+NoiseRenderer::RenderJob::RenderJob(const NoiseParameters& p, bool withPreview) :
+	parameters(p),
+	result(p.heightResolution, p.widthResolution),
+	previewStep(withPreview ? PREVIEW_STEP : 1),
+	tilesX((p.widthResolution + STREAM_TILE_SIZE - 1) / STREAM_TILE_SIZE),
+	tilesY((p.heightResolution + STREAM_TILE_SIZE - 1) / STREAM_TILE_SIZE),
+	finishedTiles(withPreview ? 2 * tilesX * tilesY : tilesX * tilesY),
+	cancelled(false)
 {
-	QImage image(m_result.width, m_result.height, QImage::Format::Format_Grayscale8);
-
-	// Find min and max to remap to 16 bits
-	double minimum = std::numeric_limits<double>::max();
-	double maximum = std::numeric_limits<double>::lowest();
-	for (auto value : m_result.data) {
-		minimum = std::min(minimum, value);
-		maximum = std::max(maximum, value);
+	if (withPreview)
+	{
+		preview = VectorDouble2D((p.heightResolution + PREVIEW_STEP - 1) / PREVIEW_STEP, (p.widthResolution + PREVIEW_STEP - 1) / PREVIEW_STEP);
 	}
+}
 
-	for (std::size_t i = 0; i < m_result.height; i++) {
-		for (std::size_t j = 0; j < m_result.width; j++) {
-			const auto grayValue = remap_clamp(m_result.at(i, j), minimum, maximum, 0.0, double(std::numeric_limits<uint8_t>::max()));
-			image.setPixel(j, i, qRgb(grayValue, grayValue, grayValue));
-		}
-	}
+int NoiseRenderer::RenderJob::tiles() const
+{
+	return tilesX * tilesY;
+}
 
-	return image;
+QRect NoiseRenderer::RenderJob::tileRect(int tile) const
+{
+	const int left = (tile % tilesX) * STREAM_TILE_SIZE;
+	const int top = (tile / tilesX) * STREAM_TILE_SIZE;
+
+	return QRect(left, top, std::min(STREAM_TILE_SIZE, int(result.width) - left), std::min(STREAM_TILE_SIZE, int(result.height) - top));
+}
+
+QImage NoiseRenderer::resultQImage() const
+{
+	return m_frontImage;
 }
 
 cv::Mat NoiseRenderer::resultCvMat() const
 {
 	cv::Mat image(m_result.height, m_result.width, CV_16U);
 
-	// Find min and max to remap to 16 bits
-	double minimum = std::numeric_limits<double>::max();
-	double maximum = std::numeric_limits<double>::lowest();
-	for (auto value : m_result.data) {
-		minimum = std::min(minimum, value);
-		maximum = std::max(maximum, value);
-	}
-
 	for (std::size_t i = 0; i < m_result.height; i++) {
 		for (std::size_t j = 0; j < m_result.width; j++) {
-			const auto grayValue = remap_clamp(m_result.at(i, j), minimum, maximum, 0.0, double(std::numeric_limits<uint16_t>::max()));
+			const auto grayValue = remap_clamp(m_result.at(i, j), m_resultMinimum, m_resultMaximum, 0.0, double(std::numeric_limits<uint16_t>::max()));
 			image.at<uint16_t>(i, j) = static_cast<uint16_t>(grayValue);
 		}
 	}
@@ -62,25 +78,37 @@ cv::Mat NoiseRenderer::resultCvMat() const
 	return image;
 }
 
-bool NoiseRenderer::start()
+bool NoiseRenderer::start(bool preview)
 {
 	// Check that the renderer is not currently running before starting a new computation
 	if (!m_futureImageWatcher->isRunning())
 	{
-		QFuture<VectorDouble2D> futureImage;
+		m_job = std::make_shared<RenderJob>(m_parameters, preview);
 
-		switch (m_parameters.type)
+		// Both images are allocated separately so that drawing in one never copies the other.
+		// Tiles are drawn over the previous image if it has the same size.
+		const QImage previousImage = m_frontImage;
+		if (previousImage.width() == m_parameters.widthResolution && previousImage.height() == m_parameters.heightResolution)
 		{
-		case NoiseType::terrain:
-			futureImage = QtConcurrent::run(&NoiseRenderer::RenderTerrain, this);
-			break;
+			m_frontImage = previousImage.copy();
+			m_backImage = previousImage.copy();
+		}
+		else
+		{
+			m_frontImage = QImage(m_parameters.widthResolution, m_parameters.heightResolution, QImage::Format::Format_Grayscale8);
+			m_frontImage.fill(0);
+			m_backImage = QImage(m_parameters.widthResolution, m_parameters.heightResolution, QImage::Format::Format_Grayscale8);
+			m_backImage.fill(0);
+		}
+		m_backMissingTiles.clear();
 
-		case NoiseType::lichtenberg:
-			futureImage = QtConcurrent::run(&NoiseRenderer::RenderLichtenberg, this);
-			break;
-		};
+		m_streamMinimum = std::numeric_limits<double>::max();
+		m_streamMaximum = std::numeric_limits<double>::lowest();
 
+		// The noise is built here, the background thread only evaluates it
+		const QFuture<void> futureImage = QtConcurrent::run(&NoiseRenderer::RenderImage, Evaluator(m_parameters), m_job);
 		m_futureImageWatcher->setFuture(futureImage);
+		m_streamTimer->start(STREAM_INTERVAL);
 
 		return true;
 	}
@@ -88,99 +116,463 @@ bool NoiseRenderer::start()
 	return false;
 }
 
+void NoiseRenderer::cancel()
+{
+	m_restartPending = false;
+
+	if (m_job)
+	{
+		m_job->cancelled.store(true, std::memory_order_relaxed);
+	}
+}
+
+void NoiseRenderer::restart()
+{
+	if (isRunning())
+	{
+		cancel();
+		m_restartPending = true;
+	}
+	else
+	{
+		start(true);
+	}
+}
+
+bool NoiseRenderer::isRunning() const
+{
+	return m_futureImageWatcher->isRunning();
+}
+
+void NoiseRenderer::renderTiles(int zoom, const QList<QPoint>& tiles)
+{
+	// Tiles can only be rendered once the range of values of the image is known
+	if (m_result.data.empty())
+	{
+		return;
+	}
+
+	m_waitingZoom = zoom;
+	m_waitingTiles.clear();
+	for (const QPoint& tile : tiles)
+	{
+		// Skip tiles that are already being rendered from the current image
+		if (!m_futureTilesWatcher->isRunning() || m_renderingGeneration != m_tileGeneration || zoom != m_renderingZoom || !m_renderingTiles.contains(tile))
+		{
+			m_waitingTiles.append(tile);
+		}
+	}
+
+	if (!m_futureTilesWatcher->isRunning())
+	{
+		StartTiles();
+	}
+}
+
+QSize NoiseRenderer::zoomedSize(int zoom) const
+{
+	if (m_result.data.empty())
+	{
+		return QSize();
+	}
+
+	const int scale = 1 << zoom;
+
+	return QSize(int(m_result.width - 1) * scale + 1, int(m_result.height - 1) * scale + 1);
+}
+
 void NoiseRenderer::OnRenderingFinished()
 {
-	m_result = m_futureImageWatcher->future().result();
+	m_streamTimer->stop();
+
+	// The result of a cancelled rendering is incomplete
+	if (m_job->cancelled.load(std::memory_order_relaxed))
+	{
+		m_job.reset();
+
+		if (m_restartPending)
+		{
+			m_restartPending = false;
+			start(true);
+		}
+		else
+		{
+			emit cancelled();
+		}
+
+		return;
+	}
+
+	// Render threads are finished, the result can be moved
+	m_result = std::move(m_job->result);
+	m_resultParameters = m_job->parameters;
+	m_job.reset();
+
+	// Tiles being rendered belong to the previous image
+	m_tileGeneration++;
+
+	// Find min and max to remap to gray levels, each row is reduced in parallel then rows are reduced
+	const int height = int(m_result.height);
+	const int width = int(m_result.width);
+	std::vector<double> rowMinimums(height, std::numeric_limits<double>::max());
+	std::vector<double> rowMaximums(height, std::numeric_limits<double>::lowest());
+
+	Executor::global().parallelFor(0, height, [&](int i) {
+		for (int j = 0; j < width; j++) {
+			rowMinimums[i] = std::min(rowMinimums[i], m_result.at(i, j));
+			rowMaximums[i] = std::max(rowMaximums[i], m_result.at(i, j));
+		}
+	});
+
+	m_resultMinimum = *std::min_element(rowMinimums.begin(), rowMinimums.end());
+	m_resultMaximum = *std::max_element(rowMaximums.begin(), rowMaximums.end());
+
+	// Tiles streamed so far were remapped with a partial range, the whole image is remapped again
+	ConvertRect(m_result, QRect(0, 0, int(m_result.width), int(m_result.height)), m_resultMinimum, m_resultMaximum, m_backImage);
+	std::swap(m_frontImage, m_backImage);
+	m_backMissingTiles.clear();
+
+	// Waiting tiles belong to the previous image
+	m_waitingTiles.clear();
+
 	emit finished();
 }
 
+void NoiseRenderer::OnStreamTimeout()
+{
+	QList<int> finishedTiles;
+
+	int index;
+	while (m_job->finishedTiles.pop(index))
+	{
+		finishedTiles.append(index);
+
+		// Preview tiles have one sample per block
+		const bool preview = index >= m_job->tiles();
+		const int step = preview ? m_job->previewStep : 1;
+		const VectorDouble2D& values = preview ? m_job->preview : m_job->result;
+		const QRect rect = m_job->tileRect(preview ? index - m_job->tiles() : index);
+
+		for (int i = rect.top(); i <= rect.bottom(); i += step) {
+			for (int j = rect.left(); j <= rect.right(); j += step) {
+				m_streamMinimum = std::min(m_streamMinimum, values.at(i / step, j / step));
+				m_streamMaximum = std::max(m_streamMaximum, values.at(i / step, j / step));
+			}
+		}
+	}
+
+	if (finishedTiles.empty())
+	{
+		return;
+	}
+
+	// Tiles are drawn in the order they were finished, so that a refined tile is drawn over its preview
+	for (int tile : m_backMissingTiles)
+	{
+		DrawStreamedTile(tile);
+	}
+
+	for (int tile : finishedTiles)
+	{
+		DrawStreamedTile(tile);
+	}
+
+	std::swap(m_frontImage, m_backImage);
+	m_backMissingTiles = finishedTiles;
+
+	emit imageUpdated();
+}
+
+void NoiseRenderer::DrawStreamedTile(int index)
+{
+	if (index >= m_job->tiles())
+	{
+		ConvertRect(m_job->preview, m_job->tileRect(index - m_job->tiles()), m_streamMinimum, m_streamMaximum, m_backImage, m_job->previewStep);
+	}
+	else
+	{
+		ConvertRect(m_job->result, m_job->tileRect(index), m_streamMinimum, m_streamMaximum, m_backImage);
+	}
+}
+
+void NoiseRenderer::OnTilesFinished()
+{
+	const TileBatch batch = m_futureTilesWatcher->future().result();
+	m_renderingTiles.clear();
+
+	// The image changed while the tiles were rendered, the display already requested them again
+	if (batch.generation == m_tileGeneration)
+	{
+		emit tilesRendered(batch.zoom, batch.tiles, batch.images);
+	}
+
+	if (!m_waitingTiles.empty())
+	{
+		StartTiles();
+	}
+}
+
 void NoiseRenderer::ConfigureFutureWatcher()
 {
-	connect(m_futureImageWatcher, &QFutureWatcher<VectorDouble2D>::finished, this, &NoiseRenderer::OnRenderingFinished);
+	connect(m_futureImageWatcher, &QFutureWatcher<void>::finished, this, &NoiseRenderer::OnRenderingFinished);
+	connect(m_streamTimer, &QTimer::timeout, this, &NoiseRenderer::OnStreamTimeout);
+	connect(m_futureTilesWatcher, &QFutureWatcher<TileBatch>::finished, this, &NoiseRenderer::OnTilesFinished);
 }
 
-NoiseRenderer::VectorDouble2D NoiseRenderer::RenderTerrain() const
+std::function<double(double, double)> NoiseRenderer::Evaluator(const NoiseParameters& parameters)
 {
+	switch (parameters.type)
+	{
+	case NoiseType::lichtenberg:
+	{
+		const std::shared_ptr<const LichtenbergNoise> noise = LichtenbergEngine(parameters);
+		return [noise](double x, double y) { return noise->evaluateLichtenberg(x, y); };
+	}
+
+	case NoiseType::terrain:
+	default:
+	{
+		const std::shared_ptr<const TerrainNoise> noise = TerrainEngine(parameters);
+		return [noise](double x, double y) { return noise->evaluateTerrain(x, y); };
+	}
+	}
+}
+
+void NoiseRenderer::StartTiles()
+{
+	assert(!m_futureTilesWatcher->isRunning());
+
+	m_renderingGeneration = m_tileGeneration;
+	m_renderingZoom = m_waitingZoom;
+	m_renderingTiles = m_waitingTiles;
+	m_waitingTiles.clear();
+
+	const QFuture<TileBatch> futureTiles = QtConcurrent::run(&NoiseRenderer::RenderTiles,
+		Evaluator(m_resultParameters),
+		m_renderingGeneration,
+		m_resultParameters,
+		m_resultMinimum,
+		m_resultMaximum,
+		m_renderingZoom,
+		m_renderingTiles);
+
+	m_futureTilesWatcher->setFuture(futureTiles);
+}
+
+NoiseRenderer::TileBatch NoiseRenderer::RenderTiles(std::function<double(double, double)> evaluate, int generation, const NoiseParameters& parameters, double minimum, double maximum, int zoom, const QList<QPoint>& tiles)
+{
+	TileBatch batch;
+	batch.generation = generation;
+	batch.zoom = zoom;
+	batch.tiles = tiles;
+
+	// Size of a pixel in the noise domain, at zoom 0 pixels are the ones of RenderImage
+	const double scale = double(1 << zoom);
+	const double pixelWidth = (parameters.noiseRight - parameters.noiseLeft) / (double(parameters.widthResolution - 1) * scale);
+	const double pixelHeight = (parameters.noiseBottom - parameters.noiseTop) / (double(parameters.heightResolution - 1) * scale);
+	const int width = (parameters.widthResolution - 1) * (1 << zoom) + 1;
+	const int height = (parameters.heightResolution - 1) * (1 << zoom) + 1;
+
+	for (const QPoint& tile : tiles)
+	{
+		// Tiles on the right and bottom borders are cropped to the image
+		const int tileWidth = std::clamp(width - tile.x() * TILE_SIZE, 0, TILE_SIZE);
+		const int tileHeight = std::clamp(height - tile.y() * TILE_SIZE, 0, TILE_SIZE);
+
+		QImage image(std::max(tileWidth, 1), std::max(tileHeight, 1), QImage::Format::Format_Grayscale8);
+		image.fill(0);
+
+		Executor::global().parallelFor(0, tileHeight, [&](int i) {
+			uchar* line = image.scanLine(i);
+
+			for (int j = 0; j < tileWidth; j++) {
+				const double x = parameters.noiseLeft + double(tile.x() * TILE_SIZE + j) * pixelWidth;
+				const double y = parameters.noiseTop + double(tile.y() * TILE_SIZE + i) * pixelHeight;
+
+				line[j] = uchar(remap_clamp(evaluate(x, y), minimum, maximum, 0.0, double(std::numeric_limits<uint8_t>::max())));
+			}
+		});
+
+		batch.images.append(image);
+	}
+
+	return batch;
+}
+
+bool NoiseRenderer::SameFunction(const NoiseParameters& a, const NoiseParameters& b)
+{
+	// The noise window is part of the function, it is remapped to the control function window
+	return a.type == b.type
+		&& a.seed == b.seed
+		&& a.levels == b.levels
+		&& a.epsilon == b.epsilon
+		&& a.displacement == b.displacement
+		&& a.noiseTop == b.noiseTop
+		&& a.noiseBottom == b.noiseBottom
+		&& a.noiseLeft == b.noiseLeft
+		&& a.noiseRight == b.noiseRight
+		&& a.controlFunctionTop == b.controlFunctionTop
+		&& a.controlFunctionBottom == b.controlFunctionBottom
+		&& a.controlFunctionLeft == b.controlFunctionLeft
+		&& a.controlFunctionRight == b.controlFunctionRight
+		&& a.primitivesResolutionSteps == b.primitivesResolutionSteps
+		&& a.slopePower == b.slopePower
+		&& a.noiseAmplitudeProportion == b.noiseAmplitudeProportion
+		&& a.controlScale == b.controlScale;
+}
+
+std::shared_ptr<const NoiseRenderer::TerrainNoise> NoiseRenderer::TerrainEngine(const NoiseParameters& parameters)
+{
+	if (m_terrainNoise && SameFunction(m_terrainNoiseParameters, parameters))
+	{
+		return m_terrainNoise;
+	}
+
 	typedef PerlinControlFunction ControlFunctionType;
-	std::unique_ptr<ControlFunctionType> controlFunction(std::make_unique<ControlFunctionType>(m_parameters.controlScale));
+	std::unique_ptr<ControlFunctionType> controlFunction(std::make_unique<ControlFunctionType>(parameters.controlScale));
 
-	const Point2D noiseTopLeft(m_parameters.noiseLeft, m_parameters.noiseTop);
-	const Point2D noiseBottomRight(m_parameters.noiseRight, m_parameters.noiseBottom);
-	const Point2D controlFunctionTopLeft(m_parameters.controlFunctionLeft, m_parameters.controlFunctionTop);
-	const Point2D controlFunctionBottomRight(m_parameters.controlFunctionRight, m_parameters.controlFunctionBottom);
+	const Point2D noiseTopLeft(parameters.noiseLeft, parameters.noiseTop);
+	const Point2D noiseBottomRight(parameters.noiseRight, parameters.noiseBottom);
+	const Point2D controlFunctionTopLeft(parameters.controlFunctionLeft, parameters.controlFunctionTop);
+	const Point2D controlFunctionBottomRight(parameters.controlFunctionRight, parameters.controlFunctionBottom);
 
-	const Noise<ControlFunctionType> noise(std::move(controlFunction),
+	m_terrainNoise = std::make_shared<const TerrainNoise>(std::move(controlFunction),
 		noiseTopLeft,
 		noiseBottomRight,
 		controlFunctionTopLeft,
 		controlFunctionBottomRight,
-		m_parameters.seed,
-		m_parameters.epsilon,
-		m_parameters.levels,
-		m_parameters.displacement,
-		m_parameters.primitivesResolutionSteps,
-		m_parameters.slopePower,
-		m_parameters.noiseAmplitudeProportion,
+		parameters.seed,
+		parameters.epsilon,
+		parameters.levels,
+		parameters.displacement,
+		parameters.primitivesResolutionSteps,
+		parameters.slopePower,
+		parameters.noiseAmplitudeProportion,
 		true,
 		false,
 		false,
 		false,
 		false);
+	m_terrainNoiseParameters = parameters;
 
-	VectorDouble2D result(m_parameters.heightResolution, m_parameters.widthResolution);
-
-#pragma omp parallel for
-	for (int i = 0; i < m_parameters.heightResolution; i++) {
-		for (int j = 0; j < m_parameters.widthResolution; j++) {
-			const double x = remap_clamp(double(j), 0.0, double(m_parameters.widthResolution - 1), noiseTopLeft.x, noiseBottomRight.x);
-			const double y = remap_clamp(double(i), 0.0, double(m_parameters.heightResolution - 1), noiseTopLeft.y, noiseBottomRight.y);
-
-			result.at(i, j) = noise.evaluateTerrain(x, y);
-		}
-	}
-
-	return result;
+	return m_terrainNoise;
 }
 
-NoiseRenderer::VectorDouble2D NoiseRenderer::RenderLichtenberg() const
+std::shared_ptr<const NoiseRenderer::LichtenbergNoise> NoiseRenderer::LichtenbergEngine(const NoiseParameters& parameters)
 {
+	if (m_lichtenbergNoise && SameFunction(m_lichtenbergNoiseParameters, parameters))
+	{
+		return m_lichtenbergNoise;
+	}
+
 	typedef LichtenbergControlFunction ControlFunctionType;
 	std::unique_ptr<ControlFunctionType> controlFunction(std::make_unique<ControlFunctionType>());
 
-	const Point2D noiseTopLeft(m_parameters.noiseLeft, m_parameters.noiseTop);
-	const Point2D noiseBottomRight(m_parameters.noiseRight, m_parameters.noiseBottom);
-	const Point2D controlFunctionTopLeft(m_parameters.controlFunctionLeft, m_parameters.controlFunctionTop);
-	const Point2D controlFunctionBottomRight(m_parameters.controlFunctionRight, m_parameters.controlFunctionBottom);
+	const Point2D noiseTopLeft(parameters.noiseLeft, parameters.noiseTop);
+	const Point2D noiseBottomRight(parameters.noiseRight, parameters.noiseBottom);
+	const Point2D controlFunctionTopLeft(parameters.controlFunctionLeft, parameters.controlFunctionTop);
+	const Point2D controlFunctionBottomRight(parameters.controlFunctionRight, parameters.controlFunctionBottom);
 
-	const Noise<ControlFunctionType> noise(std::move(controlFunction),
+	m_lichtenbergNoise = std::make_shared<const LichtenbergNoise>(std::move(controlFunction),
 		noiseTopLeft,
 		noiseBottomRight,
 		controlFunctionTopLeft,
 		controlFunctionBottomRight,
-		m_parameters.seed,
-		m_parameters.epsilon,
-		m_parameters.levels,
-		m_parameters.displacement,
-		m_parameters.primitivesResolutionSteps,
-		m_parameters.slopePower,
-		m_parameters.noiseAmplitudeProportion,
+		parameters.seed,
+		parameters.epsilon,
+		parameters.levels,
+		parameters.displacement,
+		parameters.primitivesResolutionSteps,
+		parameters.slopePower,
+		parameters.noiseAmplitudeProportion,
 		true,
 		false,
 		true,
 		false,
 		false);
+	m_lichtenbergNoiseParameters = parameters;
+
+	return m_lichtenbergNoise;
+}
 
-	VectorDouble2D result(m_parameters.heightResolution, m_parameters.widthResolution);
+void NoiseRenderer::RenderImage(std::function<double(double, double)> evaluate, std::shared_ptr<RenderJob> job)
+{
+	const NoiseParameters& parameters = job->parameters;
+	const int tiles = job->tiles();
+	const int step = job->previewStep;
 
-#pragma omp parallel for
-	for (int i = 0; i < m_parameters.heightResolution; i++) {
-		for (int j = 0; j < m_parameters.widthResolution; j++) {
-			const double x = remap_clamp(double(j), 0.0, double(m_parameters.widthResolution - 1), noiseTopLeft.x, noiseBottomRight.x);
-			const double y = remap_clamp(double(i), 0.0, double(m_parameters.heightResolution - 1), noiseTopLeft.y, noiseBottomRight.y);
+	// The preview evaluates the top left pixel of each block
+	if (step > 1)
+	{
+		Executor::global().parallelFor(0, tiles, [&](int tile) {
+			// Cancellation is cooperative, remaining tiles are skipped
+			if (job->cancelled.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			const QRect rect = job->tileRect(tile);
+
+			for (int i = rect.top(); i <= rect.bottom(); i += step) {
+				for (int j = rect.left(); j <= rect.right(); j += step) {
+					const double x = remap_clamp(double(j), 0.0, double(parameters.widthResolution - 1), parameters.noiseLeft, parameters.noiseRight);
+					const double y = remap_clamp(double(i), 0.0, double(parameters.heightResolution - 1), parameters.noiseTop, parameters.noiseBottom);
+
+					job->preview.at(i / step, j / step) = evaluate(x, y);
+				}
+			}
+
+			job->finishedTiles.push(tiles + tile);
+		});
+	}
 
-			result.at(i, j) = noise.evaluateLichtenberg(x, y);
+	Executor::global().parallelFor(0, tiles, [&](int tile) {
+		if (job->cancelled.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		const QRect rect = job->tileRect(tile);
+
+		for (int i = rect.top(); i <= rect.bottom(); i++) {
+			for (int j = rect.left(); j <= rect.right(); j++) {
+				// Samples of the preview are exact
+				if (step > 1 && i % step == 0 && j % step == 0)
+				{
+					job->result.at(i, j) = job->preview.at(i / step, j / step);
+					continue;
+				}
+
+				const double x = remap_clamp(double(j), 0.0, double(parameters.widthResolution - 1), parameters.noiseLeft, parameters.noiseRight);
+				const double y = remap_clamp(double(i), 0.0, double(parameters.heightResolution - 1), parameters.noiseTop, parameters.noiseBottom);
+
+				job->result.at(i, j) = evaluate(x, y);
+			}
 		}
-	}
 
-	return result;
+		job->finishedTiles.push(tile);
+	});
+}
+
+void NoiseRenderer::ConvertRect(const VectorDouble2D& values, const QRect& rect, double minimum, double maximum, QImage& image, int step)
+{
+	const auto convertRows = [&](int first, int last) {
+		for (int i = first; i < last; i++) {
+			uchar* line = image.scanLine(i);
+
+			for (int j = rect.left(); j <= rect.right(); j++) {
+				line[j] = uchar(remap_clamp(values.at(i / step, j / step), minimum, maximum, 0.0, double(std::numeric_limits<uint8_t>::max())));
+			}
+		}
+	};
+
+	// Only the whole image is worth converting in parallel, tiles are converted while render threads are busy
+	if (rect.width() * rect.height() > STREAM_TILE_SIZE * STREAM_TILE_SIZE)
+	{
+		Executor::global().parallelFor(rect.top(), rect.bottom() + 1, 1, convertRows);
+	}
+	else
+	{
+		convertRows(rect.top(), rect.bottom() + 1);
+	}
 }
@@ -2,11 +2,27 @@
 
 #include "ui_parameterdock.h"
 
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+
 ParameterDock::ParameterDock(QWidget *parent)
 	: QDockWidget(parent),
 	ui(new Ui::ParameterDock)
 {
 	ui->setupUi(this);
+
+	// Every editor of the dock notifies the changes of the parameters
+	connect(ui->typeComboBox, &QComboBox::currentIndexChanged, this, &ParameterDock::parametersChanged);
+
+	for (QSpinBox* spinBox : findChildren<QSpinBox*>())
+	{
+		connect(spinBox, &QSpinBox::valueChanged, this, &ParameterDock::parametersChanged);
+	}
+
+	for (QDoubleSpinBox* doubleSpinBox : findChildren<QDoubleSpinBox*>())
+	{
+		connect(doubleSpinBox, &QDoubleSpinBox::valueChanged, this, &ParameterDock::parametersChanged);
+	}
 }
 
 ParameterDock::~ParameterDock()
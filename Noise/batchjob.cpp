@@ -0,0 +1,386 @@
+#include "batchjob.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "noise.h"
+#include "executor.h"
+#include "heightfieldwriter.h"
+#include "utils.h"
+#include "perlincontrolfunction.h"
+#include "lichtenbergcontrolfunction.h"
+#include "imagecontrolfunction.h"
+#include "rastertile.h"
+
+using namespace std;
+
+namespace
+{
+	bool ParseBatchRectangle(const string& value, Point2D& topLeft, Point2D& bottomRight)
+	{
+		char c1, c2, c3;
+		istringstream stream(value);
+		stream >> topLeft.x >> c1 >> topLeft.y >> c2 >> bottomRight.x >> c3 >> bottomRight.y;
+
+		return !stream.fail() && c1 == ',' && c2 == ',' && c3 == ',';
+	}
+
+	bool EndsWith(const string& text, const string& suffix)
+	{
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	template<typename F>
+	vector<vector<double> > RenderNoise(const BatchJob& job, int left, int top, int width, int height, F evaluate)
+	{
+		vector<vector<double> > values = AllocateRows<double>(height, width);
+
+		Executor::global().parallelForStatic(0, height, [&](int i) {
+			for (int j = 0; j < width; j++) {
+				const double x = remap_clamp(double(left + j), 0.0, double(job.width), job.noiseTopLeft.x, job.noiseBottomRight.x);
+				const double y = remap_clamp(double(top + i), 0.0, double(job.height), job.noiseTopLeft.y, job.noiseBottomRight.y);
+
+				values[i][j] = evaluate(x, y);
+			}
+		});
+
+		return values;
+	}
+
+	// Memory of the points cached for the seed of a noise, a cache is shared by the noises with the same seed and eps
+	const std::size_t POINT_CACHE_BYTES = 128 * 128 * sizeof(Point2D);
+}
+
+bool ParseBatchJob(const string& line, BatchJob& job)
+{
+	istringstream stream(line);
+	if (!(stream >> job.kind >> job.width >> job.height >> job.seed >> job.filename))
+	{
+		return false;
+	}
+
+	if (job.kind == "lichtenberg")
+	{
+		// Same defaults as EffectParametersImage
+		job.resolution = 3;
+		job.displacement = 0.05;
+		job.slopePower = 1.0;
+		job.noiseAmplitudeProportion = 0.0;
+		job.noiseTopLeft = Point2D(-2.0, -2.0);
+		job.noiseBottomRight = Point2D(1.0, 1.0);
+		job.controlFunctionTopLeft = Point2D(-1.0, -1.0);
+		job.controlFunctionBottomRight = Point2D(1.0, 1.0);
+	}
+	else if (job.kind == "image")
+	{
+		// Same defaults as SmallAmplificationImage
+		job.resolution = 1;
+		job.eps = 0.10;
+		job.displacement = 0.05;
+		job.primitivesResolutionSteps = 2;
+		job.slopePower = 1.0;
+		job.noiseAmplitudeProportion = 0.05;
+		job.noiseTopLeft = Point2D(0.0, 0.0);
+		job.noiseBottomRight = Point2D(12.0, 12.0);
+		job.controlFunctionTopLeft = Point2D(0.0, 0.0);
+		job.controlFunctionBottomRight = Point2D(1.0, 1.0);
+	}
+	else if (job.kind != "terrain")
+	{
+		return false;
+	}
+
+	string parameter;
+	while (stream >> parameter)
+	{
+		const size_t equal = parameter.find('=');
+		if (equal == string::npos)
+		{
+			return false;
+		}
+
+		const string key = parameter.substr(0, equal);
+		istringstream value(parameter.substr(equal + 1));
+
+		if (key == "resolution") value >> job.resolution;
+		else if (key == "eps") value >> job.eps;
+		else if (key == "displacement") value >> job.displacement;
+		else if (key == "steps") value >> job.primitivesResolutionSteps;
+		else if (key == "beta") value >> job.slopePower;
+		else if (key == "amplitude") value >> job.noiseAmplitudeProportion;
+		else if (key == "compression") value >> job.compression;
+		else if (key == "image") value >> job.controlImage;
+		else if (key == "noise")
+		{
+			if (!ParseBatchRectangle(value.str(), job.noiseTopLeft, job.noiseBottomRight)) return false;
+		}
+		else if (key == "control")
+		{
+			if (!ParseBatchRectangle(value.str(), job.controlFunctionTopLeft, job.controlFunctionBottomRight)) return false;
+		}
+		else
+		{
+			return false;
+		}
+
+		if (value.fail())
+		{
+			return false;
+		}
+	}
+
+	// An image job needs its control image
+	if (job.kind == "image" && job.controlImage.empty())
+	{
+		return false;
+	}
+
+	// Ranges asserted by the noise: a Lichtenberg figure has one more level than a terrain, points are drawn in [eps, 1 - eps] of their cell,
+	// and each step of primitives multiplies their number by 4
+	const int maxResolution = (job.kind == "lichtenberg") ? 6 : 5;
+	if (job.resolution < 1 || job.resolution > maxResolution || job.eps < 0.0 || job.eps >= 0.5 || job.primitivesResolutionSteps < 0 || job.primitivesResolutionSteps > 6)
+	{
+		return false;
+	}
+
+	return job.width > 0 && job.height > 0;
+}
+
+bool ReadBatchJobs(const std::string& jobsFilename, vector<BatchJob>& jobs)
+{
+	ifstream file(jobsFilename);
+	if (!file)
+	{
+		std::cerr << "Cannot open the job file " << jobsFilename << std::endl;
+		return false;
+	}
+
+	string line;
+	for (int lineNumber = 1; getline(file, line); lineNumber++)
+	{
+		// Skip empty lines and comments
+		const size_t first = line.find_first_not_of(" \t\r");
+		if (first == string::npos || line[first] == '#')
+		{
+			continue;
+		}
+
+		BatchJob job;
+		if (!ParseBatchJob(line, job))
+		{
+			std::cerr << "Invalid job at line " << lineNumber << ": " << line << std::endl;
+			return false;
+		}
+
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+bool IsBatchHeightfield(const BatchJob& job)
+{
+	return EndsWith(job.filename, ".f32") || EndsWith(job.filename, ".npy") || EndsWith(job.filename, ".raw");
+}
+
+string BatchJobParameters(const BatchJob& job)
+{
+	// Doubles are written with enough digits to be read back exactly
+	ostringstream parameters;
+	parameters << setprecision(numeric_limits<double>::max_digits10) << "kind=" << job.kind << " resolution=" << job.resolution << " eps=" << job.eps << " displacement=" << job.displacement
+	           << " steps=" << job.primitivesResolutionSteps << " beta=" << job.slopePower << " amplitude=" << job.noiseAmplitudeProportion
+	           << " control=" << job.controlFunctionTopLeft.x << "," << job.controlFunctionTopLeft.y << "," << job.controlFunctionBottomRight.x << "," << job.controlFunctionBottomRight.y;
+
+	if (job.kind == "image")
+	{
+		parameters << " image=" << job.controlImage;
+	}
+
+	return parameters.str();
+}
+
+string BatchNoiseDescription(const BatchJob& job)
+{
+	ostringstream description;
+	description << setprecision(numeric_limits<double>::max_digits10) << "seed=" << job.seed
+	            << " noise=" << job.noiseTopLeft.x << "," << job.noiseTopLeft.y << "," << job.noiseBottomRight.x << "," << job.noiseBottomRight.y
+	            << " " << BatchJobParameters(job);
+
+	return description.str();
+}
+
+uint64_t BatchJobFingerprint(const BatchJob& job)
+{
+	return RasterFingerprint(to_string(job.width) + "x" + to_string(job.height) + " " + BatchNoiseDescription(job));
+}
+
+uint16_t GrayLevel16(double value, double minimum, double maximum)
+{
+	return uint16_t(remap_clamp(value, minimum, maximum, 0.0, 65535.0));
+}
+
+bool WriteBatchHeightfield(const BatchJob& job, const cv::Mat& image)
+{
+	if (EndsWith(job.filename, ".f32"))
+	{
+		return SaveRawFloat32(job.filename, image);
+	}
+
+	if (EndsWith(job.filename, ".npy"))
+	{
+		return SaveNpy(job.filename, image);
+	}
+
+	HeightfieldMetadata metadata;
+	metadata.topLeft = job.noiseTopLeft;
+	metadata.bottomRight = job.noiseBottomRight;
+	metadata.seed = job.seed;
+	metadata.parameters = BatchJobParameters(job);
+
+	return SaveTiledHeightfield(job.filename, image, metadata);
+}
+
+bool WriteBatchOutput(const BatchJob& job, const vector<vector<double> >& values)
+{
+	const int height = int(values.size());
+	const int width = int(values.front().size());
+
+	if (IsBatchHeightfield(job))
+	{
+		cv::Mat image(height, width, CV_32F);
+		for (int i = 0; i < height; i++) {
+			for (int j = 0; j < width; j++) {
+				image.at<float>(i, j) = float(values[i][j]);
+			}
+		}
+
+		return WriteBatchHeightfield(job, image);
+	}
+
+	double minimum = numeric_limits<double>::max();
+	double maximum = numeric_limits<double>::lowest();
+	for (const vector<double>& row : values)
+	{
+		for (const double value : row)
+		{
+			minimum = min(minimum, value);
+			maximum = max(maximum, value);
+		}
+	}
+
+	cv::Mat image(height, width, CV_16U);
+	for (int i = 0; i < height; i++) {
+		for (int j = 0; j < width; j++) {
+			image.at<uint16_t>(i, j) = GrayLevel16(values[i][j], minimum, maximum);
+		}
+	}
+
+	if (job.kind == "lichtenberg")
+	{
+		cv::bitwise_not(image, image);
+	}
+
+	vector<int> parameters;
+	if (job.compression >= 0)
+	{
+		parameters = { cv::IMWRITE_PNG_COMPRESSION, job.compression };
+	}
+
+	return cv::imwrite(job.filename, image, parameters);
+}
+
+cv::Mat LoadBatchControlImage(const BatchJob& job)
+{
+	if (job.kind != "image")
+	{
+		return cv::Mat();
+	}
+
+	cv::Mat image = cv::imread(job.controlImage, cv::ImreadModes::IMREAD_ANYDEPTH);
+
+	// ImageControlFunction needs a gray level image of at least 2x2 pixels
+	if (image.empty() || (image.type() != CV_8U && image.type() != CV_16U) || image.rows < 2 || image.cols < 2)
+	{
+		return cv::Mat();
+	}
+
+	return image;
+}
+
+BatchEngine::BatchEngine(const BatchJob& job, const cv::Mat& controlImage) :
+	m_memoryUsage(POINT_CACHE_BYTES)
+{
+	if (job.kind == "lichtenberg")
+	{
+		unique_ptr<LichtenbergControlFunction> controlFunction(make_unique<LichtenbergControlFunction>());
+
+		m_lichtenberg = make_unique<const Noise<LichtenbergControlFunction> >(move(controlFunction), job.noiseTopLeft, job.noiseBottomRight, job.controlFunctionTopLeft, job.controlFunctionBottomRight, job.seed, job.eps, job.resolution, job.displacement, job.primitivesResolutionSteps, job.slopePower, job.noiseAmplitudeProportion, true, false, true, false, false);
+		m_memoryUsage += sizeof(Noise<LichtenbergControlFunction>);
+	}
+	else if (job.kind == "image")
+	{
+		assert(!controlImage.empty());
+
+		unique_ptr<ImageControlFunction> controlFunction(make_unique<ImageControlFunction>(controlImage));
+
+		m_image = make_unique<const Noise<ImageControlFunction> >(move(controlFunction), job.noiseTopLeft, job.noiseBottomRight, job.controlFunctionTopLeft, job.controlFunctionBottomRight, job.seed, job.eps, job.resolution, job.displacement, job.primitivesResolutionSteps, job.slopePower, job.noiseAmplitudeProportion, true, false, false, false, false);
+		// The first level of the pyramid is the control image itself, the other levels are a third of its size
+		m_memoryUsage += sizeof(Noise<ImageControlFunction>) + controlImage.total() * controlImage.elemSize() / 3;
+	}
+	else
+	{
+		unique_ptr<PerlinControlFunction> controlFunction(make_unique<PerlinControlFunction>());
+
+		m_terrain = make_unique<const Noise<PerlinControlFunction> >(move(controlFunction), job.noiseTopLeft, job.noiseBottomRight, job.controlFunctionTopLeft, job.controlFunctionBottomRight, job.seed, job.eps, job.resolution, job.displacement, job.primitivesResolutionSteps, job.slopePower, job.noiseAmplitudeProportion, true, false, false, false, false);
+		m_memoryUsage += sizeof(Noise<PerlinControlFunction>);
+	}
+}
+
+BatchEngine::~BatchEngine() = default;
+
+vector<vector<double> > BatchEngine::render(const BatchJob& job, int left, int top, int width, int height) const
+{
+	if (m_lichtenberg)
+	{
+		const Noise<LichtenbergControlFunction>& noise = *m_lichtenberg;
+
+		return RenderNoise(job, left, top, width, height, [&noise](double x, double y) { return noise.evaluateLichtenberg(x, y); });
+	}
+
+	if (m_image)
+	{
+		const Noise<ImageControlFunction>& noise = *m_image;
+
+		return RenderNoise(job, left, top, width, height, [&noise](double x, double y) { return noise.evaluateTerrain(x, y); });
+	}
+
+	const Noise<PerlinControlFunction>& noise = *m_terrain;
+
+	return RenderNoise(job, left, top, width, height, [&noise](double x, double y) { return noise.evaluateTerrain(x, y); });
+}
+
+std::size_t BatchEngine::memoryUsage() const
+{
+	return m_memoryUsage;
+}
+
+vector<vector<double> > RenderBatchRegion(const BatchJob& job, int left, int top, int width, int height)
+{
+	const cv::Mat controlImage = LoadBatchControlImage(job);
+	if (job.kind == "image" && controlImage.empty())
+	{
+		return vector<vector<double> >();
+	}
+
+	const BatchEngine engine(job, controlImage);
+
+	return engine.render(job, left, top, width, height);
+}
@@ -0,0 +1,151 @@
+#ifndef BATCHJOB_H
+#define BATCHJOB_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "math2d.h"
+
+template <typename I>
+class Noise;
+class PerlinControlFunction;
+class LichtenbergControlFunction;
+class ImageControlFunction;
+
+/**
+ * \brief A render of a batch, read from a line of a job file.
+ */
+struct BatchJob
+{
+	// "terrain", "lichtenberg" or "image"
+	std::string kind;
+	int width = 512;
+	int height = 512;
+	int seed = 0;
+	std::string filename;
+
+	int resolution = 2;
+	double eps = 0.25;
+	double displacement = 0.1;
+	int primitivesResolutionSteps = 3;
+	double slopePower = 0.5;
+	double noiseAmplitudeProportion = 0.05;
+	Point2D noiseTopLeft = Point2D(0.0, 0.0);
+	Point2D noiseBottomRight = Point2D(4.0, 4.0);
+	Point2D controlFunctionTopLeft = Point2D(-0.2, -0.4);
+	Point2D controlFunctionBottomRight = Point2D(1.4, 0.7);
+
+	// Control image of an image job, 8 or 16 bits gray levels
+	std::string controlImage;
+
+	// PNG compression level, -1 for the default of OpenCV
+	int compression = -1;
+};
+
+/**
+ * \brief Parse a job from a line of a job file:
+ *   kind width height seed output [key=value ...]
+ * \return False if the line is not a valid job
+ */
+bool ParseBatchJob(const std::string& line, BatchJob& job);
+
+/**
+ * \brief Read the jobs of a job file
+ * \return False if the file cannot be read or a job is invalid
+ */
+bool ReadBatchJobs(const std::string& jobsFilename, std::vector<BatchJob>& jobs);
+
+/**
+ * \brief Check whether the output of a job is a file of float elevations instead of an image.
+ */
+bool IsBatchHeightfield(const BatchJob& job);
+
+/**
+ * \brief Parameters of a job, except its size, seed and noise window.
+ * Doubles are written with all their digits, so two jobs have the same parameters only if their values are equal.
+ */
+std::string BatchJobParameters(const BatchJob& job);
+
+/**
+ * \brief Description of the noise of a job: its kind, seed, noise window and parameters, but not its size nor its output.
+ * Jobs with the same description share the same noise.
+ */
+std::string BatchNoiseDescription(const BatchJob& job);
+
+/**
+ * \brief Fingerprint of the raster of a job, shared by all its tiles
+ */
+uint64_t BatchJobFingerprint(const BatchJob& job);
+
+/**
+ * \brief Remap an elevation to a 16 bits gray level, the range of elevations is remapped to the whole range of gray levels
+ */
+uint16_t GrayLevel16(double value, double minimum, double maximum);
+
+/**
+ * \brief Write the float elevations of a job in the format given by the extension of its output
+ */
+bool WriteBatchHeightfield(const BatchJob& job, const cv::Mat& image);
+
+/**
+ * \brief Write elevations in the output of a job: float elevations for heightfield outputs,
+ * otherwise a 16 bits image remapped to the range of the elevations, inverted for Lichtenberg figures.
+ */
+bool WriteBatchOutput(const BatchJob& job, const std::vector<std::vector<double> >& values);
+
+/**
+ * \brief Decode the control image of an image job
+ * \return An empty image if the job is not an image job or the image cannot be read
+ */
+cv::Mat LoadBatchControlImage(const BatchJob& job);
+
+/**
+ * \brief Noise of a job, built once and used to render any rectangle of the raster of the job.
+ * Rendering is thread safe, so an engine can be shared by concurrent renders.
+ */
+class BatchEngine
+{
+public:
+	/**
+	 * \brief Build the noise of a job
+	 * \param job Job, only its description is used
+	 * \param controlImage Decoded control image of an image job, ignored by other jobs
+	 */
+	explicit BatchEngine(const BatchJob& job, const cv::Mat& controlImage = cv::Mat());
+	~BatchEngine();
+
+	BatchEngine(const BatchEngine&) = delete;
+	BatchEngine& operator=(const BatchEngine&) = delete;
+
+	/**
+	 * \brief Render a rectangle of the raster of a job.
+	 * The noise is built for the whole raster and each pixel is evaluated the same way whatever the rectangle,
+	 * so rectangles rendered separately, even in other processes, are exactly the pixels of the whole raster.
+	 * \param job Job with the same noise description as the engine, gives the size of the raster
+	 */
+	std::vector<std::vector<double> > render(const BatchJob& job, int left, int top, int width, int height) const;
+
+	/**
+	 * \brief Approximate memory used by the engine, including the pyramid of its control image
+	 */
+	std::size_t memoryUsage() const;
+
+private:
+	std::unique_ptr<const Noise<PerlinControlFunction> > m_terrain;
+	std::unique_ptr<const Noise<LichtenbergControlFunction> > m_lichtenberg;
+	std::unique_ptr<const Noise<ImageControlFunction> > m_image;
+
+	std::size_t m_memoryUsage;
+};
+
+/**
+ * \brief Render a rectangle of the raster of a job with a noise built for this render only
+ * \return No rows if the control image of an image job cannot be read
+ */
+std::vector<std::vector<double> > RenderBatchRegion(const BatchJob& job, int left, int top, int width, int height);
+
+#endif // BATCHJOB_H
@@ -1,33 +1,69 @@
 #include "examples.h"
+#include "imagewriter.h"
+#include "batchjob.h"
+#include "rastertile.h"
+#include "tilepyramid.h"
 
 #include <iostream>
 #include <iomanip>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <cassert>
 #include <chrono>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
 #include "noise.h"
+#include "chunkedterrain.h"
+#include "executor.h"
+#include "heightfieldwriter.h"
 #include "math2d.h"
 #include "utils.h"
 #include "perlincontrolfunction.h"
 #include "planecontrolfunction.h"
 #include "lichtenbergcontrolfunction.h"
 #include "imagecontrolfunction.h"
+#include "maskedcontrolfunction.h"
+#include "rawheightmapcontrolfunction.h"
 
 using namespace std;
 
+/**
+ * \brief Writer shared by the examples, an image is written while the next one is rendered.
+ */
+ImageWriter& SharedImageWriter()
+{
+	static ImageWriter writer;
+	return writer;
+}
+
+void WriteImage(const string& filename, const cv::Mat& image)
+{
+	SharedImageWriter().write(filename, image);
+}
+
+void WaitImages()
+{
+	SharedImageWriter().wait();
+}
+
 struct Progress
 {
 	const int totalSteps;
 	const int moduloSteps;
-	int completedSteps;
+	std::atomic<int> completedSteps;
 
 	/// <summary>
-	/// Construct a Progress object to monitor the progress in an OpenMP loop.
+	/// Construct a Progress object to monitor the progress in a parallel loop.
 	/// </summary>
 	/// <param name="totalSteps">The total number of steps in the loop</param>
 	/// <param name="numberDisplay">The number of times the progress is going to be displayed</param>
@@ -45,7 +81,6 @@ struct Progress
 	/// </summary>
 	void Update()
 	{
-#pragma omp atomic
 		++completedSteps;
 	}
 
@@ -55,10 +90,12 @@ struct Progress
 	/// </summary>
 	void Display() const
 	{
+		static std::mutex outputMutex;
+
 		// stepsCompleted may have changed, however it is not a big problem if the progress is not very precise.
 		if ((completedSteps % moduloSteps) == 0)
 		{
-#pragma omp critical
+			std::lock_guard<std::mutex> lock(outputMutex);
 			cout << "Progress: " << (100LLU * completedSteps / totalSteps) << " %\n";
 		}
 	}
@@ -75,8 +112,7 @@ cv::Mat SegmentImage(const Noise<I>& noise, const Point2D& a, const Point2D&b, i
 
 	cv::Mat image(height, width, CV_16U);
 
-#pragma omp parallel for shared(image)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelFor(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
 			const double x = remap(double(j), 0.0, double(width), a.x, b.x);
 			const double y = remap(double(i), 0.0, double(height), a.y, b.y);
@@ -85,7 +121,7 @@ cv::Mat SegmentImage(const Noise<I>& noise, const Point2D& a, const Point2D&b, i
 
 			image.at<uint16_t>(i, j) = uint16_t(value * numeric_limits<uint16_t>::max());
 		}
-	}
+	});
 
 	return image;
 }
@@ -93,15 +129,14 @@ cv::Mat SegmentImage(const Noise<I>& noise, const Point2D& a, const Point2D&b, i
 template<typename I>
 vector<vector<double> > EvaluateTerrain(const Noise<I>& noise, const Point2D& a, const Point2D&b, int width, int height)
 {
-	vector<vector<double> > values(height, vector<double>(width));
+	vector<vector<double> > values = AllocateRows<double>(height, width);
 
 	// Display progress 25 times.
 	Progress progress(width * height, 25);
 
 	// Measure execution time
 	const auto startTime = chrono::high_resolution_clock::now();
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelForStatic(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
 			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
 			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
@@ -111,7 +146,36 @@ vector<vector<double> > EvaluateTerrain(const Noise<I>& noise, const Point2D& a,
 			progress.Update();
 			progress.Display();
 		}
-	}
+	});
+	const auto endTime = chrono::high_resolution_clock::now();
+
+	// Execution time in ms
+	std::cout << "Execution time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
+
+	return values;
+}
+
+template<typename I>
+vector<vector<typename Noise<I>::Channels> > EvaluateTerrainChannels(const Noise<I>& noise, const Point2D& a, const Point2D& b, int width, int height, unsigned int channels)
+{
+	vector<vector<typename Noise<I>::Channels> > values = AllocateRows<typename Noise<I>::Channels>(height, width);
+
+	// Display progress 25 times.
+	Progress progress(width * height, 25);
+
+	// Measure execution time
+	const auto startTime = chrono::high_resolution_clock::now();
+	Executor::global().parallelForStatic(0, height, [&](int i) {
+		for (int j = 0; j < width; j++) {
+			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
+			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
+
+			values[i][j] = noise.evaluateTerrainChannels(x, y, channels);
+
+			progress.Update();
+			progress.Display();
+		}
+	});
 	const auto endTime = chrono::high_resolution_clock::now();
 
 	// Execution time in ms
@@ -123,15 +187,14 @@ vector<vector<double> > EvaluateTerrain(const Noise<I>& noise, const Point2D& a,
 template<typename I>
 vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I>& noise, const Point2D& a, const Point2D& b, int width, int height)
 {
-	vector<vector<double> > values(height, vector<double>(width));
+	vector<vector<double> > values = AllocateRows<double>(height, width);
 
 	// Display progress 25 times.
 	Progress progress(width * height, 25);
 
 	// Measure execution time
 	const auto startTime = chrono::high_resolution_clock::now();
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelForStatic(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
 			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
 			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
@@ -141,7 +204,36 @@ vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I>& noise, const P
 			progress.Update();
 			progress.Display();
 		}
-	}
+	});
+	const auto endTime = chrono::high_resolution_clock::now();
+
+	// Execution time in ms
+	std::cout << "Execution time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
+
+	return values;
+}
+
+template<typename I>
+vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I>& noise, const RiverNetwork& network, const Point2D& a, const Point2D& b, int width, int height)
+{
+	vector<vector<double> > values = AllocateRows<double>(height, width);
+
+	// Display progress 25 times.
+	Progress progress(width * height, 25);
+
+	// Measure execution time
+	const auto startTime = chrono::high_resolution_clock::now();
+	Executor::global().parallelForStatic(0, height, [&](int i) {
+		for (int j = 0; j < width; j++) {
+			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
+			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
+
+			values[i][j] = noise.evaluateLichtenberg(x, y, network);
+
+			progress.Update();
+			progress.Display();
+		}
+	});
 	const auto endTime = chrono::high_resolution_clock::now();
 
 	// Execution time in ms
@@ -153,17 +245,33 @@ vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I>& noise, const P
 template<typename I>
 vector<vector<double> > EvaluateLichtenbergFigureWithoutProgress(const Noise<I>& noise, const Point2D& a, const Point2D& b, int width, int height)
 {
-	vector<vector<double> > values(height, vector<double>(width));
+	vector<vector<double> > values = AllocateRows<double>(height, width);
 
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelForStatic(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
 			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
 			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
 
 			values[i][j] = noise.evaluateLichtenberg(x, y);
 		}
-	}
+	});
+
+	return values;
+}
+
+template<typename I>
+vector<vector<double> > EvaluateTerrainWithoutProgress(const Noise<I>& noise, const Point2D& a, const Point2D& b, int width, int height)
+{
+	vector<vector<double> > values = AllocateRows<double>(height, width);
+
+	Executor::global().parallelForStatic(0, height, [&](int i) {
+		for (int j = 0; j < width; j++) {
+			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
+			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
+
+			values[i][j] = noise.evaluateTerrain(x, y);
+		}
+	});
 
 	return values;
 }
@@ -171,25 +279,24 @@ vector<vector<double> > EvaluateLichtenbergFigureWithoutProgress(const Noise<I>&
 template<typename I>
 vector<vector<double> > EvaluateControlFunction(const ControlFunction<I>& controlFunction, const Point2D& a, const Point2D& b, int width, int height)
 {
-	vector<vector<double> > values(height, vector<double>(width));
+	vector<vector<double> > values = AllocateRows<double>(height, width);
 
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelForStatic(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
 			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
 			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
 
 			values[i][j] = controlFunction.evaluate(x, y);
 		}
-	}
+	});
 
 	return values;
 }
 
 cv::Mat GenerateImage(const vector<vector<double> > &values)
 {
-	const int width = int(values.size());
-	const int height = int(values.front().size());
+	const int height = int(values.size());
+	const int width = int(values.front().size());
 
 	// Find min and max to remap to 16 bits
 	double minimum = numeric_limits<double>::max();
@@ -204,14 +311,28 @@ cv::Mat GenerateImage(const vector<vector<double> > &values)
 	// Convert to 16 bits image
 	cv::Mat image(height, width, CV_16U);
 
-#pragma omp parallel for shared(image)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelForStatic(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
-			const double value = remap_clamp(values[i][j], minimum, maximum, 0.0, 65535.0);
+			image.at<uint16_t>(i, j) = GrayLevel16(values[i][j], minimum, maximum);
+		}
+	});
 
-			image.at<uint16_t>(i, j) = uint16_t(value);
+	return image;
+}
+
+cv::Mat GenerateFloatImage(const vector<vector<double> > &values)
+{
+	const int height = int(values.size());
+	const int width = int(values.front().size());
+
+	// Elevations are kept as they are, without remapping
+	cv::Mat image(height, width, CV_32F);
+
+	Executor::global().parallelForStatic(0, height, [&](int i) {
+		for (int j = 0; j < width; j++) {
+			image.at<float>(i, j) = float(values[i][j]);
 		}
-	}
+	});
 
 	return image;
 }
@@ -225,8 +346,8 @@ cv::Mat GenerateImageNegative(const vector<vector<double> > &values)
 
 cv::Mat GenerateImageMatlab(const vector<vector<double> > &values)
 {
-	const int width = int(values.size());
-	const int height = int(values.front().size());
+	const int height = int(values.size());
+	const int width = int(values.front().size());
 
 	// Find min and max to remap to 16 bits
 	double minimum = numeric_limits<double>::max();
@@ -241,8 +362,7 @@ cv::Mat GenerateImageMatlab(const vector<vector<double> > &values)
 	// Convert to 16 bits image
 	cv::Mat image(height, width, CV_8UC3);
 
-#pragma omp parallel for shared(image)
-	for (int i = 0; i < height; i++) {
+	Executor::global().parallelForStatic(0, height, [&](int i) {
 		for (int j = 0; j < width; j++) {
 			const std::array<double, 3> color = matlab_jet(1.0 - remap_clamp(values[i][j], minimum, maximum, 0.0, 1.0));
 
@@ -255,7 +375,7 @@ cv::Mat GenerateImageMatlab(const vector<vector<double> > &values)
 			// Red
 			pixel.val[2] = uint8_t(color[0] * std::numeric_limits<uint8_t>::max());
 		}
-	}
+	});
 
 	return image;
 }
@@ -269,7 +389,7 @@ void PerlinControlFunctionImage(int width, int height, const std::string& filena
 
 	const cv::Mat image = GenerateImage(EvaluateControlFunction(controlFunction, controlFunctionTopLeft, controlFunctionBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void LichtenbergControlFunctionImage(int width, int height, const std::string& filename)
@@ -281,7 +401,7 @@ void LichtenbergControlFunctionImage(int width, int height, const std::string& f
 
 	const cv::Mat image = GenerateImage(EvaluateControlFunction(controlFunction, controlFunctionTopLeft, controlFunctionBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void PerlinPlaneControlFunctionImage(int width, int height, const std::string& filename)
@@ -293,7 +413,7 @@ void PerlinPlaneControlFunctionImage(int width, int height, const std::string& f
 
 	const cv::Mat image = GenerateImage(EvaluateControlFunction(controlFunction, controlFunctionTopLeft, controlFunctionBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void SmallAmplificationImage(int width, int height, int seed, const string& input, const string& filename)
@@ -318,7 +438,7 @@ void SmallAmplificationImage(int width, int height, int seed, const string& inpu
 	// TODO: Random generator std::minstd_rand
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void BigAmplificationImage(int width, int height, int seed, const string& input, const string& filename)
@@ -343,7 +463,43 @@ void BigAmplificationImage(int width, int height, int seed, const string& input,
 	// TODO: Random generator std::minstd_rand
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
+}
+
+void BigAmplificationRawImage(int width, int height, int seed, const string& input, const string& raw, const string& filename)
+{
+	// Convert the input image to a tiled raw heightmap that is memory mapped by the control function
+	const auto inputImage = cv::imread(input, cv::ImreadModes::IMREAD_ANYDEPTH);
+	if (!RawHeightmapControlFunction::save(raw, inputImage, 256))
+	{
+		std::cerr << "Impossible to write the raw heightmap: " << raw << std::endl;
+		return;
+	}
+
+	typedef RawHeightmapControlFunction ControlFunctionType;
+	std::unique_ptr<ControlFunctionType> controlFunction(std::make_unique<ControlFunctionType>(raw));
+
+	if (!controlFunction->isOpen())
+	{
+		std::cerr << "Impossible to open the raw heightmap: " << raw << std::endl;
+		return;
+	}
+
+	const double eps = 0.10;
+	const int resolution = 1;
+	const double displacement = 0.05;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 0.75;
+	const double noiseAmplitudeProportion = 0.05;
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(16.0, 16.0);
+	const Point2D controlFunctionTopLeft(0.1, 0.1);
+	const Point2D controlFunctionBottomRight(0.9, 0.9);
+
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+
+	WriteImage(filename, image);
 }
 
 void EffectBetaTerrainImage(int width, int height, int seed, double beta, const string& filename)
@@ -366,10 +522,10 @@ void EffectBetaTerrainImage(int width, int height, int seed, double beta, const
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
-void TeaserFirstDistanceImage(int width, int height, int seed, const std::string& filename)
+void TeaserFirstImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename)
 {
 	typedef PerlinControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
@@ -385,14 +541,30 @@ void TeaserFirstDistanceImage(int width, int height, int seed, const std::string
 	const Point2D controlFunctionTopLeft(-0.2, -0.5);
 	const Point2D controlFunctionBottomRight(1.40, 0.7);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, false, false, true);
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageMatlab(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	// Both images come from the same evaluation of the noise
+	const auto channels = EvaluateTerrainChannels(noise, noiseTopLeft, noiseBottomRight, width, height, Noise<ControlFunctionType>::ChannelElevation | Noise<ControlFunctionType>::ChannelDistance);
+
+	vector<vector<double> > distances(height, vector<double>(width));
+	vector<vector<double> > elevations(height, vector<double>(width));
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			distances[i][j] = channels[i][j].distance;
+			elevations[i][j] = std::max(0.0, channels[i][j].elevation);
+		}
+	}
+
+	const cv::Mat distanceImage = GenerateImageMatlab(distances);
+	WriteImage(distanceFilename, distanceImage);
 
-	cv::imwrite(filename, image);
+	const cv::Mat terrainImage = GenerateImage(elevations);
+	WriteImage(terrainFilename, terrainImage);
 }
 
-void TeaserFirstTerrainImage(int width, int height, int seed, const std::string& filename)
+void TeaserFirstDistanceTransformImage(int width, int height, int seed, const std::string& filename)
 {
 	typedef PerlinControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
@@ -408,11 +580,18 @@ void TeaserFirstTerrainImage(int width, int height, int seed, const std::string&
 	const Point2D controlFunctionTopLeft(-0.2, -0.5);
 	const Point2D controlFunctionBottomRight(1.40, 0.7);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
-	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, false, false, true);
 
-	cv::imwrite(filename, image);
+	// Distances of the whole image in a single distance transform instead of a neighborhood search per pixel
+	const auto startTime = chrono::high_resolution_clock::now();
+	const RiverNetwork network = noise.bakeTerrainNetwork(noiseTopLeft, noiseBottomRight);
+	const vector<vector<double> > distances = noise.evaluateDistanceTile(network, noiseTopLeft, noiseBottomRight, width, height);
+	const auto endTime = chrono::high_resolution_clock::now();
+	std::cout << "Distance transform time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
+
+	const cv::Mat image = GenerateImageMatlab(distances);
+
+	WriteImage(filename, image);
 }
 
 void TeaserSecondDistanceImage(int width, int height, int seed, const std::string& filename)
@@ -435,7 +614,7 @@ void TeaserSecondDistanceImage(int width, int height, int seed, const std::strin
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImageMatlab(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void TeaserSecondTerrainImage(int width, int height, int seed, const string& filename)
@@ -458,7 +637,7 @@ void TeaserSecondTerrainImage(int width, int height, int seed, const string& fil
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void TeaserThirdDistanceImage(int width, int height, int seed, const std::string& filename)
@@ -481,7 +660,7 @@ void TeaserThirdDistanceImage(int width, int height, int seed, const std::string
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImageMatlab(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void TeaserThirdTerrainImage(int width, int height, int seed, const string& filename)
@@ -504,7 +683,7 @@ void TeaserThirdTerrainImage(int width, int height, int seed, const string& file
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void SketchSegmentsImage(int width, int height, int seed, const std::string& input, const std::string& filename)
@@ -529,7 +708,7 @@ void SketchSegmentsImage(int width, int height, int seed, const std::string& inp
 	// TODO: Random generator std::minstd_rand
 	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void SketchTerrainImage(int width, int height, int seed, const std::string& input, const std::string& filename)
@@ -554,7 +733,38 @@ void SketchTerrainImage(int width, int height, int seed, const std::string& inpu
 	// TODO: Random generator std::minstd_rand
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
+}
+
+void IslandTerrainImage(int width, int height, int seed, const std::string& filename)
+{
+	typedef MaskedControlFunction<PerlinControlFunction> ControlFunctionType;
+
+	const Point2D controlFunctionTopLeft(-0.2, -0.5);
+	const Point2D controlFunctionBottomRight(1.40, 0.7);
+
+	// Coastline of the island in the coordinates of the control function
+	const std::vector<Point2D> coastline = {
+		{ 0.00, -0.30 }, { 0.45, -0.42 }, { 0.90, -0.25 }, { 1.25, -0.35 },
+		{ 1.30, 0.10 }, { 1.05, 0.55 }, { 0.55, 0.40 }, { 0.20, 0.60 },
+		{ -0.10, 0.25 }
+	};
+	const auto mask = std::make_shared<const DomainMask>(coastline, controlFunctionTopLeft, controlFunctionBottomRight, 512, 512);
+	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>(make_unique<PerlinControlFunction>(), mask));
+
+	const double eps = 0.25;
+	const int resolution = 2;
+	const double displacement = 0.075;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 0.5;
+	const double noiseAmplitudeProportion = 0.05;
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(4.0, 4.0);
+
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+
+	WriteImage(filename, image);
 }
 
 void EvaluationTerrainImage(int width, int height, int seed, const string& filename)
@@ -577,7 +787,7 @@ void EvaluationTerrainImage(int width, int height, int seed, const string& filen
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void PerlinSegmentsImage(int width, int height, int seed, const std::string& filename)
@@ -600,7 +810,7 @@ void PerlinSegmentsImage(int width, int height, int seed, const std::string& fil
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void PerlinPlaneSegmentsImage(int width, int height, int seed, const std::string& filename)
@@ -623,7 +833,7 @@ void PerlinPlaneSegmentsImage(int width, int height, int seed, const std::string
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void PerlinPlaneTerrainImage(int width, int height, int seed, const std::string& filename)
@@ -646,7 +856,7 @@ void PerlinPlaneTerrainImage(int width, int height, int seed, const std::string&
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 void LichtenbergFigureImage(int width, int height, int seed, const string& filename)
@@ -675,7 +885,70 @@ void LichtenbergFigureImage(int width, int height, int seed, const string& filen
 	cv::Mat resized_image(height / antiAliasingLevel, width / antiAliasingLevel, CV_16U);
 	cv::resize(image, resized_image, resized_image.size(), 0.0, 0.0, cv::INTER_AREA);
 
-	cv::imwrite(filename, resized_image);
+	WriteImage(filename, resized_image);
+}
+
+void BakedLichtenbergFigureImages(int width, int height, int seed, const std::string& filename, const std::string& cropFilename)
+{
+	typedef LichtenbergControlFunction ControlFunctionType;
+	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+
+	const double eps = 0.1;
+	const int resolution = 6;
+	const double displacement = 0.05;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 1.0;
+	const double noiseAmplitudeProportion = 0.05;
+	const Point2D noiseTopLeft(-2.0, -2.0);
+	const Point2D noiseBottomRight(1.0, 1.0);
+	const Point2D controlFunctionTopLeft(-1.0, -1.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+	const Point2D cropTopLeft(-1.0, -1.0);
+	const Point2D cropBottomRight(0.0, 0.0);
+
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
+
+	// Bake the network once, both images are rendered from it
+	const auto startTime = chrono::high_resolution_clock::now();
+	const RiverNetwork network = noise.bakeLichtenbergNetwork(noiseTopLeft, noiseBottomRight);
+	const auto endTime = chrono::high_resolution_clock::now();
+	std::cout << "Baking time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
+
+	const cv::Mat image = GenerateImageNegative(EvaluateLichtenbergFigure(noise, network, noiseTopLeft, noiseBottomRight, width, height));
+	WriteImage(filename, image);
+
+	const cv::Mat cropImage = GenerateImageNegative(EvaluateLichtenbergFigure(noise, network, cropTopLeft, cropBottomRight, width, height));
+	WriteImage(cropFilename, cropImage);
+}
+
+void SplattedLichtenbergFigureImage(int width, int height, int seed, const std::string& filename)
+{
+	typedef LichtenbergControlFunction ControlFunctionType;
+	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+
+	const double eps = 0.1;
+	const int resolution = 6;
+	const double displacement = 0.05;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 1.0;
+	const double noiseAmplitudeProportion = 0.05;
+	const Point2D noiseTopLeft(-2.0, -2.0);
+	const Point2D noiseBottomRight(1.0, 1.0);
+	const Point2D controlFunctionTopLeft(-1.0, -1.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
+
+	// Segments are splatted in the image instead of being searched for by each pixel
+	const auto startTime = chrono::high_resolution_clock::now();
+	const RiverNetwork network = noise.bakeLichtenbergNetwork(noiseTopLeft, noiseBottomRight);
+	const vector<vector<double> > values = noise.evaluateLichtenbergTile(network, noiseTopLeft, noiseBottomRight, width, height);
+	const auto endTime = chrono::high_resolution_clock::now();
+	std::cout << "Execution time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
+
+	const cv::Mat image = GenerateImageNegative(values);
+
+	WriteImage(filename, image);
 }
 
 void EffectParametersImage(int width, int height, int seed, int resolution, double eps, double displacement, const std::string& filename)
@@ -695,7 +968,7 @@ void EffectParametersImage(int width, int height, int seed, int resolution, doub
 	// TODO: Random generator std::mt19937_64
 	const cv::Mat image = GenerateImageNegative(EvaluateLichtenbergFigure(noise, noiseTopLeft, noiseBottomRight, width, height));
 
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 }
 
 double PerformanceTest(int width, int height, const std::string& filename)
@@ -724,8 +997,470 @@ double PerformanceTest(int width, int height, const std::string& filename)
 
 	// Save the image for comparison to a reference
 	const cv::Mat image = GenerateImage(result);
-	cv::imwrite(filename, image);
+	WriteImage(filename, image);
 
 	// Execution time in ms
 	return chrono::duration<double, milli>(endTime - startTime).count();
 }
+
+double FirstTouchBenchmark(int width, int height, int passes, bool firstTouch)
+{
+	const PerlinControlFunction controlFunction;
+	const Point2D controlFunctionTopLeft(-0.2, -0.5);
+	const Point2D controlFunctionBottomRight(1.40, 0.7);
+
+	// The control function is cheap to evaluate, so that the time spent in memory accesses is significant
+	const auto renderRow = [&](vector<double>& row, int i) {
+		for (int j = 0; j < width; j++) {
+			const double x = remap_clamp(double(j), 0.0, double(width), controlFunctionTopLeft.x, controlFunctionBottomRight.x);
+			const double y = remap_clamp(double(i), 0.0, double(height), controlFunctionTopLeft.y, controlFunctionBottomRight.y);
+
+			row[j] = controlFunction.evaluate(x, y);
+		}
+	};
+
+	// Remap the elevations in place, like a post-processing of the heightfield
+	const auto remapRow = [width](vector<double>& row) {
+		for (int j = 0; j < width; j++) {
+			row[j] = 0.5 * row[j] + 0.25;
+		}
+	};
+
+	Executor& executor = Executor::global();
+
+	// Measure execution time
+	const auto startTime = chrono::high_resolution_clock::now();
+	if (firstTouch)
+	{
+		vector<vector<double> > values = AllocateRows<double>(height, width);
+
+		executor.parallelForStatic(0, height, [&](int i) { renderRow(values[i], i); });
+		for (int pass = 0; pass < passes; pass++)
+		{
+			executor.parallelForStatic(0, height, [&](int i) { remapRow(values[i]); });
+		}
+	}
+	else
+	{
+		vector<vector<double> > values(height, vector<double>(width));
+
+		executor.parallelFor(0, height, [&](int i) { renderRow(values[i], i); });
+		for (int pass = 0; pass < passes; pass++)
+		{
+			executor.parallelFor(0, height, [&](int i) { remapRow(values[i]); });
+		}
+	}
+	const auto endTime = chrono::high_resolution_clock::now();
+
+	// Execution time in ms
+	return chrono::duration<double, milli>(endTime - startTime).count();
+}
+
+void StreamingTerrainWalk(int seed, int frames, const std::string& filename)
+{
+	ChunkedTerrain<PerlinControlFunction>::Configuration configuration;
+	configuration.seed = seed;
+
+	ChunkedTerrain<PerlinControlFunction> terrain([]() { return make_unique<PerlinControlFunction>(); }, configuration);
+
+	// The viewer crosses a chunk in 25 frames
+	const double frameTime = 1000.0 / 60.0;
+	const Vec2D movement(0.01, 0.004);
+	Point2D position(0.1, 0.1);
+
+	for (int frame = 0; frame < frames; frame++)
+	{
+		const auto frameStart = chrono::high_resolution_clock::now();
+
+		terrain.prefetch(position, movement, 0);
+
+		const int x = int(floor(position.x / terrain.chunkSize(0)));
+		const int y = int(floor(position.y / terrain.chunkSize(0)));
+		terrain.getChunk(x, y, 0);
+
+		position.x += movement.x;
+		position.y += movement.y;
+
+		// The rest of the frame is left to the prefetch
+		this_thread::sleep_until(frameStart + chrono::duration<double, milli>(frameTime));
+	}
+
+	const ChunkedTerrain<PerlinControlFunction>::Statistics statistics = terrain.statistics();
+	std::cout << "Chunks from the cache: " << statistics.hits << ", rendered on demand: " << statistics.misses << ", prefetched: " << statistics.prefetched << std::endl;
+	std::cout << "Longest wait for a chunk: " << std::fixed << std::setprecision(2) << statistics.maximumLatency << " ms, " << statistics.overBudget << " over the frame budget" << std::endl;
+
+	// Chunks around the viewer, assembled without seams
+	const int x = int(floor(position.x / terrain.chunkSize(0)));
+	const int y = int(floor(position.y / terrain.chunkSize(0)));
+	const int samples = configuration.chunkSamples;
+
+	vector<vector<double> > values(3 * samples, vector<double>(3 * samples));
+	for (int cy = 0; cy < 3; cy++)
+	{
+		for (int cx = 0; cx < 3; cx++)
+		{
+			const shared_ptr<const ChunkedTerrain<PerlinControlFunction>::Chunk> chunk = terrain.getChunk(x + cx - 1, y + cy - 1, 0);
+
+			for (int i = 0; i < samples; i++)
+			{
+				copy(chunk->elevations[i].begin(), chunk->elevations[i].end(), values[cy * samples + i].begin() + cx * samples);
+			}
+		}
+	}
+
+	WriteImage(filename, GenerateImage(values));
+}
+
+/**
+ * \brief Tiles of the raster of a job, numbered row by row
+ */
+struct BatchTiling
+{
+	int tileSize;
+	int rasterWidth;
+	int rasterHeight;
+	int tilesX;
+	int tilesY;
+
+	BatchTiling(const BatchJob& job, int size) :
+		tileSize(size),
+		rasterWidth(job.width),
+		rasterHeight(job.height),
+		tilesX((job.width + size - 1) / size),
+		tilesY((job.height + size - 1) / size)
+	{
+	}
+
+	int tiles() const
+	{
+		return tilesX * tilesY;
+	}
+
+	int left(int tile) const
+	{
+		return (tile % tilesX) * tileSize;
+	}
+
+	int top(int tile) const
+	{
+		return (tile / tilesX) * tileSize;
+	}
+
+	// Tiles of the last column and of the last row are cut by the raster
+	int width(int tile) const
+	{
+		return std::min(tileSize, rasterWidth - left(tile));
+	}
+
+	int height(int tile) const
+	{
+		return std::min(tileSize, rasterHeight - top(tile));
+	}
+
+	/**
+	 * \brief Check that the header of a tile file is the one of a tile of this tiling, for the job with this fingerprint
+	 */
+	bool matches(const RasterTileHeader& header, int tile, uint64_t fingerprint) const
+	{
+		return header.fingerprint == fingerprint
+			&& int(header.rasterWidth) == rasterWidth && int(header.rasterHeight) == rasterHeight
+			&& int(header.left) == left(tile) && int(header.top) == top(tile)
+			&& int(header.width) == width(tile) && int(header.height) == height(tile);
+	}
+};
+
+string BatchTileFilename(const BatchJob& job, int tile)
+{
+	return job.filename + "." + to_string(tile) + ".tile";
+}
+
+int BatchRender(const std::string& jobsFilename)
+{
+	vector<BatchJob> jobs;
+	if (!ReadBatchJobs(jobsFilename, jobs))
+	{
+		return 1;
+	}
+
+	bool success = true;
+	long long totalPixels = 0;
+
+	// The image of a job is encoded and written while the next one is computed.
+	// Only one image waits to be written, so memory does not grow with the number of jobs.
+	ImageWriter writer(1, 1);
+	vector<future<bool> > written;
+
+	const auto batchStartTime = chrono::high_resolution_clock::now();
+	for (size_t k = 0; k < jobs.size(); k++)
+	{
+		const BatchJob& job = jobs[k];
+
+		const auto startTime = chrono::high_resolution_clock::now();
+		const vector<vector<double> > values = RenderBatchRegion(job, 0, 0, job.width, job.height);
+		const auto endTime = chrono::high_resolution_clock::now();
+
+		if (values.empty())
+		{
+			std::cerr << "Cannot read the control image " << job.controlImage << std::endl;
+			success = false;
+			continue;
+		}
+
+		const double time = chrono::duration<double, milli>(endTime - startTime).count();
+		const long long pixels = (long long)job.width * job.height;
+		totalPixels += pixels;
+
+		std::cout << "Job " << k + 1 << "/" << jobs.size() << ": " << job.filename << " in " << std::fixed << std::setprecision(2) << time << " ms, " << pixels / (1000.0 * time) << " Mpixels/s" << std::endl;
+
+		if (IsBatchHeightfield(job))
+		{
+			if (!WriteBatchHeightfield(job, GenerateFloatImage(values)))
+			{
+				std::cerr << "Cannot write the heightfield " << job.filename << std::endl;
+				success = false;
+			}
+		}
+		else
+		{
+			const cv::Mat image = (job.kind == "lichtenberg") ? GenerateImageNegative(values) : GenerateImage(values);
+			written.push_back(writer.write(job.filename, image, job.compression));
+		}
+	}
+
+	for (future<bool>& w : written)
+	{
+		success = w.get() && success;
+	}
+	const auto batchEndTime = chrono::high_resolution_clock::now();
+
+	const double batchTime = chrono::duration<double, milli>(batchEndTime - batchStartTime).count();
+	std::cout << "Batch: " << jobs.size() << " jobs in " << std::fixed << std::setprecision(2) << batchTime << " ms, " << totalPixels / (1000.0 * batchTime) << " Mpixels/s" << std::endl;
+
+	if (!success)
+	{
+		std::cerr << "Some images could not be written" << std::endl;
+	}
+
+	return success ? 0 : 1;
+}
+
+int RenderBatchTiles(const std::string& jobsFilename, int tileSize, int firstTile, int lastTile)
+{
+	vector<BatchJob> jobs;
+	if (!ReadBatchJobs(jobsFilename, jobs) || tileSize <= 0)
+	{
+		return 1;
+	}
+
+	bool success = true;
+
+	for (const BatchJob& job : jobs)
+	{
+		const BatchTiling tiling(job, tileSize);
+		const uint64_t fingerprint = BatchJobFingerprint(job);
+
+		const int first = std::max(firstTile, 0);
+		const int last = std::min(lastTile, tiling.tiles() - 1);
+		if (first > last)
+		{
+			continue;
+		}
+
+		// The control image is decoded and the noise is built once for all the tiles of the job
+		const cv::Mat controlImage = LoadBatchControlImage(job);
+		if (job.kind == "image" && controlImage.empty())
+		{
+			std::cerr << "Cannot read the control image " << job.controlImage << std::endl;
+			success = false;
+			continue;
+		}
+
+		const BatchEngine engine(job, controlImage);
+
+		for (int tile = first; tile <= last; tile++)
+		{
+			const int left = tiling.left(tile);
+			const int top = tiling.top(tile);
+			const int width = tiling.width(tile);
+			const int height = tiling.height(tile);
+
+			const auto startTime = chrono::high_resolution_clock::now();
+			const vector<vector<double> > values = engine.render(job, left, top, width, height);
+			const auto endTime = chrono::high_resolution_clock::now();
+
+			const string filename = BatchTileFilename(job, tile);
+			if (!SaveRasterTile(filename, fingerprint, job.width, job.height, left, top, values))
+			{
+				std::cerr << "Cannot write the tile " << filename << std::endl;
+				success = false;
+			}
+
+			const double time = chrono::duration<double, milli>(endTime - startTime).count();
+			std::cout << "Tile " << tile + 1 << "/" << tiling.tiles() << ": " << filename << " in " << std::fixed << std::setprecision(2) << time << " ms" << std::endl;
+		}
+	}
+
+	return success ? 0 : 1;
+}
+
+int StitchBatchTiles(const std::string& jobsFilename, int tileSize)
+{
+	vector<BatchJob> jobs;
+	if (!ReadBatchJobs(jobsFilename, jobs) || tileSize <= 0)
+	{
+		return 1;
+	}
+
+	bool success = true;
+
+	for (const BatchJob& job : jobs)
+	{
+		const BatchTiling tiling(job, tileSize);
+		const uint64_t fingerprint = BatchJobFingerprint(job);
+
+		// The global range comes from the headers of the tiles, so that tiles are read only once to build the image
+		double minimum = numeric_limits<double>::max();
+		double maximum = numeric_limits<double>::lowest();
+		bool complete = true;
+		for (int tile = 0; tile < tiling.tiles(); tile++)
+		{
+			const string filename = BatchTileFilename(job, tile);
+
+			RasterTileHeader header;
+			if (!LoadRasterTileHeader(filename, header) || !tiling.matches(header, tile, fingerprint))
+			{
+				std::cerr << "Missing or invalid tile " << filename << std::endl;
+				complete = false;
+				continue;
+			}
+
+			minimum = min(minimum, header.minimum);
+			maximum = max(maximum, header.maximum);
+		}
+
+		if (!complete)
+		{
+			success = false;
+			continue;
+		}
+
+		std::cout << job.filename << ": " << tiling.tiles() << " tiles, elevations from " << minimum << " to " << maximum << std::endl;
+
+		// Same conversions as the whole raster rendered by BatchRender
+		const bool heightfield = IsBatchHeightfield(job);
+		cv::Mat image(job.height, job.width, heightfield ? CV_32F : CV_16U);
+		for (int tile = 0; tile < tiling.tiles() && complete; tile++)
+		{
+			// The tile may have been written again since its header was read
+			RasterTile rasterTile;
+			if (!LoadRasterTile(BatchTileFilename(job, tile), rasterTile) || !tiling.matches(rasterTile.header, tile, fingerprint))
+			{
+				std::cerr << "Cannot read the tile " << BatchTileFilename(job, tile) << std::endl;
+				complete = false;
+				break;
+			}
+
+			const RasterTileHeader& header = rasterTile.header;
+			for (int i = 0; i < int(header.height); i++) {
+				for (int j = 0; j < int(header.width); j++) {
+					const double value = rasterTile.values[std::size_t(i) * header.width + j];
+
+					if (heightfield)
+					{
+						image.at<float>(header.top + i, header.left + j) = float(value);
+					}
+					else
+					{
+						image.at<uint16_t>(header.top + i, header.left + j) = GrayLevel16(value, minimum, maximum);
+					}
+				}
+			}
+		}
+
+		if (!complete)
+		{
+			success = false;
+		}
+		else if (heightfield)
+		{
+			if (!WriteBatchHeightfield(job, image))
+			{
+				std::cerr << "Cannot write the heightfield " << job.filename << std::endl;
+				success = false;
+			}
+		}
+		else
+		{
+			if (job.kind == "lichtenberg")
+			{
+				cv::bitwise_not(image, image);
+			}
+
+			vector<int> parameters;
+			if (job.compression >= 0)
+			{
+				parameters = { cv::IMWRITE_PNG_COMPRESSION, job.compression };
+			}
+
+			if (!cv::imwrite(job.filename, image, parameters))
+			{
+				std::cerr << "Cannot write the image " << job.filename << std::endl;
+				success = false;
+			}
+		}
+	}
+
+	return success ? 0 : 1;
+}
+
+int BuildBatchTilePyramids(const std::string& jobsFilename, int zooms)
+{
+	// BuildTilePyramid only asserts the number of zoom levels
+	if (zooms <= 0 || zooms > MAX_PYRAMID_ZOOMS)
+	{
+		std::cerr << "The number of zoom levels must be between 1 and " << MAX_PYRAMID_ZOOMS << std::endl;
+		return 1;
+	}
+
+	vector<BatchJob> jobs;
+	if (!ReadBatchJobs(jobsFilename, jobs))
+	{
+		return 1;
+	}
+
+	bool success = true;
+
+	for (const BatchJob& job : jobs)
+	{
+		const unique_ptr<TilePyramidStore> store = OpenTilePyramidStore(job, zooms);
+		if (!store)
+		{
+			std::cerr << "Cannot create the pyramid " << job.filename << std::endl;
+			success = false;
+			continue;
+		}
+
+		const auto startTime = chrono::high_resolution_clock::now();
+		vector<TilePyramidZoom> statistics;
+		const bool built = BuildTilePyramid(job, zooms, *store, statistics);
+		const auto endTime = chrono::high_resolution_clock::now();
+
+		if (!built)
+		{
+			std::cerr << "Cannot build the pyramid " << job.filename << std::endl;
+			success = false;
+			continue;
+		}
+
+		const double time = chrono::duration<double, milli>(endTime - startTime).count();
+		std::cout << job.filename << ": " << zooms << " zoom levels in " << std::fixed << std::setprecision(2) << time << " ms" << std::endl;
+
+		for (int zoom = 0; zoom < zooms; zoom++)
+		{
+			const TilePyramidZoom& z = statistics[zoom];
+			std::cout << "  Zoom " << zoom << ": " << z.tiles << " tiles with " << z.levels << " levels, bake " << z.bakeTime << " ms, evaluation " << z.evaluationTime << " ms" << std::endl;
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -3,6 +3,11 @@
 
 #include <string>
 
+/**
+ * \brief Wait for the images of the examples, which are written in the background, to be written.
+ */
+void WaitImages();
+
 void PerlinControlFunctionImage(int width, int height, const std::string& filename);
 
 void LichtenbergControlFunctionImage(int width, int height, const std::string& filename);
@@ -13,11 +18,19 @@ void SmallAmplificationImage(int width, int height, int seed, const std::string&
 
 void BigAmplificationImage(int width, int height, int seed, const std::string& input, const std::string& filename);
 
+void BigAmplificationRawImage(int width, int height, int seed, const std::string& input, const std::string& raw, const std::string& filename);
+
 void EffectBetaTerrainImage(int width, int height, int seed, double beta, const std::string& filename);
 
-void TeaserFirstDistanceImage(int width, int height, int seed, const std::string& filename);
+/**
+ * \brief Render the distance and the terrain of the teaser 1 from a single evaluation of the noise.
+ */
+void TeaserFirstImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename);
 
-void TeaserFirstTerrainImage(int width, int height, int seed, const std::string& filename);
+/**
+ * \brief Same as the distance image of TeaserFirstImages, with the distances computed by a distance transform over a baked network.
+ */
+void TeaserFirstDistanceTransformImage(int width, int height, int seed, const std::string& filename);
 
 void TeaserSecondDistanceImage(int width, int height, int seed, const std::string& filename);
 
@@ -31,6 +44,8 @@ void SketchSegmentsImage(int width, int height, int seed, const std::string& inp
 
 void SketchTerrainImage(int width, int height, int seed, const std::string& input, const std::string& filename);
 
+void IslandTerrainImage(int width, int height, int seed, const std::string& filename);
+
 void EvaluationTerrainImage(int width, int height, int seed, const std::string& filename);
 
 void PerlinSegmentsImage(int width, int height, int seed, const std::string& filename);
@@ -41,6 +56,16 @@ void PerlinPlaneTerrainImage(int width, int height, int seed, const std::string&
 
 void LichtenbergFigureImage(int width, int height, int seed, const std::string& filename);
 
+/**
+ * \brief Bake the network of a Lichtenberg figure once, then render the whole figure and a crop from it.
+ */
+void BakedLichtenbergFigureImages(int width, int height, int seed, const std::string& filename, const std::string& cropFilename);
+
+/**
+ * \brief Render a Lichtenberg figure by splatting the segments of a baked network in the image.
+ */
+void SplattedLichtenbergFigureImage(int width, int height, int seed, const std::string& filename);
+
 void EffectParametersImage(int width, int height, int seed, int resolution, double eps, double displacement, const std::string& filename);
 
 /**
@@ -62,4 +87,85 @@ void EffectParametersImage(int width, int height, int seed, int resolution, doub
  */
 double PerformanceTest(int width, int height, const std::string& filename);
 
+/**
+ * \brief Measure the effect of the placement in memory of the rows of a heightfield on its rendering and post-processing.
+ * With first touch, rows are allocated by the threads rendering them and each row is always processed by the same thread.
+ * Otherwise, rows are allocated by the calling thread and given to any thread.
+ * On a NUMA machine, threads should be pinned with NOISE_PIN_THREADS=1. On a single node, both should take the same time.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param passes Number of passes over the whole heightfield after its rendering
+ * \param firstTouch True to allocate the rows from the threads processing them
+ * \return The time taken in ms.
+ */
+double FirstTouchBenchmark(int width, int height, int passes, bool firstTouch);
+
+/**
+ * \brief Walk over an infinite terrain streamed in chunks, as a viewer moving at a constant speed at 60 frames per second.
+ * Each frame, the chunks ahead of the viewer are prefetched and the chunk under the viewer is requested.
+ * The hits of the chunk cache and the longest wait for a chunk are printed, then the chunks around the viewer are saved.
+ * \param seed Seed of the terrain
+ * \param frames Number of frames of the walk
+ * \param filename File in which the chunks around the viewer are saved
+ */
+void StreamingTerrainWalk(int seed, int frames, const std::string& filename);
+
+/**
+ * \brief Render the jobs of a job file one after the other, writing each image while the next one is computed.
+ * Each line of the file is a job, empty lines and lines starting with # are ignored:
+ *   kind width height seed output [key=value ...]
+ * where kind is terrain, lichtenberg or image and the optional keys are resolution, eps, displacement, steps, beta,
+ * amplitude, compression (PNG level from 0 to 9), noise=x0,y0,x1,y1, control=x0,y0,x1,y1 and image (control image of an image job,
+ * required). Defaults are the ones of EvaluationTerrainImage, EffectParametersImage and SmallAmplificationImage. For example:
+ *   terrain 512 512 3 evaluation_terrain_3.png
+ *   lichtenberg 512 512 5 effect_epsilon_0.png eps=0 displacement=0
+ *   image 512 512 1 amplification_small_result.png image=../Images/amplification_small.png
+ * The extension of the output selects its format: .f32 for raw float32 elevations, .npy for a NumPy array,
+ * .raw for a tiled heightfield with the bounds, seed and parameters in its header, any other for an image.
+ * Time and throughput are printed for each job and for the whole batch.
+ * \param jobsFilename Job file
+ * \return 0 if all the images were rendered and written, 1 otherwise.
+ */
+int BatchRender(const std::string& jobsFilename);
+
+/**
+ * \brief Render some tiles of the jobs of a job file, so that a job can be split between several processes or machines.
+ * The raster of a job is split in tiles of tileSize x tileSize pixels numbered row by row from 0, and the tiles from firstTile
+ * to lastTile of each job are rendered. A tile is written next to the output of its job as output.<tile>.tile, with the
+ * fingerprint of the job, its rectangle and the range of its elevations. For example, with four processes:
+ *   Noise tiles jobs.txt 256 0 15
+ *   Noise tiles jobs.txt 256 16 31
+ *   ...
+ * \param jobsFilename Job file
+ * \param tileSize Size of the tiles in pixels
+ * \param firstTile First tile rendered
+ * \param lastTile Last tile rendered, included
+ * \return 0 if all the tiles were rendered and written, 1 otherwise.
+ */
+int RenderBatchTiles(const std::string& jobsFilename, int tileSize, int firstTile, int lastTile);
+
+/**
+ * \brief Assemble the tiles rendered by RenderBatchTiles into the outputs of the jobs of a job file.
+ * Tiles must have been rendered with the same job file and tile size, tiles that are missing or come from another job are reported.
+ * Images are normalized with the range of elevations of all the tiles, so the outputs are the ones of BatchRender.
+ * \param jobsFilename Job file
+ * \param tileSize Size of the tiles in pixels
+ * \return 0 if all the outputs were assembled and written, 1 otherwise.
+ */
+int StitchBatchTiles(const std::string& jobsFilename, int tileSize);
+
+/**
+ * \brief Build the quadtree tile pyramid of each job of a job file, see BuildTilePyramid.
+ * The zoom level 0 is one tile covering the noise window of the job, the raster of the job gives the size of every tile,
+ * and the resolution of the job is the largest number of levels, used by the zoom levels whose pixels are small enough.
+ * The output of a job is the store of its pyramid: a single file if it ends with .pyramid, otherwise a directory
+ * of tiles output/zoom/x/y.npy. For example:
+ *   terrain 256 256 3 terrain.pyramid resolution=4
+ *   Noise pyramid jobs.txt 6
+ * \param jobsFilename Job file
+ * \param zooms Number of zoom levels of the pyramids
+ * \return 0 if all the pyramids were built, 1 otherwise.
+ */
+int BuildBatchTilePyramids(const std::string& jobsFilename, int zooms);
+
 #endif // EXAMPLES_H
\ No newline at end of file
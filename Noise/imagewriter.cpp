@@ -0,0 +1,105 @@
+#include "imagewriter.h"
+
+#include <iostream>
+#include <cassert>
+
+#include <opencv2/highgui/highgui.hpp>
+
+ImageWriter::ImageWriter(int threads, int capacity) : m_capacity(capacity)
+{
+	assert(threads > 0);
+	assert(capacity > 0);
+
+	for (int i = 0; i < threads; i++)
+	{
+		m_threads.emplace_back(&ImageWriter::Run, this);
+	}
+}
+
+ImageWriter::~ImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_queued.notify_all();
+
+	// Threads finish the queued tasks before they stop
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+std::future<bool> ImageWriter::write(const std::string& filename, const cv::Mat& image, int compression)
+{
+	Task task;
+	task.filename = filename;
+	task.image = image;
+	if (compression >= 0)
+	{
+		task.parameters = { cv::IMWRITE_PNG_COMPRESSION, compression };
+	}
+
+	std::future<bool> written = task.written.get_future();
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this]() { return m_tasks.size() < m_capacity; });
+		m_tasks.push_back(std::move(task));
+	}
+	m_queued.notify_one();
+
+	return written;
+}
+
+void ImageWriter::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_tasks.empty() && m_running == 0; });
+}
+
+void ImageWriter::Run()
+{
+	while (true)
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queued.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+			if (m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			m_running++;
+		}
+		m_done.notify_all();
+
+		bool written = false;
+		try
+		{
+			written = cv::imwrite(task.filename, task.image, task.parameters);
+		}
+		catch (const cv::Exception& exception)
+		{
+			std::cerr << exception.what() << std::endl;
+		}
+
+		if (!written)
+		{
+			std::cerr << "Cannot write the image " << task.filename << std::endl;
+		}
+		task.written.set_value(written);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running--;
+		}
+		m_done.notify_all();
+	}
+}
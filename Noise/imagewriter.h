@@ -0,0 +1,78 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * \brief Encode and write images on background threads, so that compression overlaps with rendering.
+ * Images wait in a bounded queue: when it is full, write blocks until a thread is available,
+ * which limits the memory used by images waiting to be written.
+ */
+class ImageWriter
+{
+public:
+	/**
+	 * \brief Start the threads of the writer.
+	 * \param threads Number of images encoded at the same time
+	 * \param capacity Number of images waiting in the queue before write blocks
+	 */
+	explicit ImageWriter(int threads = 1, int capacity = 2);
+
+	/**
+	 * \brief Wait for all the images to be written, then stop the threads.
+	 */
+	~ImageWriter();
+
+	ImageWriter(const ImageWriter&) = delete;
+	ImageWriter& operator=(const ImageWriter&) = delete;
+
+	/**
+	 * \brief Queue an image to be written. The image must not be modified until it is written.
+	 * \param filename File in which the image is written, the extension gives the format
+	 * \param image Image to write
+	 * \param compression PNG compression level from 0 (fastest) to 9 (smallest), -1 for the default of OpenCV
+	 * \return A future set to true when the image is written, false if it could not be written.
+	 */
+	std::future<bool> write(const std::string& filename, const cv::Mat& image, int compression = -1);
+
+	/**
+	 * \brief Wait for all the queued images to be written.
+	 */
+	void wait();
+
+private:
+	struct Task
+	{
+		std::string filename;
+		cv::Mat image;
+		std::vector<int> parameters;
+		std::promise<bool> written;
+	};
+
+	void Run();
+
+	const std::size_t m_capacity;
+
+	std::mutex m_mutex;
+	// Signaled when a task is queued or when the writer stops
+	std::condition_variable m_queued;
+	// Signaled when a task is taken from the queue or is finished
+	std::condition_variable m_done;
+
+	std::deque<Task> m_tasks;
+	// Number of tasks taken from the queue and not finished yet
+	int m_running = 0;
+	bool m_stop = false;
+
+	std::vector<std::thread> m_threads;
+};
+
+#endif // IMAGEWRITER_H
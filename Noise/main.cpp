@@ -1,18 +1,159 @@
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
+#include <string>
 
 #include "examples.h"
+#include "renderserver.h"
 
 using namespace std;
 
 int main(int argc, char* argv[])
 {
+	// Render some tiles of the jobs of a job file
+	if (argc == 6 && string(argv[1]) == "tiles")
+	{
+		return RenderBatchTiles(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+	}
+
+	// Assemble the tiles of the jobs of a job file
+	if (argc == 4 && string(argv[1]) == "stitch")
+	{
+		return StitchBatchTiles(argv[2], atoi(argv[3]));
+	}
+
+	// Build the tile pyramids of the jobs of a job file
+	if (argc == 4 && string(argv[1]) == "pyramid")
+	{
+		return BuildBatchTilePyramids(argv[2], atoi(argv[3]));
+	}
+
+	// Serve render requests on a Unix socket, with a memory budget in MB
+	if ((argc == 3 || argc == 4) && string(argv[1]) == "serve")
+	{
+		const std::size_t budget = (argc == 4) ? std::size_t(atoll(argv[3])) : 1024;
+
+		RenderServer server(budget * 1024 * 1024);
+		return server.run(argv[2]);
+	}
+
+	// Compare rows first touched by the calling thread and by the rendering threads
+	if (argc == 2 && string(argv[1]) == "firsttouch")
+	{
+		std::cout << "First touch benchmark" << std::endl;
+		const int FIRST_TOUCH_WIDTH = 4096;
+		const int FIRST_TOUCH_HEIGHT = 4096;
+		const int FIRST_TOUCH_PASSES = 10;
+		std::cout << "Rows allocated by the calling thread: " << FirstTouchBenchmark(FIRST_TOUCH_WIDTH, FIRST_TOUCH_HEIGHT, FIRST_TOUCH_PASSES, false) << " ms" << std::endl;
+		std::cout << "Rows allocated by the rendering threads: " << FirstTouchBenchmark(FIRST_TOUCH_WIDTH, FIRST_TOUCH_HEIGHT, FIRST_TOUCH_PASSES, true) << " ms" << std::endl;
+
+		return 0;
+	}
+
+	// Walk over an infinite terrain streamed in chunks
+	if (argc == 2 && string(argv[1]) == "stream")
+	{
+		std::cout << "Streaming of an infinite terrain in chunks" << std::endl;
+		const int STREAMING_SEED = 0;
+		const int STREAMING_FRAMES = 300;
+		const string STREAMING_OUTPUT = "streaming_terrain.png";
+		StreamingTerrainWalk(STREAMING_SEED, STREAMING_FRAMES, STREAMING_OUTPUT);
+
+		WaitImages();
+
+		return 0;
+	}
+
+	// Amplify the big terrain from a raw heightmap mapped in memory, the figure of the paper reads the PNG
+	if (argc == 2 && string(argv[1]) == "rawamplification")
+	{
+		std::cout << "Amplification of a big terrain from a memory mapped raw heightmap" << std::endl;
+		const int BIG_AMP_WIDTH = 256;
+		const int BIG_AMP_HEIGHT = 256;
+		const int BIG_AMP_SEED = 0;
+		const string BIG_AMP_INPUT = "../Images/amplification_big.png";
+		const string BIG_AMP_RAW = "amplification_big.raw";
+		const string BIG_AMP_RAW_OUTPUT = "amplification_big_raw_result.png";
+		BigAmplificationRawImage(BIG_AMP_WIDTH, BIG_AMP_HEIGHT, BIG_AMP_SEED, BIG_AMP_INPUT, BIG_AMP_RAW, BIG_AMP_RAW_OUTPUT);
+
+		WaitImages();
+
+		return 0;
+	}
+
+	// Island terrain whose domain is bounded by a coastline mask
+	if (argc == 2 && string(argv[1]) == "island")
+	{
+		std::cout << "Procedural generation of an island terrain with a coastline mask" << std::endl;
+		const int ISLAND_TERRAIN_WIDTH = 512;
+		const int ISLAND_TERRAIN_HEIGHT = 512;
+		const int ISLAND_TERRAIN_SEED = 0;
+		const string ISLAND_TERRAIN_OUTPUT = "island_terrain.png";
+		IslandTerrainImage(ISLAND_TERRAIN_WIDTH, ISLAND_TERRAIN_HEIGHT, ISLAND_TERRAIN_SEED, ISLAND_TERRAIN_OUTPUT);
+
+		WaitImages();
+
+		return 0;
+	}
+
+	// Lichtenberg figure and a crop of it evaluated from a baked network
+	if (argc == 2 && string(argv[1]) == "bakedlichtenberg")
+	{
+		std::cout << "Procedural generation of a Lichtenberg figure and a crop from a baked network" << std::endl;
+		const int BAKED_LICHTENBERG_WIDTH = 1024;
+		const int BAKED_LICHTENBERG_HEIGHT = 1024;
+		const int BAKED_LICHTENBERG_SEED = 33058;
+		const string BAKED_LICHTENBERG_OUTPUT = "lichtenberg_baked.png";
+		const string BAKED_LICHTENBERG_CROP_OUTPUT = "lichtenberg_baked_crop.png";
+		BakedLichtenbergFigureImages(BAKED_LICHTENBERG_WIDTH, BAKED_LICHTENBERG_HEIGHT, BAKED_LICHTENBERG_SEED, BAKED_LICHTENBERG_OUTPUT, BAKED_LICHTENBERG_CROP_OUTPUT);
+
+		WaitImages();
+
+		return 0;
+	}
+
+	// Distance to the river network of the teaser 1 terrain found by a distance transform
+	if (argc == 2 && string(argv[1]) == "distancetransform")
+	{
+		std::cout << "Procedural generation of the teaser 1 distance by a distance transform" << std::endl;
+		const int TEASER_1_TERRAIN_WIDTH = 512;
+		const int TEASER_1_TERRAIN_HEIGHT = 512;
+		const int TEASER_1_TERRAIN_SEED = 0;
+		const string TEASER_1_DISTANCE_TRANSFORM_OUTPUT = "teaser_1_distance_transform.png";
+		TeaserFirstDistanceTransformImage(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_DISTANCE_TRANSFORM_OUTPUT);
+
+		WaitImages();
+
+		return 0;
+	}
+
+	// Lichtenberg figure whose segments are splatted instead of gathered by every pixel
+	if (argc == 2 && string(argv[1]) == "splattedlichtenberg")
+	{
+		std::cout << "Procedural generation of a Lichtenberg figure by splatting segments" << std::endl;
+		const int SPLATTED_LICHTENBERG_WIDTH = 8192;
+		const int SPLATTED_LICHTENBERG_HEIGHT = 8192;
+		const int SPLATTED_LICHTENBERG_SEED = 33058;
+		const string SPLATTED_LICHTENBERG_OUTPUT = "lichtenberg_splatted.png";
+		SplattedLichtenbergFigureImage(SPLATTED_LICHTENBERG_WIDTH, SPLATTED_LICHTENBERG_HEIGHT, SPLATTED_LICHTENBERG_SEED, SPLATTED_LICHTENBERG_OUTPUT);
+
+		WaitImages();
+
+		return 0;
+	}
+
+	// Render the jobs of a job file instead of the figures
+	if (argc > 1)
+	{
+		return BatchRender(argv[1]);
+	}
+
 	std::cout << "Performance Test" << std::endl;
 	const int PERFORMANCE_WIDTH = 1024;
 	const int PERFORMANCE_HEIGHT = 1024;
 	const string PERFORMANCE_OUTPUT = "performance_test.png";
 	std::cout << std::fixed << std::setprecision(2) << PerformanceTest(PERFORMANCE_WIDTH, PERFORMANCE_HEIGHT, PERFORMANCE_OUTPUT) << std::endl;
-	
+
 	const int CONTROL_FUNCTION_WIDTH = 512;
 	const int CONTROL_FUNCTION_HEIGHT = 512;
 	
@@ -68,8 +209,7 @@ int main(int argc, char* argv[])
 	const int TEASER_1_TERRAIN_SEED = 0;
 	const string TEASER_1_DISTANCE_OUTPUT = "teaser_1_distance.png";
 	const string TEASER_1_TERRAIN_OUTPUT = "teaser_1_terrain.png";
-	TeaserFirstDistanceImage(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_DISTANCE_OUTPUT);
-	TeaserFirstTerrainImage(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_TERRAIN_OUTPUT);
+	TeaserFirstImages(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_DISTANCE_OUTPUT, TEASER_1_TERRAIN_OUTPUT);
 
 	std::cout << "Procedural generation of the teaser 2 terrain" << std::endl;
 	const int TEASER_2_TERRAIN_WIDTH = 768;
@@ -190,5 +330,7 @@ int main(int argc, char* argv[])
 		EffectParametersImage(EFFECT_WIDTH, EFFECT_HEIGHT, EFFECT_DEFAULT_SEED, EFFECT_DEFAULT_RESOLUTION, EFFECT_DEFAULT_EPSILON, delta, filename);
 	}
 	
+	WaitImages();
+
 	return 0;
 }
@@ -0,0 +1,116 @@
+#include "rastertile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+	const char RASTER_TILE_MAGIC[4] = { 'D', 'T', 'I', 'L' };
+	const uint32_t RASTER_TILE_VERSION = 1;
+
+	bool ValidHeader(const RasterTileHeader& header)
+	{
+		// Bounds are checked in 64 bits so that a corrupted left or top cannot wrap around
+		return std::memcmp(header.magic, RASTER_TILE_MAGIC, sizeof(RASTER_TILE_MAGIC)) == 0
+			&& header.version == RASTER_TILE_VERSION
+			&& uint64_t(header.left) + header.width <= header.rasterWidth
+			&& uint64_t(header.top) + header.height <= header.rasterHeight;
+	}
+
+	// Check that the file holds exactly the elevations announced by the header, read just before
+	bool ValidPayload(std::ifstream& file, const RasterTileHeader& header)
+	{
+		const std::streampos payloadStart = file.tellg();
+		file.seekg(0, std::ios::end);
+		const std::streampos fileEnd = file.tellg();
+		file.seekg(payloadStart);
+
+		if (!file || fileEnd < payloadStart)
+		{
+			return false;
+		}
+
+		// Compared in number of elevations, width * height * sizeof(double) could overflow
+		const uint64_t payloadBytes = uint64_t(fileEnd - payloadStart);
+		return payloadBytes % sizeof(double) == 0
+			&& payloadBytes / sizeof(double) == uint64_t(header.width) * header.height;
+	}
+}
+
+uint64_t RasterFingerprint(const std::string& description)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char c : description)
+	{
+		hash ^= uint64_t(uint8_t(c));
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+bool SaveRasterTile(const std::string& filename, uint64_t fingerprint, int rasterWidth, int rasterHeight, int left, int top, const std::vector<std::vector<double> >& values)
+{
+	RasterTileHeader header = {};
+	std::memcpy(header.magic, RASTER_TILE_MAGIC, sizeof(RASTER_TILE_MAGIC));
+	header.version = RASTER_TILE_VERSION;
+	header.fingerprint = fingerprint;
+	header.rasterWidth = uint32_t(rasterWidth);
+	header.rasterHeight = uint32_t(rasterHeight);
+	header.left = uint32_t(left);
+	header.top = uint32_t(top);
+	header.height = uint32_t(values.size());
+	header.width = values.empty() ? 0 : uint32_t(values.front().size());
+	header.minimum = std::numeric_limits<double>::max();
+	header.maximum = std::numeric_limits<double>::lowest();
+
+	for (const std::vector<double>& row : values)
+	{
+		for (const double value : row)
+		{
+			header.minimum = std::min(header.minimum, value);
+			header.maximum = std::max(header.maximum, value);
+		}
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const std::vector<double>& row : values)
+	{
+		file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size() * sizeof(double)));
+	}
+
+	return bool(file);
+}
+
+bool LoadRasterTileHeader(const std::string& filename, RasterTileHeader& header)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		return false;
+	}
+
+	return ValidHeader(header) && ValidPayload(file, header);
+}
+
+bool LoadRasterTile(const std::string& filename, RasterTile& tile)
+{
+	std::ifstream file(filename, std::ios::binary);
+	// The size of the elevations is checked before allocating them
+	if (!file.read(reinterpret_cast<char*>(&tile.header), sizeof(tile.header)) || !ValidHeader(tile.header) || !ValidPayload(file, tile.header))
+	{
+		return false;
+	}
+
+	tile.values.resize(std::size_t(tile.header.width) * tile.header.height);
+
+	return bool(file.read(reinterpret_cast<char*>(tile.values.data()), std::streamsize(tile.values.size() * sizeof(double))));
+}
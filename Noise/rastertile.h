@@ -0,0 +1,74 @@
+#ifndef RASTERTILE_H
+#define RASTERTILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Header of a tile file, a rectangle of the elevations of a raster rendered on its own.
+ * Elevations are stored as doubles after the header, row by row, so that tiles assembled together
+ * are exactly the elevations of the whole raster.
+ */
+struct RasterTileHeader
+{
+	char magic[4];
+	uint32_t version;
+	// Fingerprint of the parameters of the raster, tiles of different rasters cannot be assembled
+	uint64_t fingerprint;
+	// Size of the whole raster
+	uint32_t rasterWidth;
+	uint32_t rasterHeight;
+	// Rectangle of the tile in the raster
+	uint32_t left;
+	uint32_t top;
+	uint32_t width;
+	uint32_t height;
+	// Range of the elevations of the tile
+	double minimum;
+	double maximum;
+};
+
+static_assert(sizeof(RasterTileHeader) == 56, "The raster tile header should be 56 bytes long.");
+
+/**
+ * \brief Tile of a raster
+ */
+struct RasterTile
+{
+	RasterTileHeader header;
+	// Elevations row by row
+	std::vector<double> values;
+};
+
+/**
+ * \brief Fingerprint of the description of a raster, FNV-1a hash of the text
+ */
+uint64_t RasterFingerprint(const std::string& description);
+
+/**
+ * \brief Write a tile of a raster
+ * \param filename File of the tile
+ * \param fingerprint Fingerprint of the raster
+ * \param rasterWidth Width of the whole raster
+ * \param rasterHeight Height of the whole raster
+ * \param left Column of the tile in the raster
+ * \param top Row of the tile in the raster
+ * \param values Elevations of the tile
+ * \return True if the tile is written
+ */
+bool SaveRasterTile(const std::string& filename, uint64_t fingerprint, int rasterWidth, int rasterHeight, int left, int top, const std::vector<std::vector<double> >& values);
+
+/**
+ * \brief Read the header of a tile without its elevations
+ * \return True if the file is a valid tile
+ */
+bool LoadRasterTileHeader(const std::string& filename, RasterTileHeader& header);
+
+/**
+ * \brief Read a tile
+ * \return True if the file is a valid tile
+ */
+bool LoadRasterTile(const std::string& filename, RasterTile& tile);
+
+#endif // RASTERTILE_H
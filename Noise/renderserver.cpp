@@ -0,0 +1,540 @@
+#include "renderserver.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define NOISE_UNIX_SOCKETS
+#endif
+
+using namespace std;
+
+namespace
+{
+	bool ParseRegion(const string& value, int& left, int& top, int& width, int& height)
+	{
+		char c1, c2, c3;
+		istringstream stream(value);
+		stream >> left >> c1 >> top >> c2 >> width >> c3 >> height;
+
+		return !stream.fail() && c1 == ',' && c2 == ',' && c3 == ',';
+	}
+
+	string TileKey(const BatchJob& job, int tileX, int tileY)
+	{
+		return "tile " + to_string(tileX) + "," + to_string(tileY) + " " + to_string(job.width) + "x" + to_string(job.height) + " " + BatchNoiseDescription(job);
+	}
+}
+
+RenderServer::RenderServer(std::size_t memoryBudget) :
+	m_memoryBudget(memoryBudget),
+	m_residentBytes(0),
+	m_generation(0),
+	m_hits(0),
+	m_misses(0),
+	m_evictions(0),
+	m_stopping(false)
+{
+}
+
+RenderServer::Reservation RenderServer::Reserve(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Reservation reservation;
+	reservation.key = key;
+
+	const auto it = m_residents.find(key);
+	if (it != m_residents.end())
+	{
+		// Most recently used
+		m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+		m_hits++;
+
+		reservation.value = it->second.value;
+		reservation.generation = it->second.generation;
+
+		return reservation;
+	}
+
+	m_misses++;
+
+	reservation.promise = make_shared<promise<Value> >();
+	reservation.value = reservation.promise->get_future().share();
+	reservation.generation = ++m_generation;
+
+	m_recent.push_front(key);
+
+	Resident resident;
+	resident.value = reservation.value;
+	resident.bytes = 0;
+	resident.generation = reservation.generation;
+	resident.recent = m_recent.begin();
+
+	// A key in the list of recent keys is always resident, even if the insertion fails
+	try
+	{
+		m_residents.emplace(key, resident);
+	}
+	catch (...)
+	{
+		m_recent.pop_front();
+		throw;
+	}
+
+	return reservation;
+}
+
+void RenderServer::Fulfil(Reservation& reservation, const Value& value, std::size_t bytes)
+{
+	assert(reservation.promise);
+
+	reservation.promise->set_value(value);
+	reservation.promise.reset();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// The key may have been evicted while its value was built
+	const auto it = m_residents.find(reservation.key);
+	if (it == m_residents.end() || it->second.generation != reservation.generation)
+	{
+		return;
+	}
+
+	// Values that could not be built are not kept, the next request tries again
+	if (!value)
+	{
+		m_recent.erase(it->second.recent);
+		m_residents.erase(it);
+		return;
+	}
+
+	it->second.bytes = bytes;
+	m_residentBytes += bytes;
+
+	Evict();
+}
+
+void RenderServer::Evict()
+{
+	while (m_residentBytes > m_memoryBudget && !m_recent.empty())
+	{
+		const auto it = m_residents.find(m_recent.back());
+		assert(it != m_residents.end());
+
+		// Requests using the value keep it until they are done
+		m_residentBytes -= it->second.bytes;
+		m_residents.erase(it);
+		m_recent.pop_back();
+		m_evictions++;
+	}
+}
+
+std::string RenderServer::handle(const std::string& request)
+{
+	istringstream stream(request);
+
+	// Remove the region, the rest is a job
+	int left = 0;
+	int top = 0;
+	int width = -1;
+	int height = -1;
+	string job;
+	string token;
+	while (stream >> token)
+	{
+		if (token.compare(0, 7, "region=") == 0)
+		{
+			if (!ParseRegion(token.substr(7), left, top, width, height))
+			{
+				return "error Invalid region " + token;
+			}
+		}
+		else
+		{
+			job += (job.empty() ? "" : " ") + token;
+		}
+	}
+
+	if (job == "stats")
+	{
+		return Statistics();
+	}
+
+	if (job == "shutdown")
+	{
+		Stop();
+		return "ok";
+	}
+
+	BatchJob batchJob;
+	if (!ParseBatchJob(job, batchJob))
+	{
+		return "error Invalid job " + job;
+	}
+
+	if (width < 0)
+	{
+		width = batchJob.width;
+		height = batchJob.height;
+	}
+
+	// Summed in 64 bits, a large region could overflow
+	if (left < 0 || top < 0 || width <= 0 || height <= 0 || (long long)left + width > batchJob.width || (long long)top + height > batchJob.height)
+	{
+		return "error The region is not in the raster of the job";
+	}
+
+	// The region is allocated as a whole before it is written
+	if ((long long)width * height > MAXIMUM_REGION_PIXELS)
+	{
+		return "error The region is larger than " + to_string(MAXIMUM_REGION_PIXELS) + " pixels";
+	}
+
+	return Render(batchJob, left, top, width, height);
+}
+
+std::string RenderServer::Render(const BatchJob& job, int left, int top, int width, int height)
+{
+	// Keys reserved by this request, they are fulfilled even if the render fails so that other requests do not wait for them forever
+	Reservation image;
+	Reservation engineReservation;
+	vector<Reservation> tiles;
+
+	try
+	{
+		return RenderRegion(job, left, top, width, height, image, engineReservation, tiles);
+	}
+	catch (const exception& exception)
+	{
+		// Unbuilt values are removed from the cache, the requests waiting for them get an error
+		if (image.promise)
+		{
+			Fulfil(image, nullptr, 0);
+		}
+		if (engineReservation.promise)
+		{
+			Fulfil(engineReservation, nullptr, 0);
+		}
+		for (Reservation& tile : tiles)
+		{
+			if (tile.promise)
+			{
+				Fulfil(tile, nullptr, 0);
+			}
+		}
+
+		return string("error Cannot render ") + job.filename + ": " + exception.what();
+	}
+}
+
+std::string RenderServer::RenderRegion(const BatchJob& job, int left, int top, int width, int height, Reservation& image, Reservation& engineReservation, std::vector<Reservation>& tiles)
+{
+	const auto startTime = chrono::high_resolution_clock::now();
+
+	// Control image, decoded once for all the engines using it
+	cv::Mat controlImage;
+	if (job.kind == "image")
+	{
+		image = Reserve("image " + job.controlImage);
+		if (image.promise)
+		{
+			const cv::Mat decoded = LoadBatchControlImage(job);
+			Fulfil(image, decoded.empty() ? nullptr : make_shared<const cv::Mat>(decoded), decoded.total() * decoded.elemSize());
+		}
+
+		const shared_ptr<const cv::Mat> decoded = static_pointer_cast<const cv::Mat>(image.value.get());
+		if (!decoded)
+		{
+			return "error Cannot read the control image " + job.controlImage;
+		}
+
+		controlImage = *decoded;
+	}
+
+	// Engine, shared by all the jobs with the same noise whatever their size and output
+	engineReservation = Reserve("engine " + BatchNoiseDescription(job));
+	if (engineReservation.promise)
+	{
+		const shared_ptr<const BatchEngine> engine = make_shared<const BatchEngine>(job, controlImage);
+		Fulfil(engineReservation, engine, engine->memoryUsage());
+	}
+
+	const shared_ptr<const BatchEngine> engine = static_pointer_cast<const BatchEngine>(engineReservation.value.get());
+	if (!engine)
+	{
+		return "error Cannot build the noise of " + job.filename;
+	}
+
+	// Tiles covering the region, the ones not built nor being built by another request are rendered by this one
+	const int firstTileX = left / TILE_SIZE;
+	const int firstTileY = top / TILE_SIZE;
+	const int lastTileX = (left + width - 1) / TILE_SIZE;
+	const int lastTileY = (top + height - 1) / TILE_SIZE;
+	const int tilesX = lastTileX - firstTileX + 1;
+
+	// Reserved before the keys, so that every reserved key is in the list
+	tiles.reserve(size_t(tilesX) * (lastTileY - firstTileY + 1));
+	for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+	{
+		for (int tileX = firstTileX; tileX <= lastTileX; tileX++)
+		{
+			tiles.push_back(Reserve(TileKey(job, tileX, tileY)));
+		}
+	}
+
+	int rendered = 0;
+	for (size_t k = 0; k < tiles.size(); k++)
+	{
+		if (!tiles[k].promise)
+		{
+			continue;
+		}
+
+		const int tileLeft = (firstTileX + int(k) % tilesX) * TILE_SIZE;
+		const int tileTop = (firstTileY + int(k) / tilesX) * TILE_SIZE;
+		const int tileWidth = min(TILE_SIZE, job.width - tileLeft);
+		const int tileHeight = min(TILE_SIZE, job.height - tileTop);
+
+		const vector<vector<double> > rows = engine->render(job, tileLeft, tileTop, tileWidth, tileHeight);
+
+		const shared_ptr<vector<double> > values = make_shared<vector<double> >();
+		values->reserve(size_t(tileWidth) * tileHeight);
+		for (const vector<double>& row : rows)
+		{
+			values->insert(values->end(), row.begin(), row.end());
+		}
+
+		Fulfil(tiles[k], values, values->size() * sizeof(double));
+		rendered++;
+	}
+
+	// Copy the region from the tiles, waiting for the tiles rendered by other requests
+	vector<vector<double> > values(height, vector<double>(width));
+	for (size_t k = 0; k < tiles.size(); k++)
+	{
+		const shared_ptr<const vector<double> > tile = static_pointer_cast<const vector<double> >(tiles[k].value.get());
+
+		// The request rendering the tile failed
+		if (!tile)
+		{
+			return "error A tile of " + job.filename + " could not be rendered";
+		}
+
+		const int tileLeft = (firstTileX + int(k) % tilesX) * TILE_SIZE;
+		const int tileTop = (firstTileY + int(k) / tilesX) * TILE_SIZE;
+		const int tileWidth = min(TILE_SIZE, job.width - tileLeft);
+
+		const int firstRow = max(top, tileTop);
+		const int lastRow = min(top + height, tileTop + TILE_SIZE);
+		const int firstColumn = max(left, tileLeft);
+		const int lastColumn = min(left + width, tileLeft + TILE_SIZE);
+
+		for (int i = firstRow; i < lastRow; i++)
+		{
+			const double* source = tile->data() + size_t(i - tileTop) * tileWidth + (firstColumn - tileLeft);
+			copy(source, source + (lastColumn - firstColumn), values[i - top].begin() + (firstColumn - left));
+		}
+	}
+
+	if (!WriteBatchOutput(job, values))
+	{
+		return "error Cannot write " + job.filename;
+	}
+
+	const auto endTime = chrono::high_resolution_clock::now();
+	const double time = chrono::duration<double, milli>(endTime - startTime).count();
+
+	ostringstream answer;
+	answer << "ok " << fixed << setprecision(2) << time << " " << rendered << "/" << tiles.size();
+
+	return answer.str();
+}
+
+std::string RenderServer::Statistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ostringstream answer;
+	answer << "ok resident=" << m_residentBytes << " budget=" << m_memoryBudget << " entries=" << m_residents.size()
+	       << " hits=" << m_hits << " misses=" << m_misses << " evictions=" << m_evictions;
+
+	return answer.str();
+}
+
+#ifdef NOISE_UNIX_SOCKETS
+
+int RenderServer::run(const std::string& socketPath)
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "The path of the socket is too long: " << socketPath << std::endl;
+		return 1;
+	}
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+	{
+		std::cerr << "Cannot create the socket " << socketPath << std::endl;
+		return 1;
+	}
+
+	// Socket left by a previous server
+	unlink(socketPath.c_str());
+
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+	{
+		std::cerr << "Cannot listen on the socket " << socketPath << std::endl;
+		close(listener);
+		return 1;
+	}
+
+	// Clients disconnecting before reading their answer must not stop the server
+	signal(SIGPIPE, SIG_IGN);
+
+	m_socketPath = socketPath;
+	std::cout << "Listening on " << socketPath << " with a budget of " << m_memoryBudget / (1024 * 1024) << " MB" << std::endl;
+
+	while (!m_stopping)
+	{
+		const int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0)
+		{
+			continue;
+		}
+
+		if (m_stopping)
+		{
+			close(connection);
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_connectionsMutex);
+			m_connections.insert(connection);
+		}
+
+		thread(&RenderServer::Serve, this, connection).detach();
+	}
+
+	close(listener);
+	unlink(socketPath.c_str());
+
+	// Clients get the answer of their current request, then are disconnected
+	std::unique_lock<std::mutex> lock(m_connectionsMutex);
+	for (const int connection : m_connections)
+	{
+		shutdown(connection, SHUT_RD);
+	}
+	m_connectionsClosed.wait(lock, [this]() { return m_connections.empty(); });
+
+	return 0;
+}
+
+void RenderServer::Serve(int connection)
+{
+	string buffer;
+	char data[4096];
+
+	while (!m_stopping)
+	{
+		const ssize_t received = recv(connection, data, sizeof(data), 0);
+		if (received <= 0)
+		{
+			break;
+		}
+		buffer.append(data, size_t(received));
+
+		// Answer each complete line
+		size_t end;
+		while ((end = buffer.find('\n')) != string::npos)
+		{
+			string request = buffer.substr(0, end);
+			buffer.erase(0, end + 1);
+
+			if (!request.empty() && request.back() == '\r')
+			{
+				request.pop_back();
+			}
+
+			// An error, even a failed allocation, is answered to the client instead of stopping the server
+			string answer;
+			try
+			{
+				answer = handle(request) + "\n";
+			}
+			catch (const exception& exception)
+			{
+				answer = string("error ") + exception.what() + "\n";
+			}
+			for (size_t sent = 0; sent < answer.size();)
+			{
+				const ssize_t written = send(connection, answer.data() + sent, answer.size() - sent, 0);
+				if (written <= 0)
+				{
+					break;
+				}
+				sent += size_t(written);
+			}
+		}
+	}
+
+	close(connection);
+
+	std::lock_guard<std::mutex> lock(m_connectionsMutex);
+	m_connections.erase(connection);
+	m_connectionsClosed.notify_all();
+}
+
+void RenderServer::Stop()
+{
+	if (m_stopping.exchange(true))
+	{
+		return;
+	}
+
+	// Wake up the server waiting for a client
+	const int wake = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (wake >= 0)
+	{
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, m_socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+		connect(wake, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		close(wake);
+	}
+}
+
+#else
+
+int RenderServer::run(const std::string& socketPath)
+{
+	std::cerr << "The render server needs Unix sockets, it cannot listen on " << socketPath << std::endl;
+	return 1;
+}
+
+void RenderServer::Serve(int)
+{
+}
+
+void RenderServer::Stop()
+{
+	m_stopping = true;
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef RENDERSERVER_H
+#define RENDERSERVER_H
+
+#include <cstdint>
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "batchjob.h"
+
+/**
+ * \brief Local render server, rendering jobs received on a Unix socket.
+ * Unlike a run of the executable per job, the server keeps what it builds between requests: decoded control images,
+ * engines (the noise of a job) and rendered tiles of rasters. They are evicted, least recently used first,
+ * when their memory exceeds a budget.
+ *
+ * A client sends one request per line and receives one line per request:
+ *   kind width height seed output [key=value ...] [region=left,top,width,height]
+ * is a job of a job file (see BatchRender), rendered in the region of its raster (the whole raster by default) and
+ * written to output, relative to the working directory of the server. The answer is "ok <time in ms> <rendered tiles>/<tiles>"
+ * or "error <message>". "stats" answers the memory and the hits of the caches, "shutdown" stops the server.
+ *
+ * Rasters are rendered in tiles of TILE_SIZE pixels aligned on the raster. Concurrent requests for overlapping regions
+ * share their tiles: a tile is rendered by the first request needing it, the other requests wait for it.
+ */
+class RenderServer
+{
+public:
+	/**
+	 * \brief Size of the tiles of the rasters in pixels
+	 */
+	static constexpr int TILE_SIZE = 64;
+
+	/**
+	 * \brief Maximum number of pixels of the region of a request, the region is allocated at once (8 bytes per pixel)
+	 */
+	static constexpr long long MAXIMUM_REGION_PIXELS = 1LL << 28;
+
+	/**
+	 * \param memoryBudget Memory in bytes of the control images, engines and tiles kept between requests
+	 */
+	explicit RenderServer(std::size_t memoryBudget);
+
+	RenderServer(const RenderServer&) = delete;
+	RenderServer& operator=(const RenderServer&) = delete;
+
+	/**
+	 * \brief Listen on a Unix socket and serve each client on its own thread until a shutdown request
+	 * \param socketPath Path of the socket, replaced if it exists
+	 * \return 0 if the server stopped on a shutdown request, 1 if it could not listen.
+	 */
+	int run(const std::string& socketPath);
+
+	/**
+	 * \brief Answer a request line, without its end of line
+	 */
+	std::string handle(const std::string& request);
+
+private:
+	typedef std::shared_ptr<const void> Value;
+
+	/**
+	 * \brief Control image, engine or tile kept in memory, or being built by a request
+	 */
+	struct Resident
+	{
+		std::shared_future<Value> value;
+		std::size_t bytes;
+		// Identifies the reservation building the value
+		uint64_t generation;
+		// Position in the list of keys from the most to the least recently used
+		std::list<std::string>::iterator recent;
+	};
+
+	/**
+	 * \brief Value of a key, with the promise of the value if the request reserving it must build it
+	 */
+	struct Reservation
+	{
+		std::string key;
+		std::shared_future<Value> value;
+		std::shared_ptr<std::promise<Value> > promise;
+		uint64_t generation;
+	};
+
+	/**
+	 * \brief Find the value of a key, or reserve the key if no request has built or is building its value.
+	 * The request reserving a key must fulfil it.
+	 */
+	Reservation Reserve(const std::string& key);
+
+	/**
+	 * \brief Give its value to a reserved key, and wake up the requests waiting for it
+	 * \param value Value, nullptr if it could not be built
+	 * \param bytes Memory of the value
+	 */
+	void Fulfil(Reservation& reservation, const Value& value, std::size_t bytes);
+
+	/**
+	 * \brief Evict the least recently used values until the memory is within the budget. The mutex must be locked.
+	 */
+	void Evict();
+
+	/**
+	 * \brief Render a region of the raster of a job and write it to the output of the job.
+	 * If the render throws, the keys reserved by the request are fulfilled without a value and an error is answered.
+	 */
+	std::string Render(const BatchJob& job, int left, int top, int width, int height);
+
+	/**
+	 * \brief Body of Render, each key is stored in image, engineReservation or tiles as soon as it is reserved
+	 */
+	std::string RenderRegion(const BatchJob& job, int left, int top, int width, int height, Reservation& image, Reservation& engineReservation, std::vector<Reservation>& tiles);
+
+	std::string Statistics();
+
+	/**
+	 * \brief Answer the requests of a client until it disconnects or the server stops
+	 */
+	void Serve(int connection);
+
+	/**
+	 * \brief Stop accepting clients, and disconnect the clients once their current request is answered
+	 */
+	void Stop();
+
+	const std::size_t m_memoryBudget;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, Resident> m_residents;
+	std::list<std::string> m_recent;
+	std::size_t m_residentBytes;
+	uint64_t m_generation;
+	long long m_hits;
+	long long m_misses;
+	long long m_evictions;
+
+	std::string m_socketPath;
+	std::atomic<bool> m_stopping;
+	std::mutex m_connectionsMutex;
+	std::condition_variable m_connectionsClosed;
+	std::unordered_set<int> m_connections;
+};
+
+#endif // RENDERSERVER_H
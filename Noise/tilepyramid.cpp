@@ -0,0 +1,373 @@
+#include "tilepyramid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+
+#include <opencv2/core/core.hpp>
+
+#include "noise.h"
+#include "heightfieldwriter.h"
+#include "perlincontrolfunction.h"
+#include "lichtenbergcontrolfunction.h"
+#include "imagecontrolfunction.h"
+
+using namespace std;
+
+namespace
+{
+	const char TILE_PYRAMID_MAGIC[4] = { 'D', 'P', 'Y', 'R' };
+	const uint32_t TILE_PYRAMID_VERSION = 1;
+
+	bool EndsWith(const string& text, const string& suffix)
+	{
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool ValidHeader(const TilePyramidHeader& header)
+	{
+		return memcmp(header.magic, TILE_PYRAMID_MAGIC, sizeof(TILE_PYRAMID_MAGIC)) == 0
+			&& header.version == TILE_PYRAMID_VERSION
+			&& header.indexOffset >= sizeof(TilePyramidHeader);
+	}
+
+	/**
+	 * \brief Tiles as NumPy arrays in a directory per zoom level and column
+	 */
+	class DirectoryTilePyramidStore : public TilePyramidStore
+	{
+	public:
+		DirectoryTilePyramidStore(const BatchJob& job, int zooms) : m_job(job), m_zooms(zooms), m_levels(zooms, 0)
+		{
+		}
+
+		bool write(int zoom, int x, int y, int levels, const vector<vector<double> >& values) override
+		{
+			const filesystem::path directory = filesystem::path(m_job.filename) / to_string(zoom) / to_string(x);
+
+			error_code error;
+			filesystem::create_directories(directory, error);
+			if (error)
+			{
+				return false;
+			}
+
+			cv::Mat image(int(values.size()), int(values.front().size()), CV_32F);
+			for (int i = 0; i < image.rows; i++) {
+				for (int j = 0; j < image.cols; j++) {
+					image.at<float>(i, j) = float(values[i][j]);
+				}
+			}
+
+			m_levels[zoom] = levels;
+
+			return SaveNpy((directory / (to_string(y) + ".npy")).string(), image);
+		}
+
+		bool close() override
+		{
+			ofstream file(filesystem::path(m_job.filename) / "pyramid.txt", ios::trunc);
+
+			file << "tile=" << m_job.width << "x" << m_job.height << " zooms=" << m_zooms << " levels=";
+			for (int zoom = 0; zoom < m_zooms; zoom++)
+			{
+				file << (zoom > 0 ? "," : "") << m_levels[zoom];
+			}
+			file << " " << BatchNoiseDescription(m_job) << endl;
+
+			return bool(file);
+		}
+
+	private:
+		const BatchJob m_job;
+		const int m_zooms;
+		// Levels of the noise of each zoom level
+		vector<int> m_levels;
+	};
+
+	/**
+	 * \brief Tiles appended to a single file, with an index at the end
+	 */
+	class FileTilePyramidStore : public TilePyramidStore
+	{
+	public:
+		FileTilePyramidStore(const BatchJob& job, int zooms) : m_file(job.filename, ios::binary | ios::trunc)
+		{
+			m_header = {};
+			memcpy(m_header.magic, TILE_PYRAMID_MAGIC, sizeof(TILE_PYRAMID_MAGIC));
+			m_header.version = TILE_PYRAMID_VERSION;
+			m_header.fingerprint = BatchJobFingerprint(job);
+			m_header.tileWidth = uint32_t(job.width);
+			m_header.tileHeight = uint32_t(job.height);
+			m_header.zooms = uint32_t(zooms);
+
+			// The header is written again with the index once all the tiles are written
+			m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+		}
+
+		bool isOpen() const
+		{
+			return bool(m_file);
+		}
+
+		bool write(int zoom, int x, int y, int levels, const vector<vector<double> >& values) override
+		{
+			TilePyramidIndexEntry entry = {};
+			entry.zoom = uint32_t(zoom);
+			entry.x = uint32_t(x);
+			entry.y = uint32_t(y);
+			entry.levels = uint32_t(levels);
+			entry.offset = uint64_t(m_file.tellp());
+			entry.minimum = numeric_limits<float>::max();
+			entry.maximum = numeric_limits<float>::lowest();
+
+			vector<float> row(values.front().size());
+			for (const vector<double>& elevations : values)
+			{
+				for (size_t j = 0; j < row.size(); j++)
+				{
+					row[j] = float(elevations[j]);
+					entry.minimum = min(entry.minimum, row[j]);
+					entry.maximum = max(entry.maximum, row[j]);
+				}
+
+				m_file.write(reinterpret_cast<const char*>(row.data()), streamsize(row.size() * sizeof(float)));
+			}
+
+			m_index.push_back(entry);
+
+			return bool(m_file);
+		}
+
+		bool close() override
+		{
+			m_header.tiles = uint32_t(m_index.size());
+			m_header.indexOffset = uint64_t(m_file.tellp());
+
+			m_file.write(reinterpret_cast<const char*>(m_index.data()), streamsize(m_index.size() * sizeof(TilePyramidIndexEntry)));
+			m_file.seekp(0);
+			m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+			m_file.close();
+
+			return !m_file.fail();
+		}
+
+	private:
+		ofstream m_file;
+		TilePyramidHeader m_header;
+		vector<TilePyramidIndexEntry> m_index;
+	};
+
+	/**
+	 * \brief Renders the tiles of a pyramid depth first, keeping the networks of the ancestors of the current tile
+	 */
+	template <typename I>
+	class TilePyramidBuilder
+	{
+	public:
+		typedef function<unique_ptr<ControlFunction<I> >()> ControlFunctionFactory;
+
+		TilePyramidBuilder(const BatchJob& job, int zooms, const ControlFunctionFactory& controlFunctionFactory, TilePyramidStore& store) :
+			m_job(job),
+			m_zooms(zooms),
+			m_controlFunctionFactory(controlFunctionFactory),
+			m_store(store),
+			m_statistics(zooms)
+		{
+			const double width = fabs(job.noiseBottomRight.x - job.noiseTopLeft.x);
+			const double height = fabs(job.noiseBottomRight.y - job.noiseTopLeft.y);
+
+			for (int zoom = 0; zoom < zooms; zoom++)
+			{
+				// Size of a pixel of the zoom level, the smallest of its sides so that no segment is shorter than a pixel
+				const double footprint = min(width / job.width, height / job.height) / double(1 << zoom);
+
+				m_statistics[zoom].levels = NoiseWithLevels(job.resolution).levelsForFootprint(footprint);
+			}
+		}
+
+		bool build()
+		{
+			return BuildTile(0, 0, 0, nullptr);
+		}
+
+		const vector<TilePyramidZoom>& statistics() const
+		{
+			return m_statistics;
+		}
+
+	private:
+		const Noise<I>& NoiseWithLevels(int levels)
+		{
+			unique_ptr<const Noise<I> >& noise = m_noises[levels];
+			if (!noise)
+			{
+				const BatchJob& job = m_job;
+				const bool lichtenberg = (job.kind == "lichtenberg");
+				noise = make_unique<const Noise<I> >(m_controlFunctionFactory(), job.noiseTopLeft, job.noiseBottomRight, job.controlFunctionTopLeft, job.controlFunctionBottomRight, job.seed, job.eps, levels, job.displacement, job.primitivesResolutionSteps, job.slopePower, job.noiseAmplitudeProportion, true, false, lichtenberg, false, false);
+			}
+
+			return *noise;
+		}
+
+		bool BuildTile(int zoom, int x, int y, const RiverNetwork* parent)
+		{
+			const double width = (m_job.noiseBottomRight.x - m_job.noiseTopLeft.x) / double(1 << zoom);
+			const double height = (m_job.noiseBottomRight.y - m_job.noiseTopLeft.y) / double(1 << zoom);
+			const Point2D topLeft(m_job.noiseTopLeft.x + x * width, m_job.noiseTopLeft.y + y * height);
+			const Point2D bottomRight(topLeft.x + width, topLeft.y + height);
+
+			TilePyramidZoom& statistics = m_statistics[zoom];
+			const Noise<I>& noise = NoiseWithLevels(statistics.levels);
+			const bool lichtenberg = (m_job.kind == "lichtenberg");
+
+			// The tile is inside its parent, so the network of the parent covers the cells around the tile for the levels it has
+			const auto startTime = chrono::high_resolution_clock::now();
+			RiverNetwork network;
+			if (lichtenberg)
+			{
+				network = (parent != nullptr) ? noise.bakeLichtenbergNetwork(topLeft, bottomRight, *parent) : noise.bakeLichtenbergNetwork(topLeft, bottomRight);
+			}
+			else
+			{
+				network = (parent != nullptr) ? noise.bakeTerrainNetwork(topLeft, bottomRight, *parent) : noise.bakeTerrainNetwork(topLeft, bottomRight);
+			}
+			const auto bakeTime = chrono::high_resolution_clock::now();
+
+			const vector<vector<double> > values = lichtenberg
+				? noise.evaluateLichtenbergTile(network, topLeft, bottomRight, m_job.width, m_job.height)
+				: noise.evaluateTerrainTile(network, topLeft, bottomRight, m_job.width, m_job.height);
+			const auto endTime = chrono::high_resolution_clock::now();
+
+			statistics.tiles++;
+			statistics.bakeTime += chrono::duration<double, milli>(bakeTime - startTime).count();
+			statistics.evaluationTime += chrono::duration<double, milli>(endTime - bakeTime).count();
+
+			if (!m_store.write(zoom, x, y, statistics.levels, values))
+			{
+				return false;
+			}
+
+			if (zoom + 1 == m_zooms)
+			{
+				return true;
+			}
+
+			for (int child = 0; child < 4; child++)
+			{
+				if (!BuildTile(zoom + 1, 2 * x + child % 2, 2 * y + child / 2, &network))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		const BatchJob m_job;
+		const int m_zooms;
+		const ControlFunctionFactory m_controlFunctionFactory;
+		TilePyramidStore& m_store;
+		vector<TilePyramidZoom> m_statistics;
+		map<int, unique_ptr<const Noise<I> > > m_noises;
+	};
+
+	template <typename I>
+	bool BuildTilePyramid(const BatchJob& job, int zooms, const typename TilePyramidBuilder<I>::ControlFunctionFactory& controlFunctionFactory, TilePyramidStore& store, vector<TilePyramidZoom>& statistics)
+	{
+		TilePyramidBuilder<I> builder(job, zooms, controlFunctionFactory, store);
+
+		const bool success = builder.build();
+		statistics = builder.statistics();
+
+		return success;
+	}
+}
+
+std::unique_ptr<TilePyramidStore> OpenTilePyramidStore(const BatchJob& job, int zooms)
+{
+	if (EndsWith(job.filename, ".pyramid"))
+	{
+		unique_ptr<FileTilePyramidStore> store = make_unique<FileTilePyramidStore>(job, zooms);
+		if (!store->isOpen())
+		{
+			return nullptr;
+		}
+
+		return store;
+	}
+
+	error_code error;
+	filesystem::create_directories(job.filename, error);
+	if (error)
+	{
+		return nullptr;
+	}
+
+	return make_unique<DirectoryTilePyramidStore>(job, zooms);
+}
+
+bool LoadTilePyramidTile(const std::string& filename, int zoom, int x, int y, std::vector<float>& values)
+{
+	ifstream file(filename, ios::binary);
+
+	TilePyramidHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !ValidHeader(header))
+	{
+		return false;
+	}
+
+	vector<TilePyramidIndexEntry> index(header.tiles);
+	file.seekg(streamoff(header.indexOffset));
+	if (!file.read(reinterpret_cast<char*>(index.data()), streamsize(index.size() * sizeof(TilePyramidIndexEntry))))
+	{
+		return false;
+	}
+
+	const auto entry = find_if(index.begin(), index.end(), [&](const TilePyramidIndexEntry& e) {
+		return int(e.zoom) == zoom && int(e.x) == x && int(e.y) == y;
+	});
+	if (entry == index.end())
+	{
+		return false;
+	}
+
+	values.resize(size_t(header.tileWidth) * header.tileHeight);
+	file.seekg(streamoff(entry->offset));
+
+	return bool(file.read(reinterpret_cast<char*>(values.data()), streamsize(values.size() * sizeof(float))));
+}
+
+bool BuildTilePyramid(const BatchJob& job, int zooms, TilePyramidStore& store, std::vector<TilePyramidZoom>& statistics)
+{
+	assert(zooms >= 1 && zooms <= MAX_PYRAMID_ZOOMS);
+
+	bool success;
+	if (job.kind == "lichtenberg")
+	{
+		success = BuildTilePyramid<LichtenbergControlFunction>(job, zooms, []() { return make_unique<LichtenbergControlFunction>(); }, store, statistics);
+	}
+	else if (job.kind == "image")
+	{
+		const cv::Mat controlImage = LoadBatchControlImage(job);
+		if (controlImage.empty())
+		{
+			return false;
+		}
+
+		success = BuildTilePyramid<ImageControlFunction>(job, zooms, [&controlImage]() { return make_unique<ImageControlFunction>(controlImage); }, store, statistics);
+	}
+	else
+	{
+		success = BuildTilePyramid<PerlinControlFunction>(job, zooms, []() { return make_unique<PerlinControlFunction>(); }, store, statistics);
+	}
+
+	return store.close() && success;
+}
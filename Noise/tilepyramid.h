@@ -0,0 +1,125 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batchjob.h"
+
+/**
+ * \brief Header of a tile pyramid file.
+ * Tiles are stored as float32 elevations row by row after the header, in the order they were rendered,
+ * and are found with the index written after the last tile.
+ */
+struct TilePyramidHeader
+{
+	char magic[4];
+	uint32_t version;
+	// Fingerprint of the job of the pyramid, see BatchJobFingerprint
+	uint64_t fingerprint;
+	// Size of every tile
+	uint32_t tileWidth;
+	uint32_t tileHeight;
+	// Zoom levels from 0 to zooms - 1
+	uint32_t zooms;
+	uint32_t tiles;
+	// Position of the index in the file
+	uint64_t indexOffset;
+};
+
+static_assert(sizeof(TilePyramidHeader) == 40, "The tile pyramid header should be 40 bytes long.");
+
+/**
+ * \brief Entry of the index of a tile pyramid file
+ */
+struct TilePyramidIndexEntry
+{
+	uint32_t zoom;
+	uint32_t x;
+	uint32_t y;
+	// Number of levels of the noise used to render the tile
+	uint32_t levels;
+	// Position of the elevations of the tile in the file
+	uint64_t offset;
+	// Range of the elevations of the tile
+	float minimum;
+	float maximum;
+};
+
+static_assert(sizeof(TilePyramidIndexEntry) == 32, "The tile pyramid index entry should be 32 bytes long.");
+
+/**
+ * \brief Storage of the tiles of a pyramid
+ */
+class TilePyramidStore
+{
+public:
+	virtual ~TilePyramidStore() = default;
+
+	/**
+	 * \brief Store the tile (x, y) of a zoom level
+	 * \param levels Number of levels of the noise used to render the tile
+	 * \param values Elevations of the tile
+	 * \return True if the tile is stored
+	 */
+	virtual bool write(int zoom, int x, int y, int levels, const std::vector<std::vector<double> >& values) = 0;
+
+	/**
+	 * \brief Complete the store once all the tiles are written
+	 * \return True if the store is complete
+	 */
+	virtual bool close() = 0;
+};
+
+/**
+ * \brief Largest number of zoom levels of a pyramid, the tiles of the last zoom level are numbered with ints
+ */
+const int MAX_PYRAMID_ZOOMS = 30;
+
+/**
+ * \brief Open the store of the pyramid of a job: a single tile pyramid file if the output of the job ends with .pyramid,
+ * otherwise a directory with a NumPy array of float32 elevations per tile, as output/zoom/x/y.npy, and a description
+ * of the pyramid in output/pyramid.txt.
+ * \param zooms Number of zoom levels of the pyramid
+ * \return nullptr if the store cannot be created
+ */
+std::unique_ptr<TilePyramidStore> OpenTilePyramidStore(const BatchJob& job, int zooms);
+
+/**
+ * \brief Read a tile of a tile pyramid file
+ * \param values Elevations of the tile row by row
+ * \return True if the file is a valid pyramid containing the tile
+ */
+bool LoadTilePyramidTile(const std::string& filename, int zoom, int x, int y, std::vector<float>& values);
+
+/**
+ * \brief Rendering of a zoom level of a pyramid
+ */
+struct TilePyramidZoom
+{
+	// Number of levels of the noise used to render the tiles
+	int levels = 0;
+	int tiles = 0;
+	// Time in ms spent baking the networks of the tiles and evaluating their elevations
+	double bakeTime = 0.0;
+	double evaluationTime = 0.0;
+};
+
+/**
+ * \brief Render the quadtree pyramid of a job into a store.
+ * The zoom level 0 is one tile covering the noise window of the job, and each tile of a zoom level is split in four tiles
+ * of the next one, so the zoom level z has 2^z x 2^z tiles. Every tile has the size of the raster of the job.
+ *
+ * A zoom level is rendered with the levels of the noise whose segments are at least one pixel long, up to the resolution of the job,
+ * so coarse zoom levels need fewer levels. Tiles are rendered depth first, and the network of a tile is baked on top of the network
+ * of its parent: the levels the parent already has are copied, only the finer levels are generated.
+ * \param zooms Number of zoom levels, from 1 to MAX_PYRAMID_ZOOMS
+ * \param store Store of the tiles, closed once all the tiles are written
+ * \param statistics Rendering of each zoom level
+ * \return False if the control image of an image job cannot be read or a tile cannot be stored
+ */
+bool BuildTilePyramid(const BatchJob& job, int zooms, TilePyramidStore& store, std::vector<TilePyramidZoom>& statistics);
+
+#endif // TILEPYRAMID_H
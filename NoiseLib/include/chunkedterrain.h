@@ -0,0 +1,611 @@
+#ifndef CHUNKEDTERRAIN_H
+#define CHUNKEDTERRAIN_H
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "noise.h"
+#include "rivernetwork.h"
+
+/// <summary>
+/// Terrain over the whole plane, rendered on demand in square chunks of a fixed number of samples, for streaming worlds.
+/// The chunk (x, y) of level of detail lod covers the square of side chunkSize * 2^lod whose top left corner is (x, y) times its side,
+/// in the coordinates of the noise. Coarser levels of detail cover larger squares with the same number of samples,
+/// and are rendered with the levels of the noise whose segments are at least one sample long.
+///
+/// Chunks are kept in a cache, least recently used first evicted. Chunks along the movement of the viewer are rendered
+/// ahead of time on a background thread, so that getChunk usually returns a chunk from the cache within the frame budget,
+/// and pollChunk never waits. Several requests for the same chunk, from the prefetch or from the viewer, render it once.
+///
+/// The coarse levels of the noise, whose cells are larger than a chunk, are baked once for a block of SUPERCHUNK x SUPERCHUNK chunks
+/// and shared by the networks of the chunks of the block, which only generate their finer levels.
+/// </summary>
+template <typename I>
+class ChunkedTerrain
+{
+public:
+	struct Configuration
+	{
+		// Parameters of the noise, see Noise. The resolution is the number of levels of the finest level of detail.
+		int seed = 0;
+		double eps = 0.25;
+		int resolution = 4;
+		double displacement = 0.1;
+		int primitivesResolutionSteps = 3;
+		double slopePower = 0.5;
+		double noiseAmplitudeProportion = 0.05;
+		// Mapping from the coordinates of the noise to the coordinates of the control function, extended to the whole plane
+		Point2D noiseTopLeft = Point2D(0.0, 0.0);
+		Point2D noiseBottomRight = Point2D(4.0, 4.0);
+		Point2D controlFunctionTopLeft = Point2D(-0.2, -0.4);
+		Point2D controlFunctionBottomRight = Point2D(1.4, 0.7);
+
+		// Side of a chunk of level of detail 0 in the coordinates of the noise
+		double chunkSize = 0.25;
+		// Number of samples on each side of a chunk
+		int chunkSamples = 64;
+		// Number of chunks kept in the cache
+		int cachedChunks = 256;
+		// Number of blocks of coarse levels kept in the cache
+		int cachedCoarseNetworks = 16;
+		// Number of chunks prefetched ahead of the viewer along its movement
+		int prefetchDistance = 3;
+		// Time in ms getChunk should take, usually a frame
+		double frameBudget = 16.0;
+	};
+
+	struct Chunk
+	{
+		int x;
+		int y;
+		int lod;
+		// Number of levels of the noise used to render the chunk
+		int levels;
+		Point2D topLeft;
+		Point2D bottomRight;
+		// Elevations row by row, the sample (i, j) is at topLeft + (j, i) * side / chunkSamples
+		std::vector<std::vector<double> > elevations;
+		// Time taken to render the chunk in ms
+		double renderTime;
+	};
+
+	struct Statistics
+	{
+		// Calls to getChunk answered without rendering, and calls rendering the chunk
+		long long hits = 0;
+		long long misses = 0;
+		// Chunks rendered by the prefetch thread
+		long long prefetched = 0;
+		// Calls to getChunk longer than the frame budget
+		long long overBudget = 0;
+		// Longest call to getChunk in ms
+		double maximumLatency = 0.0;
+	};
+
+	typedef std::function<std::unique_ptr<ControlFunction<I> >()> ControlFunctionFactory;
+
+	/// <summary>
+	/// Blocks of SUPERCHUNK x SUPERCHUNK chunks share the baking of their coarse levels
+	/// </summary>
+	static constexpr int SUPERCHUNK = 8;
+
+	/// <summary>
+	/// Coarsest level of detail, whose chunks are 2^MAX_LOD times larger than the chunks of level 0
+	/// </summary>
+	static constexpr int MAX_LOD = 30;
+
+	/// <summary>
+	/// Start the prefetch thread
+	/// </summary>
+	/// <param name="controlFunctionFactory">Create a control function for each noise, one per number of levels</param>
+	/// <param name="configuration">Parameters of the terrain and of its chunks</param>
+	ChunkedTerrain(const ControlFunctionFactory& controlFunctionFactory, const Configuration& configuration);
+
+	/// <summary>
+	/// Stop the prefetch thread once its current chunk is rendered
+	/// </summary>
+	~ChunkedTerrain();
+
+	ChunkedTerrain(const ChunkedTerrain&) = delete;
+	ChunkedTerrain& operator=(const ChunkedTerrain&) = delete;
+
+	/// <summary>
+	/// Side of the chunks of a level of detail in the coordinates of the noise.
+	/// Throws std::out_of_range if the level of detail is not in [0, MAX_LOD].
+	/// </summary>
+	double chunkSize(int lod) const;
+
+	/// <summary>
+	/// Number of levels of the noise used to render the chunks of a level of detail
+	/// </summary>
+	int levels(int lod);
+
+	/// <summary>
+	/// Chunk from the cache, or rendered now if it is not in the cache. Waits for the chunk if it is being rendered by the prefetch.
+	/// If the rendering fails, its exception is rethrown by every request waiting for the chunk, and the next request renders it again.
+	/// </summary>
+	std::shared_ptr<const Chunk> getChunk(int x, int y, int lod);
+
+	/// <summary>
+	/// Chunk from the cache without waiting, nullptr if it is not ready. A missing chunk is rendered next by the prefetch thread.
+	/// Like getChunk, rethrows the exception of a failed rendering.
+	/// </summary>
+	std::shared_ptr<const Chunk> pollChunk(int x, int y, int lod);
+
+	/// <summary>
+	/// Replace the chunks waiting to be prefetched by the chunks around the viewer and ahead of it along its movement,
+	/// the nearest first
+	/// </summary>
+	/// <param name="position">Position of the viewer in the coordinates of the noise</param>
+	/// <param name="movement">Direction of the movement, null if the viewer does not move</param>
+	/// <param name="lod">Level of detail of the chunks</param>
+	void prefetch(const Point2D& position, const Vec2D& movement, int lod);
+
+	Statistics statistics() const;
+
+private:
+	struct Key
+	{
+		int x;
+		int y;
+		int lod;
+
+		bool operator<(const Key& other) const
+		{
+			if (lod != other.lod) return lod < other.lod;
+			if (y != other.y) return y < other.y;
+			return x < other.x;
+		}
+
+		bool operator==(const Key& other) const
+		{
+			return x == other.x && y == other.y && lod == other.lod;
+		}
+	};
+
+	/// <summary>
+	/// Values built once per key, least recently used first evicted.
+	/// A key is reserved by the first request needing it, which must build its value, other requests wait for the value.
+	/// The mutex of the terrain must be locked.
+	/// </summary>
+	template <typename V>
+	class Cache
+	{
+	public:
+		typedef std::shared_future<std::shared_ptr<const V> > Future;
+		typedef std::shared_ptr<std::promise<std::shared_ptr<const V> > > Promise;
+
+		explicit Cache(int capacity) : m_capacity(capacity)
+		{
+		}
+
+		/// <summary>
+		/// Value of a key. If the key is not in the cache, it is reserved and promise is the promise of its value.
+		/// </summary>
+		Future find(const Key& key, Promise& promise)
+		{
+			const auto it = m_entries.find(key);
+			if (it != m_entries.end())
+			{
+				m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+				return it->second.value;
+			}
+
+			promise = std::make_shared<std::promise<std::shared_ptr<const V> > >();
+
+			m_recent.push_front(key);
+			const Future value = promise->get_future().share();
+			m_entries.emplace(key, Entry{ value, m_recent.begin(), promise.get() });
+
+			// Requests using an evicted value keep it until they are done
+			while (int(m_entries.size()) > m_capacity)
+			{
+				m_entries.erase(m_recent.back());
+				m_recent.pop_back();
+			}
+
+			return value;
+		}
+
+		bool contains(const Key& key) const
+		{
+			return m_entries.find(key) != m_entries.end();
+		}
+
+		/// <summary>
+		/// Remove a key whose value could not be built, unless it was already evicted and reserved again by another request
+		/// </summary>
+		void evict(const Key& key, const Promise& promise)
+		{
+			const auto it = m_entries.find(key);
+			if (it != m_entries.end() && it->second.promise == promise.get())
+			{
+				m_recent.erase(it->second.recent);
+				m_entries.erase(it);
+			}
+		}
+
+	private:
+		struct Entry
+		{
+			Future value;
+			typename std::list<Key>::iterator recent;
+			// Promise of the request which reserved the key, only compared
+			const void* promise;
+		};
+
+		const int m_capacity;
+		std::map<Key, Entry> m_entries;
+		// Keys from the most to the least recently used
+		std::list<Key> m_recent;
+	};
+
+	/// <summary>
+	/// Noise with a number of levels, created on first use
+	/// </summary>
+	const Noise<I>& NoiseWithLevels(int levels);
+
+	/// <summary>
+	/// Number of coarse levels of a level of detail: the levels whose cells are at least as large as a chunk
+	/// </summary>
+	int CoarseLevels(int lod);
+
+	/// <summary>
+	/// Network of the coarse levels of the block of chunks of a chunk
+	/// </summary>
+	std::shared_ptr<const RiverNetwork> CoarseNetwork(const Key& chunk);
+
+	std::shared_ptr<const Chunk> RenderChunk(const Key& key);
+
+	/// <summary>
+	/// Build the value of a key reserved in a cache. If building it throws, the requests waiting for the value get the exception
+	/// and the key is evicted, so that the next request builds it again.
+	/// </summary>
+	template <typename V, typename F>
+	void Build(Cache<V>& cache, const Key& key, const typename Cache<V>::Promise& promise, F&& build);
+
+	void PrefetchMain();
+
+	static int FloorDivide(int a, int b)
+	{
+		return (a >= 0) ? a / b : -((-a + b - 1) / b);
+	}
+
+	const ControlFunctionFactory m_controlFunctionFactory;
+	const Configuration m_configuration;
+
+	std::mutex m_noisesMutex;
+	std::map<int, std::unique_ptr<const Noise<I> > > m_noises;
+
+	mutable std::mutex m_mutex;
+	Cache<Chunk> m_chunks;
+	Cache<RiverNetwork> m_coarseNetworks;
+	Statistics m_statistics;
+
+	// Chunks waiting for the prefetch thread: chunks polled by the viewer first, then chunks along its movement
+	std::deque<Key> m_polled;
+	std::deque<Key> m_prefetch;
+	std::condition_variable m_prefetchAvailable;
+	bool m_stopping;
+	std::thread m_prefetchThread;
+};
+
+template <typename I>
+ChunkedTerrain<I>::ChunkedTerrain(const ControlFunctionFactory& controlFunctionFactory, const Configuration& configuration) :
+	m_controlFunctionFactory(controlFunctionFactory),
+	m_configuration(configuration),
+	m_chunks(configuration.cachedChunks),
+	m_coarseNetworks(configuration.cachedCoarseNetworks),
+	m_stopping(false)
+{
+	assert(configuration.resolution >= 1 && configuration.resolution <= 5);
+	assert(configuration.chunkSize > 0.0);
+	assert(configuration.chunkSamples > 0);
+	assert(configuration.cachedChunks > 0);
+	assert(configuration.cachedCoarseNetworks > 0);
+
+	m_prefetchThread = std::thread(&ChunkedTerrain::PrefetchMain, this);
+}
+
+template <typename I>
+ChunkedTerrain<I>::~ChunkedTerrain()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_prefetchAvailable.notify_all();
+
+	m_prefetchThread.join();
+}
+
+template <typename I>
+double ChunkedTerrain<I>::chunkSize(int lod) const
+{
+	// Keys come from the viewer, the shift would overflow in release builds too
+	if (lod < 0 || lod > MAX_LOD)
+	{
+		throw std::out_of_range("The level of detail of a chunk must be between 0 and " + std::to_string(MAX_LOD));
+	}
+
+	return m_configuration.chunkSize * double(1 << lod);
+}
+
+template <typename I>
+int ChunkedTerrain<I>::levels(int lod)
+{
+	const double footprint = chunkSize(lod) / m_configuration.chunkSamples;
+
+	return NoiseWithLevels(m_configuration.resolution).levelsForFootprint(footprint);
+}
+
+template <typename I>
+std::shared_ptr<const typename ChunkedTerrain<I>::Chunk> ChunkedTerrain<I>::getChunk(int x, int y, int lod)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	const Key key = { x, y, lod };
+
+	typename Cache<Chunk>::Promise promise;
+	typename Cache<Chunk>::Future chunk;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		chunk = m_chunks.find(key, promise);
+	}
+
+	if (promise)
+	{
+		Build(m_chunks, key, promise, [this, &key]() { return RenderChunk(key); });
+	}
+
+	const std::shared_ptr<const Chunk> result = chunk.get();
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const double latency = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (promise)
+	{
+		m_statistics.misses++;
+	}
+	else
+	{
+		m_statistics.hits++;
+	}
+
+	if (latency > m_configuration.frameBudget)
+	{
+		m_statistics.overBudget++;
+	}
+	m_statistics.maximumLatency = std::max(m_statistics.maximumLatency, latency);
+
+	return result;
+}
+
+template <typename I>
+std::shared_ptr<const typename ChunkedTerrain<I>::Chunk> ChunkedTerrain<I>::pollChunk(int x, int y, int lod)
+{
+	const Key key = { x, y, lod };
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_chunks.contains(key))
+	{
+		m_polled.push_back(key);
+		m_prefetchAvailable.notify_one();
+
+		return nullptr;
+	}
+
+	typename Cache<Chunk>::Promise promise;
+	const typename Cache<Chunk>::Future chunk = m_chunks.find(key, promise);
+	assert(!promise);
+
+	if (chunk.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return nullptr;
+	}
+
+	return chunk.get();
+}
+
+template <typename I>
+void ChunkedTerrain<I>::prefetch(const Point2D& position, const Vec2D& movement, int lod)
+{
+	const double size = chunkSize(lod);
+
+	// Chunks around the viewer, then around the points ahead of it, one chunk apart
+	const double length = std::sqrt(movement.x * movement.x + movement.y * movement.y);
+	const int steps = (length > 0.0) ? m_configuration.prefetchDistance : 0;
+
+	std::vector<Key> keys;
+	for (int step = 0; step <= steps; step++)
+	{
+		const double px = position.x + (step > 0 ? movement.x / length * step * size : 0.0);
+		const double py = position.y + (step > 0 ? movement.y / length * step * size : 0.0);
+		const int cx = int(std::floor(px / size));
+		const int cy = int(std::floor(py / size));
+
+		// The chunk of the point first, then its neighbors
+		for (int k = 0; k < 9; k++)
+		{
+			const int n = (k + 4) % 9;
+			const Key key = { cx + n % 3 - 1, cy + n / 3 - 1, lod };
+
+			if (std::find(keys.begin(), keys.end(), key) == keys.end())
+			{
+				keys.push_back(key);
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_prefetch.assign(keys.begin(), keys.end());
+	m_prefetchAvailable.notify_one();
+}
+
+template <typename I>
+typename ChunkedTerrain<I>::Statistics ChunkedTerrain<I>::statistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_statistics;
+}
+
+template <typename I>
+const Noise<I>& ChunkedTerrain<I>::NoiseWithLevels(int levels)
+{
+	std::lock_guard<std::mutex> lock(m_noisesMutex);
+
+	std::unique_ptr<const Noise<I> >& noise = m_noises[levels];
+	if (!noise)
+	{
+		const Configuration& c = m_configuration;
+		noise = std::make_unique<const Noise<I> >(m_controlFunctionFactory(), c.noiseTopLeft, c.noiseBottomRight, c.controlFunctionTopLeft, c.controlFunctionBottomRight, c.seed, c.eps, levels, c.displacement, c.primitivesResolutionSteps, c.slopePower, c.noiseAmplitudeProportion, true, false, false, false, false);
+	}
+
+	// Noises are never removed, so the reference stays valid
+	return *noise;
+}
+
+template <typename I>
+int ChunkedTerrain<I>::CoarseLevels(int lod)
+{
+	const int maxLevels = levels(lod);
+	const double size = chunkSize(lod);
+
+	// Cells of the level k + 1 have a side of 1 / 2^k
+	int coarseLevels = 1;
+	while (coarseLevels < maxLevels && 1.0 / double(1 << coarseLevels) >= size)
+	{
+		coarseLevels++;
+	}
+
+	return coarseLevels;
+}
+
+template <typename I>
+std::shared_ptr<const RiverNetwork> ChunkedTerrain<I>::CoarseNetwork(const Key& chunk)
+{
+	const Key key = { FloorDivide(chunk.x, SUPERCHUNK), FloorDivide(chunk.y, SUPERCHUNK), chunk.lod };
+
+	typename Cache<RiverNetwork>::Promise promise;
+	typename Cache<RiverNetwork>::Future network;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		network = m_coarseNetworks.find(key, promise);
+	}
+
+	if (promise)
+	{
+		const double size = chunkSize(chunk.lod) * SUPERCHUNK;
+		const Point2D topLeft(key.x * size, key.y * size);
+		const Point2D bottomRight((key.x + 1) * size, (key.y + 1) * size);
+
+		Build(m_coarseNetworks, key, promise, [&]()
+		{
+			return std::make_shared<const RiverNetwork>(NoiseWithLevels(CoarseLevels(chunk.lod)).bakeTerrainNetwork(topLeft, bottomRight));
+		});
+	}
+
+	return network.get();
+}
+
+template <typename I>
+std::shared_ptr<const typename ChunkedTerrain<I>::Chunk> ChunkedTerrain<I>::RenderChunk(const Key& key)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	const std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+	chunk->x = key.x;
+	chunk->y = key.y;
+	chunk->lod = key.lod;
+	chunk->levels = levels(key.lod);
+
+	const double size = chunkSize(key.lod);
+	chunk->topLeft = Point2D(key.x * size, key.y * size);
+	chunk->bottomRight = Point2D((key.x + 1) * size, (key.y + 1) * size);
+
+	// Only the finer levels are generated, the coarse levels are copied from the network of the block
+	const Noise<I>& noise = NoiseWithLevels(chunk->levels);
+	const std::shared_ptr<const RiverNetwork> coarse = CoarseNetwork(key);
+	const RiverNetwork network = noise.bakeTerrainNetwork(chunk->topLeft, chunk->bottomRight, *coarse);
+
+	chunk->elevations = noise.evaluateTerrainTile(network, chunk->topLeft, chunk->bottomRight, m_configuration.chunkSamples, m_configuration.chunkSamples);
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	chunk->renderTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	return chunk;
+}
+
+template <typename I>
+void ChunkedTerrain<I>::PrefetchMain()
+{
+	while (true)
+	{
+		Key key;
+		typename Cache<Chunk>::Promise promise;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_prefetchAvailable.wait(lock, [this]() { return m_stopping || !m_polled.empty() || !m_prefetch.empty(); });
+
+			if (m_stopping)
+			{
+				return;
+			}
+
+			std::deque<Key>& queue = m_polled.empty() ? m_prefetch : m_polled;
+			key = queue.front();
+			queue.pop_front();
+
+			// Chunks already in the cache or being rendered are skipped
+			if (m_chunks.contains(key))
+			{
+				continue;
+			}
+
+			m_chunks.find(key, promise);
+			m_statistics.prefetched++;
+		}
+
+		// A failed chunk is rendered again when it is requested again, the prefetch goes on
+		Build(m_chunks, key, promise, [this, &key]() { return RenderChunk(key); });
+	}
+}
+
+template <typename I>
+template <typename V, typename F>
+void ChunkedTerrain<I>::Build(Cache<V>& cache, const Key& key, const typename Cache<V>::Promise& promise, F&& build)
+{
+	try
+	{
+		promise->set_value(build());
+	}
+	catch (...)
+	{
+		promise->set_exception(std::current_exception());
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		cache.evict(key, promise);
+	}
+}
+
+#endif // CHUNKEDTERRAIN_H
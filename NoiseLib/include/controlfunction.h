@@ -17,6 +17,15 @@ public:
 		return static_cast<const Implementation*>(this)->EvaluateImpl(x, y);
 	}
 
+	/// <summary>
+	/// Evaluate the function in (x, y), averaged over a square footprint
+	/// </summary>
+	/// <param name="footprint">Side of the footprint in the coordinates of the function</param>
+	double evaluate(double x, double y, double footprint) const
+	{
+		return static_cast<const Implementation*>(this)->EvaluateFootprintImpl(x, y, footprint);
+	}
+
 	/// <summary>
 	/// Check whether a point is inside the domain of the function
 	/// </summary>
@@ -52,6 +61,15 @@ public:
 	{
 		return static_cast<const Implementation*>(this)->MaximumImpl();
 	}
+
+protected:
+	/// <summary>
+	/// By default, the footprint is ignored and the function is point sampled
+	/// </summary>
+	double EvaluateFootprintImpl(double x, double y, double /*footprint*/) const
+	{
+		return evaluate(x, y);
+	}
 };
 
 #endif // CONTROLFUNCTION_H
\ No newline at end of file
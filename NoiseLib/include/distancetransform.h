@@ -0,0 +1,36 @@
+#ifndef DISTANCETRANSFORM_H
+#define DISTANCETRANSFORM_H
+
+#include <vector>
+
+/// <summary>
+/// Squared Euclidean distance transform of a sampled function in linear time.
+/// Felzenszwalb and Huttenlocher, Distance Transforms of Sampled Functions, 2012.
+/// Feature samples are 0, other samples are DistanceTransformInfinity().
+/// </summary>
+/// <param name="f">Samples of the function, row by row</param>
+/// <param name="rows">Number of rows</param>
+/// <param name="cols">Number of columns</param>
+/// <param name="spacingI">Distance between two consecutive rows</param>
+/// <param name="spacingJ">Distance between two consecutive columns</param>
+/// <returns>For each sample, the squared distance to the nearest feature</returns>
+std::vector<double> SquaredDistanceTransform(const std::vector<double>& f, int rows, int cols, double spacingI = 1.0, double spacingJ = 1.0);
+
+/// <summary>
+/// Squared Euclidean distance transform which also finds the nearest feature of each sample.
+/// </summary>
+/// <param name="f">Samples of the function, row by row</param>
+/// <param name="rows">Number of rows</param>
+/// <param name="cols">Number of columns</param>
+/// <param name="nearest">For each sample, index of the nearest feature in f, -1 if there is no feature</param>
+/// <param name="spacingI">Distance between two consecutive rows</param>
+/// <param name="spacingJ">Distance between two consecutive columns</param>
+/// <returns>For each sample, the squared distance to the nearest feature</returns>
+std::vector<double> SquaredDistanceTransform(const std::vector<double>& f, int rows, int cols, std::vector<int>& nearest, double spacingI = 1.0, double spacingJ = 1.0);
+
+/// <summary>
+/// Value of samples that are not features in the distance transform
+/// </summary>
+double DistanceTransformInfinity();
+
+#endif // DISTANCETRANSFORM_H
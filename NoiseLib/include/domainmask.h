@@ -0,0 +1,70 @@
+#ifndef DOMAINMASK_H
+#define DOMAINMASK_H
+
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "math2d.h"
+
+/// <summary>
+/// A domain of arbitrary shape defined by a mask covering a rectangle.
+/// The signed distance to the border of the domain is precomputed once,
+/// so that checking if a point is inside the domain or computing its distance to the domain is a lookup.
+/// Everything outside the rectangle of the mask is outside the domain.
+/// </summary>
+class DomainMask
+{
+public:
+	/// <summary>
+	/// Create a domain from a mask
+	/// </summary>
+	/// <param name="mask">Single channel image, non zero pixels are inside the domain</param>
+	/// <param name="topLeft">Top left corner of the mask in the coordinates of the control function</param>
+	/// <param name="bottomRight">Bottom right corner of the mask in the coordinates of the control function</param>
+	DomainMask(const cv::Mat& mask, const Point2D& topLeft, const Point2D& bottomRight);
+
+	/// <summary>
+	/// Create a domain from a polygon rasterized in a mask
+	/// </summary>
+	/// <param name="polygon">Vertices of the polygon in the coordinates of the control function</param>
+	/// <param name="topLeft">Top left corner of the mask in the coordinates of the control function</param>
+	/// <param name="bottomRight">Bottom right corner of the mask in the coordinates of the control function</param>
+	/// <param name="rows">Number of rows of the mask</param>
+	/// <param name="cols">Number of columns of the mask</param>
+	DomainMask(const std::vector<Point2D>& polygon, const Point2D& topLeft, const Point2D& bottomRight, int rows, int cols);
+
+	/// <summary>
+	/// Signed distance to the border of the domain, negative inside the domain
+	/// </summary>
+	double signedDistance(double x, double y) const;
+
+	bool insideDomain(double x, double y) const
+	{
+		return signedDistance(x, y) <= 0.0;
+	}
+
+	double distToDomain(double x, double y) const
+	{
+		return std::max(signedDistance(x, y), 0.0);
+	}
+
+private:
+	void ComputeSignedDistance(const cv::Mat& mask);
+
+	const Point2D m_topLeft;
+	const Point2D m_bottomRight;
+
+	int m_rows;
+	int m_cols;
+
+	// Size of a pixel of the mask in the coordinates of the control function
+	double m_pixelSizeX;
+	double m_pixelSizeY;
+
+	// Signed distance at the center of each pixel, row by row
+	std::vector<double> m_signedDistance;
+};
+
+#endif // DOMAINMASK_H
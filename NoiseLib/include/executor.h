@@ -0,0 +1,151 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Pool of threads running the parallel loops of the rendering.
+/// A single executor is shared by the whole process, so that loops started at the same time by several threads,
+/// or nested in another loop, never use more threads than the executor has.
+/// </summary>
+class Executor
+{
+public:
+	enum class Backend
+	{
+		// Each loop runs in an OpenMP parallel region
+		OpenMP,
+		// Loops share the threads owned by the executor
+		Threads
+	};
+
+	struct Configuration
+	{
+		Backend backend = Backend::Threads;
+		// Number of threads running a loop, including the calling thread. 0 for the number of cores.
+		int threads = 0;
+		// Pin each thread to a core
+		bool pinThreads = false;
+	};
+
+	explicit Executor(const Configuration& configuration);
+	~Executor();
+
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+	/// <summary>
+	/// Executor shared by the whole process, created from the environment on first use
+	/// </summary>
+	static Executor& global();
+
+	/// <summary>
+	/// Replace the executor shared by the whole process.
+	/// No loop may be running on the previous executor.
+	/// </summary>
+	static void configureGlobal(const Configuration& configuration);
+
+	/// <summary>
+	/// Configuration read from the environment variables NOISE_EXECUTOR ("openmp" or "threads"),
+	/// NOISE_THREADS (OMP_NUM_THREADS if not set) and NOISE_PIN_THREADS ("1" to pin threads).
+	/// </summary>
+	static Configuration environmentConfiguration();
+
+	Backend backend() const;
+
+	int threads() const;
+
+	/// <summary>
+	/// Call body(first, last) on chunks of [begin, end) in parallel, and return when all chunks are done.
+	/// Chunks are distributed dynamically, the calling thread runs chunks too.
+	/// A loop started from inside a loop of the executor runs on the calling thread only.
+	/// If a chunk throws, the chunks which did not start are skipped, and the first exception is rethrown by the calling thread
+	/// once the running chunks are done.
+	/// </summary>
+	/// <param name="begin">First index</param>
+	/// <param name="end">Index after the last one</param>
+	/// <param name="grain">Number of indices in a chunk</param>
+	/// <param name="body">Function called on each chunk</param>
+	void parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+	/// <summary>
+	/// Call function(i) for each i in [begin, end) in parallel, one index per chunk
+	/// </summary>
+	template <typename F>
+	void parallelFor(int begin, int end, F&& function)
+	{
+		parallelFor(begin, end, 1, [&function](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				function(i);
+			}
+		});
+	}
+
+	/// <summary>
+	/// Call function(i) for each i in [begin, end) in parallel, index i always runs on the thread (i - begin) % threads().
+	/// The calling thread is the thread 0. Loops over the same range run each index on the same thread,
+	/// so memory first touched by a thread in a loop is used by the same thread in the next loops.
+	/// On NUMA systems, memory then stays on the node of the thread using it, if threads are pinned.
+	/// Exceptions are rethrown like in parallelFor.
+	/// </summary>
+	void parallelForStatic(int begin, int end, const std::function<void(int)>& function);
+
+private:
+	struct Loop;
+
+	void RunOpenMP(int begin, int end, int grain, const std::function<void(int, int)>& body) const;
+
+	void RunThreads(const std::shared_ptr<Loop>& loop);
+
+	void WorkerMain(int worker);
+
+	/// <summary>
+	/// Loop with work left for a worker, nullptr if there is none
+	/// </summary>
+	std::shared_ptr<Loop> NextLoop(int worker);
+
+	static bool RunChunk(Loop& loop, int thread);
+
+	static void PinThread(int core);
+
+	Configuration m_configuration;
+
+	// Loops with chunks left, workers take chunks from each loop in turn.
+	// Chunks of static loops are the indices of one thread, they can only be taken by this thread.
+	std::mutex m_mutex;
+	std::condition_variable m_loopsAvailable;
+	std::list<std::shared_ptr<Loop> > m_loops;
+	bool m_stopping;
+
+	std::vector<std::thread> m_workers;
+};
+
+/// <summary>
+/// Allocate a 2D array whose rows are allocated and initialized by the threads of Executor::parallelForStatic.
+/// With first-touch page placement, a row rendered by parallelForStatic on the same range
+/// is in the memory of the NUMA node of the thread rendering it.
+/// </summary>
+/// <param name="height">Number of rows</param>
+/// <param name="width">Number of elements in a row</param>
+template <typename T>
+std::vector<std::vector<T> > AllocateRows(int height, int width)
+{
+	std::vector<std::vector<T> > rows(height);
+
+	Executor::global().parallelForStatic(0, height, [&rows, width](int i)
+	{
+		rows[i] = std::vector<T>(width);
+	});
+
+	return rows;
+}
+
+#endif // EXECUTOR_H
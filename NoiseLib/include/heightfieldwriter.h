@@ -0,0 +1,56 @@
+#ifndef HEIGHTFIELDWRITER_H
+#define HEIGHTFIELDWRITER_H
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "math2d.h"
+
+/// <summary>
+/// Description of how a heightfield was generated, stored with the samples in tiled heightfields
+/// </summary>
+struct HeightfieldMetadata
+{
+	// Domain of the noise covered by the heightfield
+	Point2D topLeft;
+	Point2D bottomRight;
+	int seed = 0;
+	// Other parameters of the noise, as key=value separated by spaces
+	std::string parameters;
+};
+
+/// <summary>
+/// Save an image (CV_32F) as raw float32 samples, row by row, without header.
+/// Samples are written in the byte order of the machine, which is little endian on x86 and ARM.
+/// </summary>
+/// <param name="filename">Name of the file</param>
+/// <param name="image">Image to save</param>
+/// <returns>True if the file has been successfully written</returns>
+bool SaveRawFloat32(const std::string& filename, const cv::Mat& image);
+
+/// <summary>
+/// Save an image (CV_32F) as a NumPy array of float32 with shape (rows, cols), readable with numpy.load
+/// </summary>
+/// <param name="filename">Name of the file, usually with the .npy extension</param>
+/// <param name="image">Image to save</param>
+/// <returns>True if the file has been successfully written</returns>
+bool SaveNpy(const std::string& filename, const cv::Mat& image);
+
+/// <summary>
+/// Save an image (CV_32F) as a tiled raw heightmap, with the metadata stored after the header.
+/// Elevations are stored without loss and the file can be memory mapped by RawHeightmapControlFunction.
+/// </summary>
+/// <param name="filename">Name of the file</param>
+/// <param name="image">Image to save</param>
+/// <param name="metadata">Bounds, seed and parameters of the heightfield</param>
+/// <param name="tileSize">Size of square tiles</param>
+/// <returns>True if the file has been successfully written</returns>
+bool SaveTiledHeightfield(const std::string& filename, const cv::Mat& image, const HeightfieldMetadata& metadata, int tileSize = 256);
+
+/// <summary>
+/// Text of the metadata of a heightfield: bounds=x0,y0,x1,y1 seed=s followed by the parameters
+/// </summary>
+std::string HeightfieldMetadataText(const HeightfieldMetadata& metadata);
+
+#endif // HEIGHTFIELDWRITER_H
@@ -2,6 +2,7 @@
 #define IMAGECONTROLFUNCTION_H
 
 #include <utility>
+#include <vector>
 #include <cassert>
 
 #include <opencv2/core/core.hpp>
@@ -19,10 +20,12 @@ class ImageControlFunction : public ControlFunction<ImageControlFunction>
 public:
 	explicit ImageControlFunction(cv::Mat image) : m_image(std::move(image))
 	{
-		assert(image.data != nullptr);
-		assert(image.type() == CV_8U || image.type() == CV_16U);
-		assert(image.rows > 1);
-		assert(image.cols > 1);
+		assert(m_image.data != nullptr);
+		assert(m_image.type() == CV_8U || m_image.type() == CV_16U);
+		assert(m_image.rows > 1);
+		assert(m_image.cols > 1);
+
+		BuildPyramid();
 	}
 
 protected:
@@ -31,7 +34,15 @@ protected:
 		x = std::clamp(x, 0.0, 1.0);
 		y = std::clamp(y, 0.0, 1.0);
 
-		return sample(y, x);
+		return sample(m_pyramid.front(), y, x);
+	}
+
+	double EvaluateFootprintImpl(double x, double y, double footprint) const
+	{
+		x = std::clamp(x, 0.0, 1.0);
+		y = std::clamp(y, 0.0, 1.0);
+
+		return sample(m_pyramid[PyramidLevel(footprint)], y, x);
 	}
 
 	bool InsideDomainImpl(double x, double y) const
@@ -46,23 +57,7 @@ protected:
 			return 0.0;
 		}
 
-		const Point2D p(x, y);
-
-		const Point2D topLeft(0.0, 0.0);
-		const Point2D topRight(1.0, 0.0);
-		const Point2D bottomLeft(0.0, 1.0);
-		const Point2D bottomRight(1.0, 1.0);
-
-		Point2D c; // Useless point for distToLineSegment
-
-		auto dist = std::numeric_limits<double>::max();
-
-		dist = std::min(dist, distToLineSegment(p, topLeft, topRight, c));
-		dist = std::min(dist, distToLineSegment(p, topRight, bottomRight, c));
-		dist = std::min(dist, distToLineSegment(p, bottomRight, bottomLeft, c));
-		dist = std::min(dist, distToLineSegment(p, bottomLeft, topLeft, c));
-
-		return dist;
+		return distToRectangle(Point2D(x, y), Point2D(0.0, 0.0), Point2D(1.0, 1.0));
 	}
 
 	double MinimumImpl() const
@@ -76,28 +71,41 @@ protected:
 	}
 
 private:
-	double get(int i, int j) const
+	static double get(const cv::Mat& image, int i, int j)
 	{
 		double value = 0.0;
 
-		switch (m_image.type())
+		switch (image.type())
 		{
 		case CV_8U:
 			// Remap the value between min_value and min_value
-			value = double(m_image.at<uint8_t>(i, j)) / std::numeric_limits<uint8_t>::max();
+			value = double(image.at<uint8_t>(i, j)) / std::numeric_limits<uint8_t>::max();
 			break;
 		case CV_16U:
 			// Remap the value between min_value and min_value
-			value = double(m_image.at<uint16_t>(i, j)) / std::numeric_limits<uint16_t>::max();
+			value = double(image.at<uint16_t>(i, j)) / std::numeric_limits<uint16_t>::max();
 			break;
 		}
 
 		return value;
 	}
 
-	double sample(double ri, double rj) const;
+	static double sample(const cv::Mat& image, double ri, double rj);
+
+	/// <summary>
+	/// Build the mip pyramid, each level is half the size of the previous one
+	/// </summary>
+	void BuildPyramid();
+
+	/// <summary>
+	/// Return the level of the pyramid in which one pixel is as large as the footprint
+	/// </summary>
+	std::size_t PyramidLevel(double footprint) const;
 
 	const cv::Mat m_image;
+
+	// Mip pyramid, the first level is the image itself
+	std::vector<cv::Mat> m_pyramid;
 };
 
 #endif // IMAGECONTROLFUNCTION_H
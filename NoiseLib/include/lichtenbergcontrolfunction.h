@@ -32,23 +32,7 @@ protected:
 			return 0.0;
 		}
 
-		const Point2D p(x, y);
-
-		const Point2D topLeft(-1.0, -1.0);
-		const Point2D topRight(1.0, -1.0);
-		const Point2D bottomLeft(-1.0, 1.0);
-		const Point2D bottomRight(1.0, 1.0);
-
-		Point2D c; // Useless point for distToLineSegment
-
-		auto dist = std::numeric_limits<double>::max();
-
-		dist = std::min(dist, distToLineSegment(p, topLeft, topRight, c));
-		dist = std::min(dist, distToLineSegment(p, topRight, bottomRight, c));
-		dist = std::min(dist, distToLineSegment(p, bottomRight, bottomLeft, c));
-		dist = std::min(dist, distToLineSegment(p, bottomLeft, topLeft, c));
-
-		return dist;
+		return distToRectangle(Point2D(x, y), Point2D(-1.0, -1.0), Point2D(1.0, 1.0));
 	}
 
 	double MinimumImpl() const
@@ -0,0 +1,67 @@
+#ifndef MASKEDCONTROLFUNCTION_H
+#define MASKEDCONTROLFUNCTION_H
+
+#include <memory>
+#include <utility>
+#include <cassert>
+
+#include "controlfunction.h"
+#include "domainmask.h"
+
+/// <summary>
+/// A control function whose domain is replaced by a mask of arbitrary shape.
+/// Values are given by the underlying control function.
+/// </summary>
+template<typename Base>
+class MaskedControlFunction : public ControlFunction<MaskedControlFunction<Base> >
+{
+	friend class ControlFunction<MaskedControlFunction<Base> >;
+
+public:
+	MaskedControlFunction(std::unique_ptr<Base> controlFunction, std::shared_ptr<const DomainMask> mask) :
+		m_controlFunction(std::move(controlFunction)),
+		m_mask(std::move(mask))
+	{
+		assert(m_controlFunction);
+		assert(m_mask);
+	}
+
+protected:
+	double EvaluateImpl(double x, double y) const
+	{
+		return m_controlFunction->evaluate(x, y);
+	}
+
+	double EvaluateFootprintImpl(double x, double y, double footprint) const
+	{
+		return m_controlFunction->evaluate(x, y, footprint);
+	}
+
+	bool InsideDomainImpl(double x, double y) const
+	{
+		return m_mask->insideDomain(x, y);
+	}
+
+	double DistToDomainImpl(double x, double y) const
+	{
+		return m_mask->distToDomain(x, y);
+	}
+
+	double MinimumImpl() const
+	{
+		return m_controlFunction->minimum();
+	}
+
+	double MaximumImpl() const
+	{
+		return m_controlFunction->maximum();
+	}
+
+private:
+	const std::unique_ptr<Base> m_controlFunction;
+
+	// The mask can be shared by several control functions
+	const std::shared_ptr<const DomainMask> m_mask;
+};
+
+#endif // MASKEDCONTROLFUNCTION_H
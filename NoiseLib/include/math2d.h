@@ -258,4 +258,6 @@ double distToLine(const Point2D& p, const Point2D& a, const Point2D& b, Point2D&
 double distToLineSegment(const Point2D& p, const Point2D& a, const Point2D& b, Point2D& c);
 double distToLineSegment(const Point2D& p, const Segment2D& s, Point2D& c);
 
+double distToRectangle(const Point2D& p, const Point2D& topLeft, const Point2D& bottomRight);
+
 #endif // MATH2D_H
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef MEMORYMAPPEDFILE_H
+#define MEMORYMAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// A read-only view of a whole file mapped in memory.
+/// Pages are loaded by the operating system only when they are accessed.
+/// </summary>
+class MemoryMappedFile
+{
+public:
+	MemoryMappedFile() = default;
+
+	explicit MemoryMappedFile(const std::string& filename);
+
+	~MemoryMappedFile();
+
+	MemoryMappedFile(const MemoryMappedFile&) = delete;
+	MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+	MemoryMappedFile(MemoryMappedFile&& other) noexcept;
+	MemoryMappedFile& operator=(MemoryMappedFile&& other) noexcept;
+
+	/// <summary>
+	/// Map a file in memory, the previous mapping is closed
+	/// </summary>
+	/// <returns>True if the file is successfully mapped</returns>
+	bool open(const std::string& filename);
+
+	/// <summary>
+	/// Unmap the file
+	/// </summary>
+	void close();
+
+	bool isOpen() const
+	{
+		return m_data != nullptr;
+	}
+
+	const uint8_t* data() const
+	{
+		return m_data;
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	const uint8_t* m_data = nullptr;
+	std::size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_file = -1;
+#endif
+};
+
+#endif // MEMORYMAPPEDFILE_H
@@ -3,12 +3,14 @@
 
 #include <array>
 #include <vector>
+#include <algorithm>
 #include <random>
 #include <tuple>
 #include <limits>
 #include <cmath>
 #include <cassert>
 #include <memory>
+#include <atomic>
 
 #include "math2d.h"
 #include "math3d.h"
@@ -16,11 +18,51 @@
 #include "utils.h"
 #include "perlin.h"
 #include "controlfunction.h"
+#include "rivernetwork.h"
+#include "distancetransform.h"
+#include "pointcache.h"
+#include "executor.h"
 
 template <typename I>
 class Noise
 {
 public:
+	/// <summary>
+	/// Channels computed by evaluateTerrainChannels, combined in a bitmask
+	/// </summary>
+	enum Channel : unsigned int
+	{
+		ChannelElevation = 1 << 0,
+		ChannelDistance = 1 << 1,
+		ChannelLevel = 1 << 2,
+		ChannelDirection = 1 << 3,
+		ChannelFlowTo = 1 << 4,
+		ChannelGradient = 1 << 5,
+		ChannelNormal = 1 << 6,
+		ChannelAll = ChannelElevation | ChannelDistance | ChannelLevel | ChannelDirection | ChannelFlowTo | ChannelGradient | ChannelNormal
+	};
+
+	/// <summary>
+	/// Values of the channels at a point, channels which are not computed keep their default value
+	/// </summary>
+	struct Channels
+	{
+		// Elevation of the terrain, like evaluateTerrain with displayFunction
+		double elevation = 0.0;
+		// Distance to the nearest segment, like evaluateTerrain with displayDistance
+		double distance = 0.0;
+		// Level of the nearest segment, from 1
+		int level = 0;
+		// Normalized direction of the flow along the nearest segment, null if the segment has a length of zero
+		Vec2D direction;
+		// Downstream end of the nearest segment
+		Point2D flowTo;
+		// Analytic gradient of the elevation
+		Vec2D gradient;
+		// Normal of the terrain, with the same unit for the elevation and the coordinates
+		Vec3D normal;
+	};
+
 	Noise(std::unique_ptr<ControlFunction<I>> controlFunction,
 		  const Point2D& noiseTopLeft,
 		  const Point2D& noiseBottomRight,
@@ -42,6 +84,26 @@ public:
 	double evaluateTerrain(double x, double y) const;
 	double evaluateLichtenberg(double x, double y) const;
 
+	Channels evaluateTerrainChannels(double x, double y, unsigned int channels) const;
+
+	RiverNetwork bakeTerrainNetwork(const Point2D& topLeft, const Point2D& bottomRight) const;
+	RiverNetwork bakeLichtenbergNetwork(const Point2D& topLeft, const Point2D& bottomRight) const;
+
+	RiverNetwork bakeTerrainNetwork(const Point2D& topLeft, const Point2D& bottomRight, const RiverNetwork& coarse) const;
+	RiverNetwork bakeLichtenbergNetwork(const Point2D& topLeft, const Point2D& bottomRight, const RiverNetwork& coarse) const;
+
+	int levelsForFootprint(double footprint) const;
+
+	// Points outside of the rectangle the network was baked for are evaluated without the network
+	double evaluateTerrain(double x, double y, const RiverNetwork& network) const;
+	double evaluateLichtenberg(double x, double y, const RiverNetwork& network) const;
+
+	std::vector<std::vector<double> > evaluateDistanceTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const;
+	std::vector<std::vector<double> > evaluateDistanceTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height, std::vector<std::vector<double> >& elevationsOut) const;
+
+	std::vector<std::vector<double> > evaluateTerrainTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const;
+	std::vector<std::vector<double> > evaluateLichtenbergTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const;
+
 private:
 	// ----- Types -----
 	template <typename T, size_t N>
@@ -60,7 +122,7 @@ private:
 	using Segment3DChainArray = Array2D<Segment3DChain<D>, N>;
 
 	// Random generator used by the class
-	typedef std::mt19937_64 RandomGenerator;
+	typedef PointCache::RandomGenerator RandomGenerator;
 
 	enum class ConnectionStrategy
 	{
@@ -84,9 +146,60 @@ private:
 		Cell(const int x, const int y, const int resolution) : x(x), y(y), resolution(resolution) {}
 	};
 
-	// ----- Points -----
+	/// <summary>
+	/// Connectivity of a segment generated by GenerateSegments, as indices in the segment array
+	/// </summary>
+	/// Indices may be outside of the array for the segments on its border, their neighborhood is incomplete.
+	struct FlowNode
+	{
+		// True if the segment has a length, false if it was discarded or if its starting point is a sink
+		bool flows;
+		// Segment in which this segment flows
+		int downstreamI;
+		int downstreamJ;
+		// Number of segments flowing in this segment
+		int upstreamCount;
+		// Last segment flowing in this segment, in the order of the array
+		int lastUpstreamI;
+		int lastUpstreamJ;
+
+		FlowNode() : flows(false), downstreamI(-1), downstreamJ(-1), upstreamCount(0), lastUpstreamI(-1), lastUpstreamJ(-1) {}
+	};
+
+	template <size_t N>
+	using FlowNodeArray = Array2D<FlowNode, N>;
+
+	/// <summary>
+	/// Cells, points and segments of every level around a point
+	/// </summary>
+	struct Hierarchy
+	{
+		Cell cell1;
+		Point2DArray<9> points1;
+		Segment3DChainArray<5, 4> segments1;
+
+		Cell cell2;
+		Point2DArray<5> points2;
+		Segment3DChainArray<5, 3> segments2;
+
+		Cell cell3;
+		Point2DArray<5> points3;
+		Segment3DChainArray<5, 2> segments3;
+
+		Cell cell4;
+		Point2DArray<5> points4;
+		Segment3DChainArray<5, 1> segments4;
+
+		Cell cell5;
+		Point2DArray<5> points5;
+		Segment3DChainArray<5, 1> segments5;
 
-	void InitPointCache();
+		Cell cell6;
+		Point2DArray<5> points6;
+		Segment3DChainArray<5, 1> segments6;
+	};
+
+	// ----- Points -----
 
 	RandomGenerator InitRandomGenerator(int i, int j) const;
 
@@ -99,6 +212,8 @@ private:
 
 	double EvaluateControlFunction(const Point2D& point) const;
 
+	double EvaluateControlFunction(const Point2D& point, int resolution) const;
+
 	bool InsideDomain(const Point2D& point) const;
 
 	bool InsideDomain(const Segment2D& segment) const;
@@ -107,7 +222,7 @@ private:
 
 	bool InsideDomain(const Segment3D& segment) const;
 
-	bool DistToDomain(const Point2D& point) const;
+	double DistToDomain(const Point2D& point) const;
 
 	bool ControlFunctionMinimum() const;
 	
@@ -143,14 +258,10 @@ private:
 	template <size_t N, size_t D, typename ...Tail>
 	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const;
 
-	template <size_t N>
-	int SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentEndingInP) const;
-
-	template <size_t N>
-	int SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentStartingInP) const;
-
 	// ----- Generate -----
 
+	Point2D GenerateNeighboringPoint(int x, int y, int resolution) const;
+
 	template <size_t N>
 	Point2DArray<N> GenerateNeighboringPoints(const Cell& cell) const;
 
@@ -158,16 +269,16 @@ private:
 	void ReplaceNeighboringPoints(const Cell& cell, const Point2DArray<M>& points, const Cell& subCell, Point2DArray<N>& subPoints) const;
 
 	template <size_t N>
-	DoubleArray<N> ComputeElevations(const Point2DArray<N>& points) const;
+	DoubleArray<N> ComputeElevations(const Cell& cell, const Point2DArray<N>& points) const;
 	
 	template <size_t N>
-	Segment3DChainArray<N - 2, 1> GenerateSegments(const Point2DArray<N>& points) const;
+	Segment3DChainArray<N - 2, 1> GenerateSegments(const Cell& cell, const Point2DArray<N>& points, FlowNodeArray<N - 2>& flow) const;
 
 	template <size_t D>
 	void SegmentChainFromPoints(const Point3D& start, const std::array<Point3D, D - 1>& midPoints, const Point3D& end, Segment3DChain<D>& outSegmentChain) const;
 
 	template <size_t N, size_t D>
-	void SubdivideSegments(const Cell& cell, const Segment3DChainArray<N, 1>& segments, Segment3DChainArray<N - 2, D>& subdividedSegments) const;
+	void SubdivideSegments(const Segment3DChainArray<N, 1>& segments, const FlowNodeArray<N>& flow, Segment3DChainArray<N - 2, D>& subdividedSegments) const;
 	
 	template <size_t N, size_t D>
 	void DisplaceSegments(double displacementFactor, const Cell& cell, Segment3DChainArray<N, D>& segments) const;
@@ -179,7 +290,48 @@ private:
 	void CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, Tail&&... tail) const;
 
 	template <size_t N, size_t D, typename ...Tail>
-	Segment3DChainArray<N, D> GenerateSubSegments(const ConnectionStrategy& connectionStrategy, double minSlope, const Point2DArray<N>& points, Tail&&... tail) const;
+	Segment3DChainArray<N, D> GenerateSubSegments(const ConnectionStrategy& connectionStrategy, double minSlope, const Cell& cell, const Point2DArray<N>& points, Tail&&... tail) const;
+
+	template <size_t D, typename ...Tail>
+	Segment3DChain<D> ConnectSubPoint(const ConnectionStrategy& connectionStrategy, double minSlope, const Cell& cell, const Point2D& point, Tail&&... tail) const;
+
+	void GenerateHierarchy(double x, double y, int levels, const ConnectionStrategy& connectionStrategy, const std::array<double, 6>& minSlopes, Hierarchy& hierarchy) const;
+
+	// ----- River network -----
+
+	RiverNetwork BakeNetwork(const Point2D& topLeft, const Point2D& bottomRight, const ConnectionStrategy& connectionStrategy, const std::array<double, 6>& minSlopes, const RiverNetwork* coarse) const;
+
+	bool NetworkContains(const RiverNetwork& network, double x, double y) const;
+
+	template <size_t D>
+	Segment3DChain<D> BakeSubSegments(int level, int x, int y, const ConnectionStrategy& connectionStrategy, const std::array<double, 6>& minSlopes, const RiverNetwork& network, Point2D& pointOut) const;
+
+	template <size_t N>
+	Point2DArray<N> NetworkNeighboringPoints(const RiverNetwork& network, int level, const Cell& cell) const;
+
+	double NearestSegmentInLevel(int neighborhood, const Point2D& point, int level, const RiverNetwork& network, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut) const;
+
+	double NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const RiverNetwork& network) const;
+
+	double NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const RiverNetwork& network, int levels) const;
+
+	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const RiverNetwork& network) const;
+
+	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const RiverNetwork& network, int levels) const;
+
+	// ----- Tiles -----
+
+	void RasterizeSegment(const Segment2D& segment, int label, const Point2D& origin, double spacingX, double spacingY, int rows, int cols, std::vector<double>& features, std::vector<std::pair<std::size_t, int> >& coverage) const;
+
+	std::vector<std::vector<double> > DistanceTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height, std::vector<std::vector<double> >* elevationsOut) const;
+
+	void DistanceGrid(const RiverNetwork& network, const Point2D& topLeft, double spacingX, double spacingY, int width, int height, std::vector<int>& segmentsOut, std::vector<double>& distancesOut) const;
+
+	void SplatCapsule(const Segment2D& segment, double radius, const Point2D& topLeft, const Point2D& bottomRight, std::vector<std::vector<double> >& tile) const;
+
+	std::vector<std::vector<double> > ColorTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const;
+
+	std::vector<std::vector<double> > PrimitivesTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const;
 
 	// ----- Compute Color -----
 
@@ -206,9 +358,19 @@ private:
 	template <size_t N1, size_t D1, size_t N2, typename ...Tail>
 	double ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points, Tail&&... tail) const;
 
+	double ComputeColor(double x, double y, const RiverNetwork& network) const;
+
 	template <size_t N, typename ...Tail>
 	double ComputeColorPrimitives(double x, double y, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const;
 
+	template <size_t N, typename ...Tail>
+	double ComputeColorPrimitives(double x, double y, Vec2D* gradientOut, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const;
+
+	double ComputeColorPrimitives(double x, double y, const RiverNetwork& network) const;
+
+	template <size_t N, typename ...Tail>
+	Channels ComputeChannels(double x, double y, unsigned int channels, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const;
+
 	template <typename ...Tail>
 	double ComputeColorControlFunction(double x, double y, Tail&&... tail) const;
 
@@ -250,9 +412,19 @@ private:
 	// Additional parameter to control the variation of slope on terrains
 	const double m_slopePower;
 
-	const int CACHE_X = 128;
-	const int CACHE_Y = 128;
-	std::vector<std::vector<Point2D> > m_pointCache;
+	// Minimum slopes of the segments of each level, level 1 is not constrained
+	const std::array<double, 6> TERRAIN_MIN_SLOPES = { 0.0, 0.09, 0.18, 0.38, 1.0, 1.0 };
+	const std::array<double, 6> LICHTENBERG_MIN_SLOPES = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+	// Number of segments in the chains of each level
+	const std::array<int, 6> LEVEL_SUBDIVISIONS = { 4, 3, 2, 1, 1, 1 };
+
+	// Cells baked around a rectangle to evaluate its points with a network:
+	// primitives and points of level 1 are looked for up to 4 cells away, then segments in their neighborhood
+	const int NETWORK_MARGIN = 6;
+
+	// Points of the cells around the origin, shared with other noises with the same seed and eps
+	const std::shared_ptr<const PointCache> m_pointCache;
 };
 
 template <typename I>
@@ -273,34 +445,15 @@ Noise<I>::Noise(std::unique_ptr<ControlFunction<I> > controlFunction, const Poin
 	m_displacement(displacement),
     m_primitivesResolutionSteps(primitivesResolutionSteps),
 	m_noiseAmplitudeProportion(noiseAmplitudeProportion),
-	m_slopePower(slopePower)
-{
-	InitPointCache();
-}
-
-template <typename I>
-void Noise<I>::InitPointCache()
+	m_slopePower(slopePower),
+	m_pointCache(PointCache::shared(seed, eps))
 {
-	m_pointCache.resize(CACHE_X);
-
-	for (int x = -CACHE_X / 2; x < CACHE_X / 2; x++)
-	{
-		m_pointCache[x + CACHE_X / 2].resize(CACHE_Y);
-
-		for (int y = -CACHE_Y / 2; y < CACHE_Y / 2; y++)
-		{
-			m_pointCache[x + CACHE_X / 2][y + CACHE_Y / 2] = GeneratePoint(x, y);
-		}
-	}
 }
 
 template <typename I>
 typename Noise<I>::RandomGenerator Noise<I>::InitRandomGenerator(int i, int j) const
 {
-	// TODO: implement a better permutation method
-	const int seed = (541 * i + 79 * j + m_seed) % std::numeric_limits<int>::max();
-	// Fixed seed for internal consistency
-	return RandomGenerator(seed);
+	return PointCache::randomGenerator(m_seed, i, j);
 }
 
 /// <summary>
@@ -313,13 +466,7 @@ typename Noise<I>::RandomGenerator Noise<I>::InitRandomGenerator(int i, int j) c
 template <typename I>
 Point2D Noise<I>::GeneratePoint(int x, int y) const
 {
-	RandomGenerator generator = InitRandomGenerator(x, y);
-
-	std::uniform_real_distribution<double> distribution(m_eps, 1.0 - m_eps);
-	const double px = distribution(generator);
-	const double py = distribution(generator);
-
-	return { double(x) + px, double(y) + py };
+	return PointCache::generatePoint(m_seed, m_eps, x, y);
 }
 
 /// <summary>
@@ -333,9 +480,9 @@ Point2D Noise<I>::GeneratePoint(int x, int y) const
 template <typename I>
 Point2D Noise<I>::GeneratePointCached(int x, int y) const
 {
-	if (x >= -CACHE_X / 2 && x < CACHE_X / 2 && y >= -CACHE_Y / 2 && y < CACHE_Y / 2)
+	if (m_pointCache->contains(x, y))
 	{
-		return m_pointCache[x + CACHE_X / 2][y + CACHE_Y / 2];
+		return m_pointCache->point(x, y);
 	}
 	else
 	{
@@ -407,6 +554,34 @@ double Noise<I>::EvaluateControlFunction(const Point2D& point) const
 	return value;
 }
 
+/// <summary>
+/// Evaluate the control function at a point (x, y) averaged over a cell at a specific resolution.
+/// At coarse resolutions, the control function can be sampled in a low resolution version of itself.
+/// </summary>
+/// <param name="point">Coordinates of the point</param>
+/// <param name="resolution">Resolution of the cell the point belongs to</param>
+/// <returns>The value of the function at the point</returns>
+template <typename I>
+double Noise<I>::EvaluateControlFunction(const Point2D& point, int resolution) const
+{
+	const double x = remap(point.x, m_noiseTopLeft.x, m_noiseBottomRight.x, m_controlFunctionTopLeft.x, m_controlFunctionBottomRight.x);
+	const double y = remap(point.y, m_noiseTopLeft.y, m_noiseBottomRight.y, m_controlFunctionTopLeft.y, m_controlFunctionBottomRight.y);
+
+	// Size of the cell in the coordinates of the control function
+	const double scaleX = std::abs(m_controlFunctionBottomRight.x - m_controlFunctionTopLeft.x) / std::abs(m_noiseBottomRight.x - m_noiseTopLeft.x);
+	const double scaleY = std::abs(m_controlFunctionBottomRight.y - m_controlFunctionTopLeft.y) / std::abs(m_noiseBottomRight.y - m_noiseTopLeft.y);
+	const double footprint = std::max(scaleX, scaleY) / resolution;
+
+	double value = 0.0;
+
+	if (m_controlFunction)
+	{
+		value = m_controlFunction->evaluate(x, y, footprint);
+	}
+
+	return value;
+}
+
 /// <summary>
 /// Check if one point (x, y) is in the domain of the control function
 /// </summary>
@@ -446,7 +621,7 @@ bool Noise<I>::InsideDomain(const Segment3D& segment) const
 }
 
 template <typename I>
-bool Noise<I>::DistToDomain(const Point2D& point) const
+double Noise<I>::DistToDomain(const Point2D& point) const
 {
 	const double x = remap(point.x, m_noiseTopLeft.x, m_noiseBottomRight.x, m_controlFunctionTopLeft.x, m_controlFunctionBottomRight.x);
 	const double y = remap(point.y, m_noiseTopLeft.y, m_noiseBottomRight.y, m_controlFunctionTopLeft.y, m_controlFunctionBottomRight.y);
@@ -759,161 +934,198 @@ double Noise<I>::ComputeColorGrid(double x, double y, double deltaX, double delt
 }
 
 template <typename I>
-double Noise<I>::evaluateTerrain(double x, double y) const
+void Noise<I>::GenerateHierarchy(double x, double y, int levels, const ConnectionStrategy& connectionStrategy, const std::array<double, 6>& minSlopes, Hierarchy& hierarchy) const
 {
-	assert(m_resolution >= 1 && m_resolution <= 5);
+	assert(levels >= 1 && levels <= 6);
 
-	const ConnectionStrategy connectionStrategy = ConnectionStrategy::Rivers;
-	const double minSlopeLevel2 = 0.09;
-	const double minSlopeLevel3 = 0.18;
-	const double minSlopeLevel4 = 0.38;
-	const double minSlopeLevel5 = 1.0;
 	const double displacementLevel1 = m_displacement;
 	const double displacementLevel2 = displacementLevel1 / 4;
 	const double displacementLevel3 = displacementLevel2 / 4;
 
-	double value = 0.0;
-
 	// In which level 1 cell is the point (x, y)
-	Cell cell1 = GetCell(x, y, 1);
+	hierarchy.cell1 = GetCell(x, y, 1);
 	// Level 1: Points in neighboring cells
-	Point2DArray<9> points1 = GenerateNeighboringPoints<9>(cell1);
+	hierarchy.points1 = GenerateNeighboringPoints<9>(hierarchy.cell1);
 	// Level 1: List of segments
-	const Segment3DChainArray<7, 1> straightSegments1 = GenerateSegments(points1);
+	FlowNodeArray<7> flow1;
+	const Segment3DChainArray<7, 1> straightSegments1 = GenerateSegments(hierarchy.cell1, hierarchy.points1, flow1);
 	// Subdivide segments of level 1
-	Segment3DChainArray<5, 4> segments1;
-	SubdivideSegments(cell1, straightSegments1, segments1);
-	DisplaceSegments(displacementLevel1, cell1, segments1);
+	SubdivideSegments(straightSegments1, flow1, hierarchy.segments1);
+	DisplaceSegments(displacementLevel1, hierarchy.cell1, hierarchy.segments1);
+
+	if (levels == 1)
+	{
+		return;
+	}
+
+	// In which level 2 cell is the point (x, y)
+	hierarchy.cell2 = GetCell(x, y, 2);
+	// Level 2: Points in neighboring cells
+	hierarchy.points2 = GenerateNeighboringPoints<5>(hierarchy.cell2);
+	ReplaceNeighboringPoints(hierarchy.cell1, hierarchy.points1, hierarchy.cell2, hierarchy.points2);
+	// Level 2: List of segments
+	hierarchy.segments2 = GenerateSubSegments<5, 3>(connectionStrategy, minSlopes[1], hierarchy.cell2, hierarchy.points2, hierarchy.cell1, hierarchy.segments1);
+	DisplaceSegments(displacementLevel2, hierarchy.cell2, hierarchy.segments2);
+
+	if (levels == 2)
+	{
+		return;
+	}
+
+	// In which level 3 cell is the point (x, y)
+	hierarchy.cell3 = GetCell(x, y, 4);
+	// Level 3: Points in neighboring cells
+	hierarchy.points3 = GenerateNeighboringPoints<5>(hierarchy.cell3);
+	ReplaceNeighboringPoints(hierarchy.cell2, hierarchy.points2, hierarchy.cell3, hierarchy.points3);
+	// Level 3: List of segments
+	hierarchy.segments3 = GenerateSubSegments<5, 2>(connectionStrategy, minSlopes[2], hierarchy.cell3, hierarchy.points3, hierarchy.cell1, hierarchy.segments1, hierarchy.cell2, hierarchy.segments2);
+	DisplaceSegments(displacementLevel3, hierarchy.cell3, hierarchy.segments3);
+
+	if (levels == 3)
+	{
+		return;
+	}
+
+	// In which level 4 cell is the point (x, y)
+	hierarchy.cell4 = GetCell(x, y, 8);
+	// Level 4: Points in neighboring cells
+	hierarchy.points4 = GenerateNeighboringPoints<5>(hierarchy.cell4);
+	ReplaceNeighboringPoints(hierarchy.cell3, hierarchy.points3, hierarchy.cell4, hierarchy.points4);
+	// Level 4: List of segments
+	hierarchy.segments4 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopes[3], hierarchy.cell4, hierarchy.points4, hierarchy.cell1, hierarchy.segments1, hierarchy.cell2, hierarchy.segments2, hierarchy.cell3, hierarchy.segments3);
+
+	if (levels == 4)
+	{
+		return;
+	}
+
+	// In which level 5 cell is the point (x, y)
+	hierarchy.cell5 = GetCell(x, y, 16);
+	// Level 5: Points in neighboring cells
+	hierarchy.points5 = GenerateNeighboringPoints<5>(hierarchy.cell5);
+	ReplaceNeighboringPoints(hierarchy.cell4, hierarchy.points4, hierarchy.cell5, hierarchy.points5);
+	// Level 5: List of segments
+	hierarchy.segments5 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopes[4], hierarchy.cell5, hierarchy.points5, hierarchy.cell1, hierarchy.segments1, hierarchy.cell2, hierarchy.segments2, hierarchy.cell3, hierarchy.segments3, hierarchy.cell4, hierarchy.segments4);
+
+	if (levels == 5)
+	{
+		return;
+	}
+
+	// In which level 6 cell is the point (x, y)
+	hierarchy.cell6 = GetCell(x, y, 32);
+	// Level 6: Points in neighboring cells
+	hierarchy.points6 = GenerateNeighboringPoints<5>(hierarchy.cell6);
+	ReplaceNeighboringPoints(hierarchy.cell5, hierarchy.points5, hierarchy.cell6, hierarchy.points6);
+	// Level 6: List of segments
+	hierarchy.segments6 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopes[5], hierarchy.cell6, hierarchy.points6, hierarchy.cell1, hierarchy.segments1, hierarchy.cell2, hierarchy.segments2, hierarchy.cell3, hierarchy.segments3, hierarchy.cell4, hierarchy.segments4, hierarchy.cell5, hierarchy.segments5);
+}
+
+template <typename I>
+double Noise<I>::evaluateTerrain(double x, double y) const
+{
+	assert(m_resolution >= 1 && m_resolution <= 5);
+
+	Hierarchy h;
+	GenerateHierarchy(x, y, m_resolution, ConnectionStrategy::Rivers, TERRAIN_MIN_SLOPES, h);
+
+	double value = 0.0;
 
 	if (m_resolution == 1)
 	{
 		if (m_displayFunction)
 		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell1, points1, cell1, segments1));
+			value = std::max(value, ComputeColorPrimitives(x, y, h.cell1, h.points1, h.cell1, h.segments1));
 		}
 		
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1));
 		}
 		
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1));
 		}
 
 		return value;
 	}
 
-	// In which level 2 cell is the point (x, y)
-	Cell cell2 = GetCell(x, y, 2);
-	// Level 2: Points in neighboring cells
-	Point2DArray<5> points2 = GenerateNeighboringPoints<5>(cell2);
-	ReplaceNeighboringPoints(cell1, points1, cell2, points2);
-	// Level 2: List of segments
-	Segment3DChainArray<5, 3> segments2 = GenerateSubSegments<5, 3>(connectionStrategy, minSlopeLevel2, points2, cell1, segments1);
-	DisplaceSegments(displacementLevel2, cell2, segments2);
-
 	if (m_resolution == 2)
 	{
 		if (m_displayFunction)
 		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell2, points2, cell1, segments1, cell2, segments2));
+			value = std::max(value, ComputeColorPrimitives(x, y, h.cell2, h.points2, h.cell1, h.segments1, h.cell2, h.segments2));
 		}
 
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2));
 		}
 
 		if (m_displayDistance)
 		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2);
+			value = ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2);
 		}
 
 		return value;
 	}
-	
-	// In which level 3 cell is the point (x, y)
-	Cell cell3 = GetCell(x, y, 4);
-	// Level 3: Points in neighboring cells
-	Point2DArray<5> points3 = GenerateNeighboringPoints<5>(cell3);
-	ReplaceNeighboringPoints(cell2, points2, cell3, points3);
-	// Level 3: List of segments
-	Segment3DChainArray<5, 2> segments3 = GenerateSubSegments<5, 2>(connectionStrategy, minSlopeLevel3, points3, cell1, segments1, cell2, segments2);
-	DisplaceSegments(displacementLevel3, cell3, segments3);
 
 	if (m_resolution == 3)
 	{
 		if (m_displayFunction)
 		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell3, points3, cell1, segments1, cell2, segments2, cell3, segments3));
+			value = std::max(value, ComputeColorPrimitives(x, y, h.cell3, h.points3, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3));
 		}
 
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3));
 		}
 
 		if (m_displayDistance)
 		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3);
+			value = ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3);
 		}
 
 		return value;
 	}
-	
-	// In which level 4 cell is the point (x, y)
-	Cell cell4 = GetCell(x, y, 8);
-	// Level 4: Points in neighboring cells
-	Point2DArray<5> points4 = GenerateNeighboringPoints<5>(cell4);
-	ReplaceNeighboringPoints(cell3, points3, cell4, points4);
-	// Level 4: List of segments
-	Segment3DChainArray<5, 1> segments4 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopeLevel4, points4, cell1, segments1, cell2, segments2, cell3, segments3);
 
 	if (m_resolution == 4)
 	{
 		if (m_displayFunction)
 		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell4, points4, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4));
+			value = std::max(value, ComputeColorPrimitives(x, y, h.cell4, h.points4, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4));
 		}
 
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3, h.cell4, h.segments4, h.points4));
 		}
 
 		if (m_displayDistance)
 		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4);
+			value = ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4);
 		}
 
 		return value;
 	}
 
-	// In which level 5 cell is the point (x, y)
-	Cell cell5 = GetCell(x, y, 16);
-	// Level 5: Points in neighboring cells
-	Point2DArray<5> points5 = GenerateNeighboringPoints<5>(cell5);
-	ReplaceNeighboringPoints(cell4, points4, cell5, points5);
-	// Level 5: List of segments
-	Segment3DChainArray<5, 1> segments5 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopeLevel5, points5, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4);
-
 	if (m_resolution == 5)
 	{
 		if (m_displayFunction)
 		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell5, points5, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5));
+			value = std::max(value, ComputeColorPrimitives(x, y, h.cell5, h.points5, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4, h.cell5, h.segments5));
 		}
 
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4, cell5, segments5, points5));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3, h.cell4, h.segments4, h.points4, h.cell5, h.segments5, h.points5));
 		}
 
 		if (m_displayDistance)
 		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5);
+			value = ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4, h.cell5, h.segments5);
 		}
 
 		return value;
@@ -922,156 +1134,132 @@ double Noise<I>::evaluateTerrain(double x, double y) const
 	return value;
 }
 
+/// <summary>
+/// Evaluate several channels of the terrain at a point (x, y) from a single hierarchy.
+/// This avoids generating the hierarchy once per channel, for example to render the elevation and the distance of a terrain.
+/// </summary>
+/// <param name="x">x coordinate of the point</param>
+/// <param name="y">y coordinate of the point</param>
+/// <param name="channels">Bitmask of the channels to compute</param>
+/// <returns>Values of the channels at the point</returns>
+template <typename I>
+typename Noise<I>::Channels Noise<I>::evaluateTerrainChannels(double x, double y, unsigned int channels) const
+{
+	assert(m_resolution >= 1 && m_resolution <= 5);
+
+	Hierarchy h;
+	GenerateHierarchy(x, y, m_resolution, ConnectionStrategy::Rivers, TERRAIN_MIN_SLOPES, h);
+
+	switch (m_resolution)
+	{
+	case 1:
+		return ComputeChannels(x, y, channels, h.cell1, h.points1, h.cell1, h.segments1);
+	case 2:
+		return ComputeChannels(x, y, channels, h.cell2, h.points2, h.cell1, h.segments1, h.cell2, h.segments2);
+	case 3:
+		return ComputeChannels(x, y, channels, h.cell3, h.points3, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3);
+	case 4:
+		return ComputeChannels(x, y, channels, h.cell4, h.points4, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4);
+	default:
+		return ComputeChannels(x, y, channels, h.cell5, h.points5, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4, h.cell5, h.segments5);
+	}
+}
+
 template <typename I>
 double Noise<I>::evaluateLichtenberg(double x, double y) const
 {
 	assert(m_resolution >= 1 && m_resolution <= 6);
 
-	const ConnectionStrategy connectionStrategy = ConnectionStrategy::AngleMid;
-	const double displacementLevel1 = m_displacement;
-	const double displacementLevel2 = displacementLevel1 / 4;
-	const double displacementLevel3 = displacementLevel2 / 4;
+	Hierarchy h;
+	GenerateHierarchy(x, y, m_resolution, ConnectionStrategy::AngleMid, LICHTENBERG_MIN_SLOPES, h);
 
 	double value = 0.0;
 
-	// In which level 1 cell is the point (x, y)
-	Cell cell1 = GetCell(x, y, 1);
-	// Level 1: Points in neighboring cells
-	Point2DArray<9> points1 = GenerateNeighboringPoints<9>(cell1);
-	// Level 1: List of segments
-	const Segment3DChainArray<7, 1> straightSegments1 = GenerateSegments(points1);
-	// Subdivide segments of level 1
-	Segment3DChainArray<5, 4> segments1;
-	SubdivideSegments(cell1, straightSegments1, segments1);
-	DisplaceSegments(displacementLevel1, cell1, segments1);
-
 	if (m_resolution == 1)
 	{
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1));
 		}
 
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1));
 		}
 
 		return value;
 	}
 
-	// In which level 2 cell is the point (x, y)
-	Cell cell2 = GetCell(x, y, 2);
-	// Level 2: Points in neighboring cells
-	Point2DArray<5> points2 = GenerateNeighboringPoints<5>(cell2);
-	ReplaceNeighboringPoints(cell1, points1, cell2, points2);
-	// Level 2: List of segments
-	Segment3DChainArray<5, 3> segments2 = GenerateSubSegments<5, 3>(connectionStrategy, 0.0, points2, cell1, segments1);
-	DisplaceSegments(displacementLevel2, cell2, segments2);
-
 	if (m_resolution == 2)
 	{
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2));
 		}
 
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2));
 		}
 
 		return value;
 	}
 
-	// In which level 3 cell is the point (x, y)
-	Cell cell3 = GetCell(x, y, 4);
-	// Level 3: Points in neighboring cells
-	Point2DArray<5> points3 = GenerateNeighboringPoints<5>(cell3);
-	ReplaceNeighboringPoints(cell2, points2, cell3, points3);
-	// Level 3: List of segments
-	Segment3DChainArray<5, 2> segments3 = GenerateSubSegments<5, 2>(connectionStrategy, 0.0, points3, cell1, segments1, cell2, segments2);
-	DisplaceSegments(displacementLevel3, cell3, segments3);
-
 	if (m_resolution == 3)
 	{
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3));
 		}
 
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3));
 		}
 
 		return value;
 	}
 
-	// In which level 4 cell is the point (x, y)
-	Cell cell4 = GetCell(x, y, 8);
-	// Level 4: Points in neighboring cells
-	Point2DArray<5> points4 = GenerateNeighboringPoints<5>(cell4);
-	ReplaceNeighboringPoints(cell3, points3, cell4, points4);
-	// Level 4: List of segments
-	Segment3DChainArray<5, 1> segments4 = GenerateSubSegments<5, 1>(connectionStrategy, 0.0, points4, cell1, segments1, cell2, segments2, cell3, segments3);
-
 	if (m_resolution == 4)
 	{
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3, h.cell4, h.segments4, h.points4));
 		}
 
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4));
 		}
 
 		return value;
 	}
 
-	// In which level 5 cell is the point (x, y)
-	Cell cell5 = GetCell(x, y, 16);
-	// Level 5: Points in neighboring cells
-	Point2DArray<5> points5 = GenerateNeighboringPoints<5>(cell5);
-	ReplaceNeighboringPoints(cell4, points4, cell5, points5);
-	// Level 5: List of segments
-	Segment3DChainArray<5, 1> segments5 = GenerateSubSegments<5, 1>(connectionStrategy, 0.0, points5, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4);
-
 	if (m_resolution == 5)
 	{
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4, cell5, segments5, points5));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3, h.cell4, h.segments4, h.points4, h.cell5, h.segments5, h.points5));
 		}
 
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4, h.cell5, h.segments5));
 		}
 
 		return value;
 	}
 
-	// In which level 6 cell is the point (x, y)
-	Cell cell6 = GetCell(x, y, 32);
-	// Level 6: Points in neighboring cells
-	Point2DArray<5> points6 = GenerateNeighboringPoints<5>(cell6);
-	ReplaceNeighboringPoints(cell5, points5, cell6, points6);
-	// Level 6: List of segments
-	Segment3DChainArray<5, 1> segments6 = GenerateSubSegments<5, 1>(connectionStrategy, 0.0, points6, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5);
-
 	if (m_resolution == 6)
 	{
 		if (m_displayPoints || m_displaySegments || m_displayGrid)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4, cell5, segments5, points5, cell6, segments6, points6));
+			value = std::max(value, ComputeColor(x, y, h.cell1, h.segments1, h.points1, h.cell2, h.segments2, h.points2, h.cell3, h.segments3, h.points3, h.cell4, h.segments4, h.points4, h.cell5, h.segments5, h.points5, h.cell6, h.segments6, h.points6));
 		}
 
 		if (m_displayDistance)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5, cell6, segments6));
+			value = std::max(value, ComputeColorDistance(x, y, h.cell1, h.segments1, h.cell2, h.segments2, h.cell3, h.segments3, h.cell4, h.segments4, h.cell5, h.segments5, h.cell6, h.segments6));
 		}
 
 		return value;
@@ -1081,59 +1269,1247 @@ double Noise<I>::evaluateLichtenberg(double x, double y) const
 }
 
 template <typename I>
-template <typename T, size_t N>
-std::tuple<int, int> Noise<I>::GetArrayCell(const Cell& arrCell, const Array2D<T, N>& arr, const Cell& cell) const
+RiverNetwork Noise<I>::bakeTerrainNetwork(const Point2D& topLeft, const Point2D& bottomRight) const
 {
-	const int i = (int(arr.size()) / 2) - arrCell.y + cell.y;
-	const int j = (int(arr.front().size()) / 2) - arrCell.x + cell.x;
+	assert(m_resolution >= 1 && m_resolution <= 5);
 
-	return std::make_tuple(i, j);
+	return BakeNetwork(topLeft, bottomRight, ConnectionStrategy::Rivers, TERRAIN_MIN_SLOPES, nullptr);
 }
 
 template <typename I>
-template <size_t N, size_t D>
-double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const
+RiverNetwork Noise<I>::bakeLichtenbergNetwork(const Point2D& topLeft, const Point2D& bottomRight) const
 {
-	assert(neighborhood >= 0);
-
-	// Distance to the nearest segment
-	double nearestSegmentDistance = std::numeric_limits<double>::max();
-
-	int ci, cj;
-	std::tie(ci, cj) = GetArrayCell(cell, segments, GetCell(point.x, point.y, cell.resolution));
-	for (int i = ci - neighborhood; i <= ci + neighborhood; i++)
-	{
-		for (int j = cj - neighborhood; j <= cj + neighborhood; j++)
-		{
-			assert(i >= 0 && static_cast<unsigned int>(i) < segments.size());
-			assert(j >= 0 && static_cast<unsigned int>(j) < segments.front().size());
-
-			for (unsigned int k = 0; k < segments[i][j].size(); k++)
-			{
-				Point2D c;
-				const double dist = distToLineSegment(point, ProjectionZ(segments[i][j][k]), c);
+	assert(m_resolution >= 1 && m_resolution <= 6);
 
-				if (dist < nearestSegmentDistance)
-				{
-					nearestSegmentDistance = dist;
-					nearestSegmentOut = segments[i][j][k];
+	return BakeNetwork(topLeft, bottomRight, ConnectionStrategy::AngleMid, LICHTENBERG_MIN_SLOPES, nullptr);
+}
 
-					nearestSegmentCellOut.x = i;
-					nearestSegmentCellOut.y = j;
-					nearestSegmentCellOut.resolution = cell.resolution;
-				}
-			}
-		}
-	}
+/// <summary>
+/// Bake a terrain network, copying the levels of a coarse network instead of generating them when it covers them.
+/// The cells of a level only depend on the cell and on the coarser levels, so the coarse network can be baked
+/// by a noise with fewer levels over a larger rectangle, as long as its other parameters are the same.
+/// Networks of neighboring rectangles can then share the generation of their coarse levels.
+/// </summary>
+/// <param name="topLeft">Top left corner of the rectangle in the coordinates of the noise</param>
+/// <param name="bottomRight">Bottom right corner of the rectangle in the coordinates of the noise</param>
+/// <param name="coarse">Network baked by bakeTerrainNetwork with the same seed and parameters</param>
+template <typename I>
+RiverNetwork Noise<I>::bakeTerrainNetwork(const Point2D& topLeft, const Point2D& bottomRight, const RiverNetwork& coarse) const
+{
+	assert(m_resolution >= 1 && m_resolution <= 5);
 
-	return nearestSegmentDistance;
+	return BakeNetwork(topLeft, bottomRight, ConnectionStrategy::Rivers, TERRAIN_MIN_SLOPES, &coarse);
 }
 
+/// <summary>
+/// Bake a Lichtenberg network, copying the levels of a coarse network instead of generating them when it covers them.
+/// See bakeTerrainNetwork.
+/// </summary>
 template <typename I>
-template <size_t N, size_t D, typename ...Tail>
-double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
+RiverNetwork Noise<I>::bakeLichtenbergNetwork(const Point2D& topLeft, const Point2D& bottomRight, const RiverNetwork& coarse) const
 {
-	assert(neighborhood >= 0);
+	assert(m_resolution >= 1 && m_resolution <= 6);
+
+	return BakeNetwork(topLeft, bottomRight, ConnectionStrategy::AngleMid, LICHTENBERG_MIN_SLOPES, &coarse);
+}
+
+/// <summary>
+/// Number of levels needed to render pixels of a given size: a level is only needed if its segments are at least one pixel long.
+/// Segments of a level are about the size of its cells divided by the number of segments in their chain.
+/// </summary>
+/// <param name="footprint">Size of a pixel in the coordinates of the noise</param>
+/// <returns>A number of levels between 1 and the resolution of the noise</returns>
+template <typename I>
+int Noise<I>::levelsForFootprint(double footprint) const
+{
+	int levels = 1;
+
+	while (levels < m_resolution)
+	{
+		// Cells of the next level are half the size of the cells of this level
+		const double segmentLength = 1.0 / double(1 << levels) / LEVEL_SUBDIVISIONS[levels];
+		if (segmentLength < footprint)
+		{
+			break;
+		}
+
+		levels++;
+	}
+
+	return levels;
+}
+
+/// <summary>
+/// Evaluate the terrain at a point (x, y) using a network baked by bakeTerrainNetwork.
+/// The network may have more levels than the resolution of the noise, only the first ones are used.
+/// Points outside of the rectangle the network was baked for are evaluated without the network, with the same result but slower.
+/// </summary>
+template <typename I>
+double Noise<I>::evaluateTerrain(double x, double y, const RiverNetwork& network) const
+{
+	assert(m_resolution >= 1 && m_resolution <= network.levels());
+
+	if (!NetworkContains(network, x, y))
+	{
+		return evaluateTerrain(x, y);
+	}
+
+	double value = 0.0;
+
+	if (m_displayFunction)
+	{
+		value = std::max(value, ComputeColorPrimitives(x, y, network));
+	}
+
+	if (m_displayPoints || m_displaySegments || m_displayGrid)
+	{
+		value = std::max(value, ComputeColor(x, y, network));
+	}
+
+	if (m_displayDistance)
+	{
+		// Like without network, the distance replaces the other values above resolution 1
+		const double distance = ComputeColorDistance(x, y, network);
+		value = m_resolution == 1 ? std::max(value, distance) : distance;
+	}
+
+	return value;
+}
+
+/// <summary>
+/// Evaluate the Lichtenberg figure at a point (x, y) using a network baked by bakeLichtenbergNetwork.
+/// The network may have more levels than the resolution of the noise, only the first ones are used.
+/// Points outside of the rectangle the network was baked for are evaluated without the network, with the same result but slower.
+/// </summary>
+template <typename I>
+double Noise<I>::evaluateLichtenberg(double x, double y, const RiverNetwork& network) const
+{
+	assert(m_resolution >= 1 && m_resolution <= network.levels());
+
+	if (!NetworkContains(network, x, y))
+	{
+		return evaluateLichtenberg(x, y);
+	}
+
+	double value = 0.0;
+
+	if (m_displayPoints || m_displaySegments || m_displayGrid)
+	{
+		value = std::max(value, ComputeColor(x, y, network));
+	}
+
+	if (m_displayDistance)
+	{
+		value = std::max(value, ComputeColorDistance(x, y, network));
+	}
+
+	return value;
+}
+
+/// <summary>
+/// Generate the network of all the levels in the cells covering a rectangle.
+/// Segments of a cell only depend on the cell, so each one is generated once: level 1 from the center of its cell,
+/// the other levels from the points and segments of the coarser levels already stored in the network.
+/// </summary>
+/// <param name="topLeft">Top left corner of the rectangle in the coordinates of the noise</param>
+/// <param name="bottomRight">Bottom right corner of the rectangle in the coordinates of the noise</param>
+/// <param name="coarse">Network whose levels are copied when they contain the cells of the rectangle, nullptr to generate all the levels</param>
+/// <returns>The baked network, with one level per resolution of the noise</returns>
+template <typename I>
+RiverNetwork Noise<I>::BakeNetwork(const Point2D& topLeft, const Point2D& bottomRight, const ConnectionStrategy& connectionStrategy, const std::array<double, 6>& minSlopes, const RiverNetwork* coarse) const
+{
+	RiverNetwork network;
+
+	for (int level = 1; level <= m_resolution; level++)
+	{
+		const int resolution = 1 << (level - 1);
+		const Cell minCell = GetCell(std::min(topLeft.x, bottomRight.x), std::min(topLeft.y, bottomRight.y), resolution);
+		const Cell maxCell = GetCell(std::max(topLeft.x, bottomRight.x), std::max(topLeft.y, bottomRight.y), resolution);
+
+		if (coarse != nullptr && level <= coarse->levels()
+			&& coarse->containsCell(level, minCell.x - NETWORK_MARGIN, minCell.y - NETWORK_MARGIN)
+			&& coarse->containsCell(level, maxCell.x + NETWORK_MARGIN, maxCell.y + NETWORK_MARGIN))
+		{
+			assert(coarse->resolution(level) == resolution);
+
+			network.addLevel(*coarse, level, minCell.x - NETWORK_MARGIN, minCell.y - NETWORK_MARGIN, maxCell.x + NETWORK_MARGIN, maxCell.y + NETWORK_MARGIN);
+			continue;
+		}
+
+		network.addLevel(resolution, LEVEL_SUBDIVISIONS[level - 1], minCell.x - NETWORK_MARGIN, minCell.y - NETWORK_MARGIN, maxCell.x + NETWORK_MARGIN, maxCell.y + NETWORK_MARGIN);
+
+		const int minX = minCell.x - NETWORK_MARGIN;
+		const int minY = minCell.y - NETWORK_MARGIN;
+		const int width = maxCell.x - minCell.x + 2 * NETWORK_MARGIN + 1;
+		const int height = maxCell.y - minCell.y + 2 * NETWORK_MARGIN + 1;
+
+		Executor::global().parallelFor(0, width * height, [&](int c)
+		{
+			const int cx = minX + c % width;
+			const int cy = minY + c / width;
+
+			Point2D point;
+
+			// Displacement factors and subdivisions of the levels, like in GenerateHierarchy
+			switch (level)
+			{
+			case 1:
+			{
+				// The cell is at the center of the arrays generated from its center
+				Hierarchy h;
+				GenerateHierarchy((cx + 0.5) / resolution, (cy + 0.5) / resolution, 1, connectionStrategy, minSlopes, h);
+				network.setCell(level, cx, cy, h.points1[4][4], h.segments1[2][2]);
+				break;
+			}
+			case 2:
+			{
+				Segment3DChainArray<1, 3> segments;
+				segments[0][0] = BakeSubSegments<3>(level, cx, cy, connectionStrategy, minSlopes, network, point);
+				DisplaceSegments(m_displacement / 4, Cell(cx, cy, resolution), segments);
+				network.setCell(level, cx, cy, point, segments[0][0]);
+				break;
+			}
+			case 3:
+			{
+				Segment3DChainArray<1, 2> segments;
+				segments[0][0] = BakeSubSegments<2>(level, cx, cy, connectionStrategy, minSlopes, network, point);
+				DisplaceSegments(m_displacement / 4 / 4, Cell(cx, cy, resolution), segments);
+				network.setCell(level, cx, cy, point, segments[0][0]);
+				break;
+			}
+			default:
+			{
+				const Segment3DChain<1> segments = BakeSubSegments<1>(level, cx, cy, connectionStrategy, minSlopes, network, point);
+				network.setCell(level, cx, cy, point, segments);
+				break;
+			}
+			}
+		});
+	}
+
+	return network;
+}
+
+/// <summary>
+/// Check that a network has all the cells needed to evaluate a point, as baked around a rectangle containing it.
+/// </summary>
+template <typename I>
+bool Noise<I>::NetworkContains(const RiverNetwork& network, double x, double y) const
+{
+	for (int level = 1; level <= m_resolution; level++)
+	{
+		const Cell cell = GetCell(x, y, network.resolution(level));
+
+		if (!network.containsCell(level, cell.x - NETWORK_MARGIN, cell.y - NETWORK_MARGIN)
+			|| !network.containsCell(level, cell.x + NETWORK_MARGIN, cell.y + NETWORK_MARGIN))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Generate the point and the segments of a cell of a level above 1 from the coarser levels of a network, like GenerateHierarchy does with arrays.
+/// </summary>
+/// <param name="level">Level of the cell, the coarser levels must already be stored in the network around the cell</param>
+/// <param name="pointOut">Point of the cell</param>
+/// <returns>Segments connecting the point of the cell to the nearest segment of the coarser levels, not displaced</returns>
+template <typename I>
+template <size_t D>
+typename Noise<I>::template Segment3DChain<D> Noise<I>::BakeSubSegments(int level, int x, int y, const ConnectionStrategy& connectionStrategy, const std::array<double, 6>& minSlopes, const RiverNetwork& network, Point2D& pointOut) const
+{
+	assert(level >= 2 && level <= network.levels());
+
+	const int resolution = network.resolution(level);
+	const Cell cell(x, y, resolution);
+
+	// Like ReplaceNeighboringPoints, the point of the cell is replaced by the point of the parent level lying in it
+	pointOut = GenerateNeighboringPoint(x, y, resolution);
+	const Cell parentCell = GetCell((x + 0.5) / resolution, (y + 0.5) / resolution, network.resolution(level - 1));
+	for (int i = parentCell.y - 1; i <= parentCell.y + 1; i++)
+	{
+		for (int j = parentCell.x - 1; j <= parentCell.x + 1; j++)
+		{
+			const Point2D parentPoint = network.point(level - 1, j, i);
+			const Cell parentPointCell = GetCell(parentPoint.x, parentPoint.y, resolution);
+
+			if (parentPointCell.x == x && parentPointCell.y == y)
+			{
+				pointOut = parentPoint;
+			}
+		}
+	}
+
+	return ConnectSubPoint<D>(connectionStrategy, minSlopes[level - 1], cell, pointOut, network, level - 1);
+}
+
+template <typename I>
+template <size_t N>
+typename Noise<I>::template Point2DArray<N> Noise<I>::NetworkNeighboringPoints(const RiverNetwork& network, int level, const Cell& cell) const
+{
+	Point2DArray<N> points;
+
+	for (unsigned int i = 0; i < points.size(); i++)
+	{
+		for (unsigned int j = 0; j < points[i].size(); j++)
+		{
+			const int x = cell.x + j - int(points[i].size()) / 2;
+			const int y = cell.y + i - int(points.size()) / 2;
+
+			points[i][j] = network.point(level, x, y);
+		}
+	}
+
+	return points;
+}
+
+/// <summary>
+/// Find the nearest segment to a point in the cells of one level of a network.
+/// Cells and segments are visited in the same order as in the arrays of the hierarchy.
+/// </summary>
+template <typename I>
+double Noise<I>::NearestSegmentInLevel(int neighborhood, const Point2D& point, int level, const RiverNetwork& network, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut) const
+{
+	assert(neighborhood >= 0);
+
+	// Distance to the nearest segment
+	double nearestSegmentDistance = std::numeric_limits<double>::max();
+
+	const Cell cell = GetCell(point.x, point.y, network.resolution(level));
+	for (int i = cell.y - neighborhood; i <= cell.y + neighborhood; i++)
+	{
+		for (int j = cell.x - neighborhood; j <= cell.x + neighborhood; j++)
+		{
+			assert(network.containsCell(level, j, i));
+
+			const int firstEdge = network.firstEdge(level, j, i);
+			for (int k = 0; k < network.segmentsPerCell(level); k++)
+			{
+				const Segment3D segment = network.segment(firstEdge + k);
+
+				Point2D c;
+				const double dist = distToLineSegment(point, ProjectionZ(segment), c);
+
+				if (dist < nearestSegmentDistance)
+				{
+					nearestSegmentDistance = dist;
+					nearestSegmentOut = segment;
+
+					nearestSegmentCellOut.x = j;
+					nearestSegmentCellOut.y = i;
+					nearestSegmentCellOut.resolution = cell.resolution;
+				}
+			}
+		}
+	}
+
+	return nearestSegmentDistance;
+}
+
+template <typename I>
+double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const RiverNetwork& network) const
+{
+	return NearestSegmentAndCellProjectionZ(neighborhood, point, nearestSegmentCellOut, nearestSegmentOut, network, m_resolution);
+}
+
+/// <summary>
+/// Find the nearest segment to a point in the first levels of a network.
+/// </summary>
+/// <param name="levels">Number of levels to search, from level 1</param>
+template <typename I>
+double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const RiverNetwork& network, int levels) const
+{
+	assert(levels >= 1 && levels <= network.levels());
+
+	// Distance to the nearest segment
+	double nearestSegmentDistance = std::numeric_limits<double>::max();
+
+	// When two levels are at the same distance, the lowest level wins, like with arrays of segments
+	for (int level = 1; level <= levels; level++)
+	{
+		Cell levelSegmentCell;
+		Segment3D levelSegment;
+		const double levelSegmentDistance = NearestSegmentInLevel(neighborhood, point, level, network, levelSegmentCell, levelSegment);
+
+		if (levelSegmentDistance < nearestSegmentDistance)
+		{
+			nearestSegmentDistance = levelSegmentDistance;
+			nearestSegmentOut = levelSegment;
+			nearestSegmentCellOut = levelSegmentCell;
+		}
+	}
+
+	return nearestSegmentDistance;
+}
+
+template <typename I>
+double Noise<I>::NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const RiverNetwork& network) const
+{
+	Cell placeholderCell;
+	return NearestSegmentAndCellProjectionZ(neighborhood, point, placeholderCell, nearestSegmentOut, network);
+}
+
+template <typename I>
+double Noise<I>::NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const RiverNetwork& network, int levels) const
+{
+	Cell placeholderCell;
+	return NearestSegmentAndCellProjectionZ(neighborhood, point, placeholderCell, nearestSegmentOut, network, levels);
+}
+
+/// <summary>
+/// Distance to the nearest segment for every pixel of a tile, like the displayDistance mode, using a network baked by bakeTerrainNetwork or bakeLichtenbergNetwork.
+/// Segments are rasterized in the tile, then the nearest segment of each pixel is found by a Euclidean distance transform,
+/// whose candidate segments are re-checked by the neighboring pixels until every pixel has its nearest segment: the distances are exact.
+/// The cost is linear in the number of pixels instead of being proportional to the number of pixels times the number of segments in their neighborhood.
+/// </summary>
+/// <param name="network">A network covering the tile</param>
+/// <param name="topLeft">Coordinates of the pixel (0, 0)</param>
+/// <param name="bottomRight">Coordinates of the pixel (height, width), right after the last pixel of the tile</param>
+/// <param name="width">Number of columns of the tile</param>
+/// <param name="height">Number of rows of the tile</param>
+/// <returns>Distances of the pixels, row by row</returns>
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::evaluateDistanceTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const
+{
+	return DistanceTile(network, topLeft, bottomRight, width, height, nullptr);
+}
+
+/// <summary>
+/// Distance to the nearest segment for every pixel of a tile, and elevation of the nearest point on this segment.
+/// </summary>
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::evaluateDistanceTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height, std::vector<std::vector<double> >& elevationsOut) const
+{
+	return DistanceTile(network, topLeft, bottomRight, width, height, &elevationsOut);
+}
+
+/// <summary>
+/// Mark the samples of a grid covered by a segment as features of a distance transform.
+/// Features are the squared distances from the samples to the segment, so that the transform does not round segments to the grid.
+/// </summary>
+/// <param name="segment">Segment in the coordinates of the noise</param>
+/// <param name="label">Label of the segment</param>
+/// <param name="origin">Coordinates of the sample (0, 0) of the grid</param>
+/// <param name="spacingX">Distance between two columns of the grid</param>
+/// <param name="spacingY">Distance between two rows of the grid</param>
+/// <param name="coverage">Pairs of a covered sample and the label of the segment, a sample may be covered by several segments</param>
+template <typename I>
+void Noise<I>::RasterizeSegment(const Segment2D& segment, int label, const Point2D& origin, double spacingX, double spacingY, int rows, int cols, std::vector<double>& features, std::vector<std::pair<std::size_t, int> >& coverage) const
+{
+	// Sample the segment at least twice per pixel so that no pixel is skipped
+	const double lengthInPixels = std::max(std::abs(segment.b.x - segment.a.x) / spacingX, std::abs(segment.b.y - segment.a.y) / spacingY);
+	const int samples = int(std::ceil(2.0 * lengthInPixels)) + 1;
+
+	for (int s = 0; s < samples; s++)
+	{
+		const double t = (samples > 1) ? double(s) / (samples - 1) : 0.0;
+		const Point2D p = lerp(segment, t);
+
+		const int i = int(std::lround((p.y - origin.y) / spacingY));
+		const int j = int(std::lround((p.x - origin.x) / spacingX));
+
+		if (i >= 0 && i < rows && j >= 0 && j < cols)
+		{
+			// Features of samples covered by several segments are the distances to the nearest one
+			Point2D c;
+			const double dist = distToLineSegment(Point2D(origin.x + j * spacingX, origin.y + i * spacingY), segment, c);
+			const std::size_t sample = std::size_t(i) * cols + j;
+			features[sample] = std::min(features[sample], dist * dist);
+
+			// Consecutive points of the segment often fall in the same sample
+			if (coverage.empty() || coverage.back() != std::make_pair(sample, label))
+			{
+				coverage.emplace_back(sample, label);
+			}
+		}
+	}
+}
+
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::DistanceTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height, std::vector<std::vector<double> >* elevationsOut) const
+{
+	assert(width > 0 && height > 0);
+	assert(m_resolution >= 1 && m_resolution <= network.levels());
+
+	// Pixel (i, j) is at topLeft + (j * spacingX, i * spacingY), like in a loop over the pixels of an image
+	const double spacingX = (bottomRight.x - topLeft.x) / width;
+	const double spacingY = (bottomRight.y - topLeft.y) / height;
+	assert(spacingX > 0.0 && spacingY > 0.0);
+
+	std::vector<int> tileSegments;
+	std::vector<double> tileDistances;
+	DistanceGrid(network, topLeft, spacingX, spacingY, width, height, tileSegments, tileDistances);
+
+	std::vector<std::vector<double> > distances(height, std::vector<double>(width));
+	if (elevationsOut != nullptr)
+	{
+		elevationsOut->assign(height, std::vector<double>(width));
+	}
+
+	Executor::global().parallelFor(0, height, [&](int i)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			const std::size_t pixel = std::size_t(i) * width + j;
+
+			distances[i][j] = tileDistances[pixel];
+
+			if (elevationsOut != nullptr)
+			{
+				const Point2D point(topLeft.x + j * spacingX, topLeft.y + i * spacingY);
+				const Segment3D nearestSegment = network.segment(tileSegments[pixel]);
+				const double u = pointLineSegmentProjection(point, ProjectionZ(nearestSegment));
+				(*elevationsOut)[i][j] = lerp(nearestSegment.a.z, nearestSegment.b.z, u);
+			}
+		}
+	});
+
+	return distances;
+}
+
+/// <summary>
+/// Nearest segment of every pixel of a tile.
+/// Segments are rasterized in the grid of the pixels, then the candidates of the nearest features found by a distance transform are re-checked by the neighboring samples.
+/// </summary>
+/// <param name="network">A network covering the tile</param>
+/// <param name="topLeft">Coordinates of the pixel (0, 0)</param>
+/// <param name="spacingX">Distance between two columns of the tile</param>
+/// <param name="spacingY">Distance between two rows of the tile</param>
+/// <param name="width">Number of columns of the tile</param>
+/// <param name="height">Number of rows of the tile</param>
+/// <param name="segmentsOut">Index of the nearest segment in the network of every pixel, row by row</param>
+/// <param name="distancesOut">Distance to the nearest segment of every pixel, row by row</param>
+template <typename I>
+void Noise<I>::DistanceGrid(const RiverNetwork& network, const Point2D& topLeft, double spacingX, double spacingY, int width, int height, std::vector<int>& segmentsOut, std::vector<double>& distancesOut) const
+{
+	// Samples of the grid are the pixels of the tile
+	const int rows = height;
+	const int cols = width;
+	const Point2D& origin = topLeft;
+	const Point2D end(origin.x + cols * spacingX, origin.y + rows * spacingY);
+
+	// Rasterize the segments of all levels, labels are the indices of the edges in the network
+	std::vector<double> features(std::size_t(rows) * cols, DistanceTransformInfinity());
+	std::vector<std::pair<std::size_t, int> > coverage;
+	for (int level = 1; level <= m_resolution; level++)
+	{
+		const Cell minCell = GetCell(origin.x, origin.y, network.resolution(level));
+		const Cell maxCell = GetCell(end.x, end.y, network.resolution(level));
+
+		// Segments may end in neighboring cells
+		for (int cy = minCell.y - 2; cy <= maxCell.y + 2; cy++)
+		{
+			for (int cx = minCell.x - 2; cx <= maxCell.x + 2; cx++)
+			{
+				assert(network.containsCell(level, cx, cy));
+
+				const int firstEdge = network.firstEdge(level, cx, cy);
+				for (int k = 0; k < network.segmentsPerCell(level); k++)
+				{
+					RasterizeSegment(ProjectionZ(network.segment(firstEdge + k)), firstEdge + k, origin, spacingX, spacingY, rows, cols, features, coverage);
+				}
+			}
+		}
+	}
+
+	// Segments covering each sample: coverage is sorted by sample, samples covered by no segment have an empty range
+	std::sort(coverage.begin(), coverage.end());
+	coverage.erase(std::unique(coverage.begin(), coverage.end()), coverage.end());
+	std::vector<std::size_t> firstCoverage(std::size_t(rows) * cols + 1, 0);
+	for (const std::pair<std::size_t, int>& cover : coverage)
+	{
+		firstCoverage[cover.first + 1]++;
+	}
+	for (std::size_t sample = 0; sample + 1 < firstCoverage.size(); sample++)
+	{
+		firstCoverage[sample + 1] += firstCoverage[sample];
+	}
+
+	// Nearest feature of every sample, labelled with its index
+	std::vector<int> nearest;
+	SquaredDistanceTransform(features, rows, cols, nearest, spacingY, spacingX);
+
+	// The nearest feature of a sample is not always covered by its nearest segment, a segment shorter than a pixel may even be the nearest of no feature.
+	// Each sample keeps as candidates the segments at most a tolerance farther than its nearest one, and re-checks the candidates of its neighbors
+	// against its true distance until no sample changes. The path from a sample to the nearest point of its nearest segment is in the Voronoi region
+	// of this segment, so along the path, starting from a sample covered by the segment, every sample keeps it as a candidate and the distances are exact.
+	// Segments outside of the grid cover no sample: the samples on the border of the grid check the segments of the neighboring cells of every level,
+	// where the path to such a segment leaves the grid.
+	// Samples covered by a segment are at most 0.75 diagonal away from it, and samples along a path are at most half a diagonal away from it.
+	const double diagonal = std::sqrt(spacingX * spacingX + spacingY * spacingY);
+	const double tolerance = 1.25 * diagonal;
+
+	// Candidates of each sample, the first one is its nearest segment. Only junctions of several segments have more than one or two candidates.
+	// The distances of the other candidates are only needed when a nearer segment is found or when there is no room left, they are computed again.
+	const int maxCandidates = 4;
+	std::vector<int> candidates(std::size_t(rows) * cols * maxCandidates, -1);
+	std::vector<double> nearestDistances(std::size_t(rows) * cols, std::numeric_limits<double>::max());
+
+	// Last sweep in which the candidates of each sample changed, 0 for the initialization
+	std::vector<int> changedSweep(std::size_t(rows) * cols, 0);
+
+	// Add a segment to the candidates of a sample, return true if the candidates changed
+	const auto recheck = [&](int i, int j, int segment)
+	{
+		const std::size_t sample = std::size_t(i) * cols + j;
+		int* sampleCandidates = &candidates[sample * maxCandidates];
+
+		int count = 0;
+		while (count < maxCandidates && sampleCandidates[count] >= 0)
+		{
+			if (sampleCandidates[count] == segment)
+			{
+				return false;
+			}
+			count++;
+		}
+
+		const Point2D point(origin.x + j * spacingX, origin.y + i * spacingY);
+		const auto distance = [&](int candidate)
+		{
+			Point2D c;
+			return distToLineSegment(point, ProjectionZ(network.segment(candidate)), c);
+		};
+
+		const double dist = distance(segment);
+		if (count > 0 && dist > nearestDistances[sample] + tolerance)
+		{
+			return false;
+		}
+
+		if (dist < nearestDistances[sample])
+		{
+			// The new nearest segment may leave other candidates out of the tolerance, the farthest ones are dropped if there is no room left
+			int kept[maxCandidates];
+			kept[0] = segment;
+			int keptCount = 1;
+			for (int k = 0; k < count && keptCount < maxCandidates; k++)
+			{
+				const double candidateDistance = k == 0 ? nearestDistances[sample] : distance(sampleCandidates[k]);
+				if (candidateDistance <= dist + tolerance)
+				{
+					kept[keptCount++] = sampleCandidates[k];
+				}
+			}
+			std::copy_n(kept, keptCount, sampleCandidates);
+			std::fill(sampleCandidates + keptCount, sampleCandidates + maxCandidates, -1);
+			nearestDistances[sample] = dist;
+
+			return true;
+		}
+
+		if (count < maxCandidates)
+		{
+			sampleCandidates[count] = segment;
+
+			return true;
+		}
+
+		// Replace the farthest candidate which is not the nearest one
+		int farthest = 1;
+		double farthestDistance = distance(sampleCandidates[1]);
+		for (int k = 2; k < count; k++)
+		{
+			const double candidateDistance = distance(sampleCandidates[k]);
+			if (candidateDistance > farthestDistance)
+			{
+				farthest = k;
+				farthestDistance = candidateDistance;
+			}
+		}
+
+		if (dist >= farthestDistance)
+		{
+			return false;
+		}
+
+		sampleCandidates[farthest] = segment;
+
+		return true;
+	};
+
+	// Re-check the candidates of a neighbor in a sweep, unless they did not change since the previous sweep in the same direction,
+	// or they are the same as the ones of the sample. Candidates rejected once by a sample are always rejected, its nearest segment only gets nearer.
+	const auto recheckNeighbor = [&](int i, int j, std::size_t neighbor, int round, int sweep)
+	{
+		if (round > 0 && changedSweep[neighbor] <= sweep - 4)
+		{
+			return false;
+		}
+
+		const std::size_t sample = std::size_t(i) * cols + j;
+		const int* neighborCandidates = &candidates[neighbor * maxCandidates];
+		if (std::equal(neighborCandidates, neighborCandidates + maxCandidates, &candidates[sample * maxCandidates]))
+		{
+			return false;
+		}
+
+		bool changed = false;
+		for (int k = 0; k < maxCandidates && neighborCandidates[k] >= 0; k++)
+		{
+			changed |= recheck(i, j, neighborCandidates[k]);
+		}
+
+		if (changed)
+		{
+			changedSweep[sample] = sweep;
+		}
+
+		return changed;
+	};
+
+	// Candidates start with the segments covering the sample and its nearest feature
+	Executor::global().parallelFor(0, rows, [&](int i)
+	{
+		for (int j = 0; j < cols; j++)
+		{
+			const std::size_t sample = std::size_t(i) * cols + j;
+
+			if (i == 0 || i == rows - 1 || j == 0 || j == cols - 1)
+			{
+				for (int level = 1; level <= m_resolution; level++)
+				{
+					const Cell cell = GetCell(origin.x + j * spacingX, origin.y + i * spacingY, network.resolution(level));
+					for (int cy = cell.y - 2; cy <= cell.y + 2; cy++)
+					{
+						for (int cx = cell.x - 2; cx <= cell.x + 2; cx++)
+						{
+							assert(network.containsCell(level, cx, cy));
+
+							const int firstEdge = network.firstEdge(level, cx, cy);
+							for (int k = 0; k < network.segmentsPerCell(level); k++)
+							{
+								recheck(i, j, firstEdge + k);
+							}
+						}
+					}
+				}
+			}
+
+			if (nearest[sample] < 0)
+			{
+				continue;
+			}
+
+			for (std::size_t k = firstCoverage[nearest[sample]]; k < firstCoverage[nearest[sample] + 1]; k++)
+			{
+				recheck(i, j, coverage[k].second);
+			}
+			for (std::size_t k = firstCoverage[sample]; k < firstCoverage[sample + 1]; k++)
+			{
+				recheck(i, j, coverage[k].second);
+			}
+		}
+	});
+
+	// Strips of columns are swept from top to bottom and from bottom to top, each sample re-checking the samples of the previous row in its strip,
+	// then rows are swept from left to right and from right to left, which also carries the candidates between strips.
+	// Strips and rows are independent, and the sweeps repeat until no sample changes, usually a few times.
+	const int stripCols = 64;
+	const int strips = (cols + stripCols - 1) / stripCols;
+	std::atomic<bool> changed(true);
+	for (int round = 0; changed; round++)
+	{
+		changed = false;
+
+		for (int direction = 0; direction < 2; direction++)
+		{
+			const int sweep = 4 * round + direction + 1;
+
+			Executor::global().parallelFor(0, strips, [&](int strip)
+			{
+				const int firstCol = strip * stripCols;
+				const int lastCol = std::min(firstCol + stripCols, cols) - 1;
+
+				bool stripChanged = false;
+				for (int n = 1; n < rows; n++)
+				{
+					const int i = (direction == 0) ? n : rows - 1 - n;
+					const int previousRow = (direction == 0) ? i - 1 : i + 1;
+
+					for (int j = firstCol; j <= lastCol; j++)
+					{
+						for (int o = std::max(j - 1, firstCol); o <= std::min(j + 1, lastCol); o++)
+						{
+							stripChanged |= recheckNeighbor(i, j, std::size_t(previousRow) * cols + o, round, sweep);
+						}
+					}
+				}
+
+				if (stripChanged)
+				{
+					changed = true;
+				}
+			});
+		}
+
+		Executor::global().parallelFor(0, rows, [&](int i)
+		{
+			bool rowChanged = false;
+			for (int j = 1; j < cols; j++)
+			{
+				rowChanged |= recheckNeighbor(i, j, std::size_t(i) * cols + j - 1, round, 4 * round + 3);
+			}
+			for (int j = cols - 2; j >= 0; j--)
+			{
+				rowChanged |= recheckNeighbor(i, j, std::size_t(i) * cols + j + 1, round, 4 * round + 4);
+			}
+
+			if (rowChanged)
+			{
+				changed = true;
+			}
+		});
+	}
+
+	segmentsOut.resize(std::size_t(rows) * cols);
+	distancesOut = std::move(nearestDistances);
+	for (std::size_t sample = 0; sample < segmentsOut.size(); sample++)
+	{
+		segmentsOut[sample] = candidates[sample * maxCandidates];
+	}
+}
+
+/// <summary>
+/// Terrain for every pixel of a tile, like evaluateTerrain, using a network baked by bakeTerrainNetwork.
+/// Primitives are scattered in the tile once each instead of being gathered by every pixel.
+/// </summary>
+/// <param name="network">A network covering the tile</param>
+/// <param name="topLeft">Coordinates of the pixel (0, 0)</param>
+/// <param name="bottomRight">Coordinates of the pixel (height, width), right after the last pixel of the tile</param>
+/// <param name="width">Number of columns of the tile</param>
+/// <param name="height">Number of rows of the tile</param>
+/// <returns>Values of the pixels, row by row</returns>
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::evaluateTerrainTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const
+{
+	std::vector<std::vector<double> > tile = ColorTile(network, topLeft, bottomRight, width, height);
+
+	if (m_displayFunction)
+	{
+		const std::vector<std::vector<double> > elevations = PrimitivesTile(network, topLeft, bottomRight, width, height);
+
+		for (int i = 0; i < height; i++)
+		{
+			for (int j = 0; j < width; j++)
+			{
+				tile[i][j] = std::max(tile[i][j], elevations[i][j]);
+			}
+		}
+	}
+
+	return tile;
+}
+
+/// <summary>
+/// Lichtenberg figure for every pixel of a tile, like evaluateLichtenberg, using a network baked by bakeLichtenbergNetwork.
+/// The cost is proportional to the number of segments instead of the number of pixels.
+/// </summary>
+/// <param name="network">A network covering the tile</param>
+/// <param name="topLeft">Coordinates of the pixel (0, 0)</param>
+/// <param name="bottomRight">Coordinates of the pixel (height, width), right after the last pixel of the tile</param>
+/// <param name="width">Number of columns of the tile</param>
+/// <param name="height">Number of rows of the tile</param>
+/// <returns>Values of the pixels, row by row</returns>
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::evaluateLichtenbergTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const
+{
+	return ColorTile(network, topLeft, bottomRight, width, height);
+}
+
+/// <summary>
+/// Points, segments, grid and distance displayed in a tile.
+/// Points and segments are splatted in the tile as discs and capsules of the radius of their level, with max blending.
+/// </summary>
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::ColorTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const
+{
+	assert(width > 0 && height > 0);
+	assert(m_resolution >= 1 && m_resolution <= network.levels());
+
+	std::vector<std::vector<double> > tile(height, std::vector<double>(width, 0.0));
+
+	if (m_displayPoints || m_displaySegments)
+	{
+		for (int level = 1; level <= m_resolution; level++)
+		{
+			const int resolution = network.resolution(level);
+			const double radius = 1.0 / (26 * std::exp(0.085 * resolution));
+
+			// Points and segments drawn in a pixel are generated at most 2 cells away from the cell of the pixel
+			const Cell minCell = GetCell(std::min(topLeft.x, bottomRight.x), std::min(topLeft.y, bottomRight.y), resolution);
+			const Cell maxCell = GetCell(std::max(topLeft.x, bottomRight.x), std::max(topLeft.y, bottomRight.y), resolution);
+
+			for (int cy = minCell.y - 2; cy <= maxCell.y + 2; cy++)
+			{
+				for (int cx = minCell.x - 2; cx <= maxCell.x + 2; cx++)
+				{
+					assert(network.containsCell(level, cx, cy));
+
+					if (m_displayPoints)
+					{
+						const Point2D point = network.point(level, cx, cy);
+						SplatCapsule(Segment2D(point, point), radius, topLeft, bottomRight, tile);
+					}
+
+					const int firstEdge = network.firstEdge(level, cx, cy);
+					for (int k = 0; k < network.segmentsPerCell(level); k++)
+					{
+						const Segment2D segment = ProjectionZ(network.segment(firstEdge + k));
+
+						if (m_displayPoints)
+						{
+							SplatCapsule(Segment2D(segment.a, segment.a), radius / 2.0, topLeft, bottomRight, tile);
+							SplatCapsule(Segment2D(segment.b, segment.b), radius / 2.0, topLeft, bottomRight, tile);
+						}
+
+						// Segments with a length of zero are not displayed
+						if (m_displaySegments && length_sq(segment) > 0.0)
+						{
+							SplatCapsule(segment, radius / 4.0, topLeft, bottomRight, tile);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (m_displayGrid)
+	{
+		Executor::global().parallelFor(0, height, [&](int i)
+		{
+			for (int j = 0; j < width; j++)
+			{
+				const double x = remap(double(j), 0.0, double(width), topLeft.x, bottomRight.x);
+				const double y = remap(double(i), 0.0, double(height), topLeft.y, bottomRight.y);
+
+				for (int level = 1; level <= m_resolution; level++)
+				{
+					const int resolution = network.resolution(level);
+					const double radius = 1.0 / (26 * std::exp(0.085 * resolution));
+
+					for (int k = 0; k <= resolution; k++)
+					{
+						const double grid = double(k) / resolution;
+						tile[i][j] = std::max(tile[i][j], ComputeColorGrid(x, y, grid, grid, radius / 8.0));
+					}
+				}
+			}
+		});
+	}
+
+	if (m_displayDistance)
+	{
+		const std::vector<std::vector<double> > distances = DistanceTile(network, topLeft, bottomRight, width, height, nullptr);
+
+		for (int i = 0; i < height; i++)
+		{
+			for (int j = 0; j < width; j++)
+			{
+				tile[i][j] = std::max(tile[i][j], distances[i][j]);
+			}
+		}
+	}
+
+	return tile;
+}
+
+/// <summary>
+/// Set to 1 the pixels of a tile nearer to a segment than a radius.
+/// Only the pixels in the bounding box of the capsule are tested.
+/// </summary>
+/// <param name="segment">Segment in the coordinates of the noise, a disc if both points are the same</param>
+/// <param name="radius">Radius of the capsule</param>
+/// <param name="topLeft">Coordinates of the pixel (0, 0)</param>
+/// <param name="bottomRight">Coordinates of the pixel (height, width)</param>
+/// <param name="tile">Values of the pixels, row by row</param>
+template <typename I>
+void Noise<I>::SplatCapsule(const Segment2D& segment, double radius, const Point2D& topLeft, const Point2D& bottomRight, std::vector<std::vector<double> >& tile) const
+{
+	const int height = int(tile.size());
+	const int width = int(tile.front().size());
+
+	// Bounding box of the capsule in pixels, one pixel larger to be conservative
+	const double minI = remap(std::min(segment.a.y, segment.b.y) - radius, topLeft.y, bottomRight.y, 0.0, double(height));
+	const double maxI = remap(std::max(segment.a.y, segment.b.y) + radius, topLeft.y, bottomRight.y, 0.0, double(height));
+	const double minJ = remap(std::min(segment.a.x, segment.b.x) - radius, topLeft.x, bottomRight.x, 0.0, double(width));
+	const double maxJ = remap(std::max(segment.a.x, segment.b.x) + radius, topLeft.x, bottomRight.x, 0.0, double(width));
+
+	const int iBegin = std::max(0, int(std::floor(std::min(minI, maxI))) - 1);
+	const int iEnd = std::min(height - 1, int(std::ceil(std::max(minI, maxI))) + 1);
+	const int jBegin = std::max(0, int(std::floor(std::min(minJ, maxJ))) - 1);
+	const int jEnd = std::min(width - 1, int(std::ceil(std::max(minJ, maxJ))) + 1);
+
+	for (int i = iBegin; i <= iEnd; i++)
+	{
+		for (int j = jBegin; j <= jEnd; j++)
+		{
+			// Same coordinates as a loop over the pixels of an image
+			const double x = remap(double(j), 0.0, double(width), topLeft.x, bottomRight.x);
+			const double y = remap(double(i), 0.0, double(height), topLeft.y, bottomRight.y);
+
+			if (length_sq(segment) > 0.0)
+			{
+				tile[i][j] = std::max(tile[i][j], ComputeColorSegment(x, y, segment, radius));
+			}
+			else
+			{
+				tile[i][j] = std::max(tile[i][j], ComputeColorPoint(x, y, segment.a, radius));
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Elevation of the primitives for every pixel of a tile, like ComputeColorPrimitives with a network.
+/// The center, elevation and noise amplitude of each primitive are computed once, then its weighted contributions are scattered
+/// in numerator and denominator buffers, which are divided at the end.
+/// Contributions are added in the same order as in ComputeColorPrimitives, so both give the same result.
+/// </summary>
+template <typename I>
+std::vector<std::vector<double> > Noise<I>::PrimitivesTile(const RiverNetwork& network, const Point2D& topLeft, const Point2D& bottomRight, int width, int height) const
+{
+	assert(width > 0 && height > 0);
+	assert(topLeft.x < bottomRight.x && topLeft.y < bottomRight.y);
+	assert(m_resolution >= 1 && m_resolution <= network.levels());
+
+	// Primitives of a pixel are in the neighboring cells of the pixel, like in the arrays of ComputeColorPrimitives
+	const int neighborhood = (m_resolution == 1) ? 4 : 2;
+
+	const int higherResolution = network.resolution(m_resolution);
+	const int highestResolution = higherResolution << m_primitivesResolutionSteps;
+
+	// Coordinates and cells of the columns and rows of pixels
+	std::vector<double> columnsX(width);
+	std::vector<int> columnCells(width);
+	for (int j = 0; j < width; j++)
+	{
+		columnsX[j] = remap(double(j), 0.0, double(width), topLeft.x, bottomRight.x);
+		columnCells[j] = GetCell(columnsX[j], topLeft.y, highestResolution).x;
+	}
+
+	std::vector<double> rowsY(height);
+	std::vector<int> rowCells(height);
+	for (int i = 0; i < height; i++)
+	{
+		rowsY[i] = remap(double(i), 0.0, double(height), topLeft.y, bottomRight.y);
+		rowCells[i] = GetCell(topLeft.x, rowsY[i], highestResolution).y;
+	}
+
+	// Cells of the primitives at each resolution step, from the highest resolution to the resolution of the network
+	std::vector<std::array<int, 4> > ranges(m_primitivesResolutionSteps + 1);
+	ranges.back() = { columnCells.front() - neighborhood, rowCells.front() - neighborhood, columnCells.back() + neighborhood, rowCells.back() + neighborhood };
+	for (int step = m_primitivesResolutionSteps; step > 0; step--)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			ranges[step - 1][k] = int(std::floor(ranges[step][k] / 2.0));
+		}
+	}
+
+	// Centers of the primitives: points of the network, refined by replacing the sub-points with the existing points
+	int rangeWidth = ranges.front()[2] - ranges.front()[0] + 1;
+	int rangeHeight = ranges.front()[3] - ranges.front()[1] + 1;
+	std::vector<Point2D> centers(std::size_t(rangeWidth) * rangeHeight);
+	for (int y = ranges.front()[1]; y <= ranges.front()[3]; y++)
+	{
+		for (int x = ranges.front()[0]; x <= ranges.front()[2]; x++)
+		{
+			assert(network.containsCell(m_resolution, x, y));
+
+			centers[std::size_t(y - ranges.front()[1]) * rangeWidth + (x - ranges.front()[0])] = network.point(m_resolution, x, y);
+		}
+	}
+
+	for (int step = 1; step <= m_primitivesResolutionSteps; step++)
+	{
+		const std::array<int, 4>& range = ranges[step];
+		const int resolution = higherResolution << step;
+		const int subWidth = range[2] - range[0] + 1;
+		const int subHeight = range[3] - range[1] + 1;
+
+		std::vector<Point2D> subCenters(std::size_t(subWidth) * subHeight);
+		for (int y = range[1]; y <= range[3]; y++)
+		{
+			for (int x = range[0]; x <= range[2]; x++)
+			{
+				subCenters[std::size_t(y - range[1]) * subWidth + (x - range[0])] = GenerateNeighboringPoint(x, y, resolution);
+			}
+		}
+
+		for (const Point2D& center : centers)
+		{
+			const Cell cell = GetCell(center.x, center.y, resolution);
+
+			if (cell.x >= range[0] && cell.x <= range[2] && cell.y >= range[1] && cell.y <= range[3])
+			{
+				subCenters[std::size_t(cell.y - range[1]) * subWidth + (cell.x - range[0])] = center;
+			}
+		}
+
+		centers = std::move(subCenters);
+		rangeWidth = subWidth;
+		rangeHeight = subHeight;
+	}
+
+	// Radius of primitives
+	const double R = 2.0 / highestResolution;
+	// Power to the Wyvill-Galin function
+	const double P = 3.0;
+
+	const double controlFunctionMinimum = ControlFunctionMinimum();
+	const double controlFunctionMaximum = ControlFunctionMaximum();
+	const double amplitudeMax = m_noiseAmplitudeProportion * (controlFunctionMaximum - controlFunctionMinimum) / higherResolution;
+	const double periodPerCell = 4.0;
+	const double terrainSizeX = m_noiseBottomRight.x - m_noiseTopLeft.x;
+	const double terrainSizeY = m_noiseBottomRight.y - m_noiseTopLeft.y;
+	const double higherResCellSize = std::max(terrainSizeX, terrainSizeY) / higherResolution;
+	const double highestResCellSizeX = terrainSizeX / highestResolution;
+	const double highestResCellSizeY = terrainSizeY / highestResolution;
+	const double wavelengthX = highestResCellSizeX / periodPerCell;
+	const double wavelengthY = highestResCellSizeY / periodPerCell;
+
+	// Elevation without noise and noise amplitude of each primitive
+	std::vector<double> primitiveElevations(centers.size());
+	std::vector<double> primitiveAmplitudes(centers.size());
+	Executor::global().parallelFor(0, int(centers.size()), [&](int c)
+	{
+		// Nearest segment to the center and nearest point on this segment
+		Cell primitiveNearestSegmentCell;
+		Segment3D primitiveNearestSegment;
+		const double distancePrimitiveCenter = NearestSegmentAndCellProjectionZ(1, centers[c], primitiveNearestSegmentCell, primitiveNearestSegment, network);
+		const double uPrimitive = pointLineSegmentProjection(centers[c], ProjectionZ(primitiveNearestSegment));
+		const double nearestPointOnSegmentHeight = lerp(primitiveNearestSegment.a.z, primitiveNearestSegment.b.z, uPrimitive);
+
+		// Adaptive slope depending on the mountain height
+		const double adaptiveSlope = smootherstep(controlFunctionMinimum, controlFunctionMaximum, pow(nearestPointOnSegmentHeight, m_slopePower));
+
+		primitiveElevations[c] = nearestPointOnSegmentHeight + adaptiveSlope * distancePrimitiveCenter;
+		primitiveAmplitudes[c] = amplitudeMax * smootherstep(0.0, higherResCellSize / 4.0, distancePrimitiveCenter);
+	});
+
+	// Numerator and denominator used to compute the blend of primitives
+	std::vector<std::vector<double> > numerator(height, std::vector<double>(width, 0.0));
+	std::vector<std::vector<double> > denominator(height, std::vector<double>(width, 0.0));
+
+	const int minX = ranges.back()[0];
+	const int minY = ranges.back()[1];
+
+	Executor::global().parallelFor(0, height, [&](int i)
+	{
+		// Noise of the pixels, the same for all primitives except for the amplitude
+		std::vector<std::array<double, 3> > noises(width);
+		for (int j = 0; j < width; j++)
+		{
+			const double x = columnsX[j];
+			const double y = rowsY[i];
+
+			noises[j] = { Perlin(x / wavelengthX, y / wavelengthY), Perlin(x / (2.0 * wavelengthX), y / (2.0 * wavelengthY)), Perlin(x / (4.0 * wavelengthX), y / (4.0 * wavelengthY)) };
+		}
+
+		// Rows of primitives reaching the row of pixels, then primitives from left to right
+		for (int cy = rowCells[i] - neighborhood; cy <= rowCells[i] + neighborhood; cy++)
+		{
+			for (int cx = minX; cx < minX + rangeWidth; cx++)
+			{
+				const std::size_t c = std::size_t(cy - minY) * rangeWidth + (cx - minX);
+
+				// Pixels whose cell is in the neighborhood of the primitive
+				const int jBegin = int(std::lower_bound(columnCells.begin(), columnCells.end(), cx - neighborhood) - columnCells.begin());
+				const int jEnd = int(std::upper_bound(columnCells.begin(), columnCells.end(), cx + neighborhood) - columnCells.begin());
+
+				for (int j = jBegin; j < jEnd; j++)
+				{
+					const double distancePrimitive = dist(Point2D(columnsX[j], rowsY[i]), centers[c]);
+					const double alphaPrimitive = WyvillGalinFunction(distancePrimitive, R, P);
+
+					const double amplitude = primitiveAmplitudes[c];
+					const double noise = amplitude * noises[j][0]
+									   + 0.5 * amplitude * noises[j][1]
+									   + 0.25 * amplitude * noises[j][2];
+
+					// Final elevation
+					const double elevation = primitiveElevations[c] + noise;
+
+					numerator[i][j] += alphaPrimitive * elevation;
+					denominator[i][j] += alphaPrimitive;
+				}
+			}
+		}
+	});
+
+	// Resolve the blend
+	std::vector<std::vector<double> > elevations(height, std::vector<double>(width));
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			// denominator shouldn't be equal to zero if there is enough primitives around the point.
+			assert(denominator[i][j] != 0.0);
+
+			elevations[i][j] = numerator[i][j] / denominator[i][j];
+		}
+	}
+
+	return elevations;
+}
+
+template <typename I>
+template <typename T, size_t N>
+std::tuple<int, int> Noise<I>::GetArrayCell(const Cell& arrCell, const Array2D<T, N>& arr, const Cell& cell) const
+{
+	const int i = (int(arr.size()) / 2) - arrCell.y + cell.y;
+	const int j = (int(arr.front().size()) / 2) - arrCell.x + cell.x;
+
+	return std::make_tuple(i, j);
+}
+
+template <typename I>
+template <size_t N, size_t D>
+double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const
+{
+	assert(neighborhood >= 0);
+
+	// Distance to the nearest segment
+	double nearestSegmentDistance = std::numeric_limits<double>::max();
+
+	int ci, cj;
+	std::tie(ci, cj) = GetArrayCell(cell, segments, GetCell(point.x, point.y, cell.resolution));
+	for (int i = ci - neighborhood; i <= ci + neighborhood; i++)
+	{
+		for (int j = cj - neighborhood; j <= cj + neighborhood; j++)
+		{
+			assert(i >= 0 && static_cast<unsigned int>(i) < segments.size());
+			assert(j >= 0 && static_cast<unsigned int>(j) < segments.front().size());
+
+			for (unsigned int k = 0; k < segments[i][j].size(); k++)
+			{
+				Point2D c;
+				const double dist = distToLineSegment(point, ProjectionZ(segments[i][j][k]), c);
+
+				if (dist < nearestSegmentDistance)
+				{
+					nearestSegmentDistance = dist;
+					nearestSegmentOut = segments[i][j][k];
+
+					nearestSegmentCellOut.x = i;
+					nearestSegmentCellOut.y = j;
+					nearestSegmentCellOut.resolution = cell.resolution;
+				}
+			}
+		}
+	}
+
+	return nearestSegmentDistance;
+}
+
+template <typename I>
+template <size_t N, size_t D, typename ...Tail>
+double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
+{
+	assert(neighborhood >= 0);
 
 	// Nearest segment in the sub resolutions
 	Cell nearestSubSegmentCell;
@@ -1169,61 +2545,35 @@ double Noise<I>::NearestSegmentProjectionZ(int neighborhood, const Point2D& poin
 	return NearestSegmentAndCellProjectionZ(neighborhood, point, placeholderCell, nearestSegmentOut, cell, segments, std::forward<Tail>(tail)...);
 }
 
+/// <summary>
+/// Generate the point of a cell in the coordinates of the noise.
+/// Points outside the domain are moved to the corner of their cell furthest from the domain.
+/// </summary>
+/// <param name="x">x coordinate of the cell</param>
+/// <param name="y">y coordinate of the cell</param>
+/// <param name="resolution">Resolution of the cell</param>
+/// <returns>The point of the cell</returns>
 template <typename I>
-template <size_t N>
-int Noise<I>::SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentEndingInP) const
+Point2D Noise<I>::GenerateNeighboringPoint(int x, int y, int resolution) const
 {
-	int numberSegmentEndingInP = 0;
+	const Point2D p = GeneratePointCached(x, y) / resolution;
 
-	// In which cell of segments is point
-	int ck, cl;
-	std::tie(ck, cl) = GetArrayCell(cell, segments, GetCell(point.x, point.y, cell.resolution));
-	for (int k = ck - 1; k <= ck + 1; k++)
+	// Bias the random generator to repulse the points outside the domain
+	if (InsideDomain(p))
 	{
-		for (int l = cl - 1; l <= cl + 1; l++)
-		{
-			assert(k >= 0 && static_cast<unsigned int>(k) < segments.size());
-			assert(l >= 0 && static_cast<unsigned int>(l) < segments.front().size());
-
-			// If the segment's length is more than 0
-			if (segments[k][l][0].a != segments[k][l][0].b)
-			{
-				if (segments[k][l][0].b == point)
-				{
-					numberSegmentEndingInP++;
-					lastSegmentEndingInP = segments[k][l][0];
-				}
-			}
-		}
+		return p;
 	}
 
-	return numberSegmentEndingInP;
-}
-
-template <typename I>
-template <size_t N>
-int Noise<I>::SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentStartingInP) const
-{
-	int numberStartingInP = 0;
-
-	// In which cell of segments is B
-	int m, n;
-	std::tie(m, n) = GetArrayCell(cell, segments, GetCell(point.x, point.y, cell.resolution));
-
-	assert(m >= 0 && static_cast<unsigned int>(m) < segments.size());
-	assert(n >= 0 && static_cast<unsigned int>(n) < segments.front().size());
+	// Furthest point in the cell (could be improved with topRight and bottom Left)
+	const Point2D topLeft(double(x) / resolution, double(y) / resolution);
+	const Point2D bottomRight(double(x + 1) / resolution, double(y + 1) / resolution);
 
-	// If the segment's length is more than 0
-	if (segments[m][n][0].a != segments[m][n][0].b)
+	if (DistToDomain(topLeft) < DistToDomain(bottomRight))
 	{
-		if (segments[m][n][0].a == point)
-		{
-			numberStartingInP++;
-			lastSegmentStartingInP = segments[m][n][0];
-		}
+		return bottomRight;
 	}
 
-	return numberStartingInP;
+	return topLeft;
 }
 
 template <typename I>
@@ -1240,28 +2590,7 @@ typename Noise<I>::template Point2DArray<N> Noise<I>::GenerateNeighboringPoints(
 			const int x = cell.x + j - int(points[i].size()) / 2;
 			const int y = cell.y + i - int(points.size()) / 2;
 
-			const Point2D p = GeneratePointCached(x, y) / cell.resolution;
-
-			// Bias the random generator to repulse the points outside the domain
-			if (InsideDomain(p))
-			{
-				points[i][j] = p;
-			}
-			else
-			{
-				// Furthest point in the cell (could be improved with topRight and bottom Left)
-				const Point2D topLeft(double(x) / cell.resolution, double(y) / cell.resolution);
-				const Point2D bottomRight(double(x + 1) / cell.resolution, double(y + 1) / cell.resolution);
-
-				if (DistToDomain(topLeft) < DistToDomain(bottomRight))
-				{
-					points[i][j] = bottomRight;
-				}
-				else
-				{
-					points[i][j] = topLeft;
-				}
-			}
+			points[i][j] = GenerateNeighboringPoint(x, y, cell.resolution);
 		}
 	}
 
@@ -1297,7 +2626,7 @@ void Noise<I>::ReplaceNeighboringPoints(const Cell& cell, const Point2DArray<M>&
 
 template <typename I>
 template <size_t N>
-typename Noise<I>::template DoubleArray<N> Noise<I>::ComputeElevations(const Point2DArray<N>& points) const
+typename Noise<I>::template DoubleArray<N> Noise<I>::ComputeElevations(const Cell& cell, const Point2DArray<N>& points) const
 {
 	DoubleArray<N> elevations;
 
@@ -1305,7 +2634,7 @@ typename Noise<I>::template DoubleArray<N> Noise<I>::ComputeElevations(const Poi
 	{
 		for (unsigned int j = 0; j < elevations[i].size(); j++)
 		{
-			elevations[i][j] = EvaluateControlFunction(points[i][j]);
+			elevations[i][j] = EvaluateControlFunction(points[i][j], cell.resolution);
 		}
 	}
 
@@ -1314,11 +2643,11 @@ typename Noise<I>::template DoubleArray<N> Noise<I>::ComputeElevations(const Poi
 
 template <typename I>
 template <size_t N>
-typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSegments(const Point2DArray<N>& points) const
+typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSegments(const Cell& cell, const Point2DArray<N>& points, FlowNodeArray<N - 2>& flow) const
 {
 	static_assert(N > 0, "Not enough points");
 
-	const DoubleArray<N> elevations = ComputeElevations<N>(points);
+	const DoubleArray<N> elevations = ComputeElevations<N>(cell, points);
 
 	Segment3DChainArray<N - 2, 1> segments;
 	for (unsigned int i = 1; i < points.size() - 1; i++)
@@ -1346,11 +2675,17 @@ typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSeg
 			const Point3D startingPoint(points[i][j].x, points[i][j].y, elevations[i][j]);
 			const Point3D endingPoint(points[lowestNeighborI][lowestNeighborJ].x, points[lowestNeighborI][lowestNeighborJ].y, lowestNeighborElevation);
 
+			FlowNode& node = flow[i - 1][j - 1];
+			node.downstreamI = lowestNeighborI - 1;
+			node.downstreamJ = lowestNeighborJ - 1;
+
 			// Check if the points are inside the domain
 			if (InsideDomain(startingPoint) && InsideDomain(endingPoint))
 			{
 				// Both points are in the domain, we keep the segment
 				segments[i - 1][j - 1][0] = Segment3D(startingPoint, endingPoint);
+				// A point which is its own lowest neighbor is a sink
+				node.flows = (lowestNeighborI != int(i) || lowestNeighborJ != int(j));
 			}
 			else
 			{
@@ -1361,6 +2696,25 @@ typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSeg
 		}
 	}
 
+	// Link each segment to the segments flowing in it
+	for (unsigned int i = 0; i < flow.size(); i++)
+	{
+		for (unsigned int j = 0; j < flow[i].size(); j++)
+		{
+			const FlowNode& node = flow[i][j];
+
+			if (node.flows
+			 && node.downstreamI >= 0 && static_cast<unsigned int>(node.downstreamI) < flow.size()
+			 && node.downstreamJ >= 0 && static_cast<unsigned int>(node.downstreamJ) < flow.front().size())
+			{
+				FlowNode& downstreamNode = flow[node.downstreamI][node.downstreamJ];
+				downstreamNode.upstreamCount++;
+				downstreamNode.lastUpstreamI = i;
+				downstreamNode.lastUpstreamJ = j;
+			}
+		}
+	}
+
 	return segments;
 }
 
@@ -1383,9 +2737,10 @@ void Noise<I>::SegmentChainFromPoints(const Point3D& start, const std::array<Poi
 /// Subdivide all segments in a Segment3DArray&lt;N&gt; in D smaller segments using an interpolation spline.
 /// </summary>
 /// Require a Segment3DArray&lt;N&gt; to generate a Segment3DChainArray&lt;N - 2, D&gt; because to subdivide a segment we need its predecessors and successors.
+/// Predecessors and successors are found in the flow graph recorded by GenerateSegments.
 template <typename I>
 template <size_t N, size_t D>
-void Noise<I>::SubdivideSegments(const Cell& cell, const Segment3DChainArray<N, 1>& segments, Segment3DChainArray<N - 2, D>& subdividedSegments) const
+void Noise<I>::SubdivideSegments(const Segment3DChainArray<N, 1>& segments, const FlowNodeArray<N>& flow, Segment3DChainArray<N - 2, D>& subdividedSegments) const
 {
 	// Ensure that segments are subdivided.
 	static_assert(N > 0, "Not enough segments");
@@ -1400,16 +2755,19 @@ void Noise<I>::SubdivideSegments(const Cell& cell, const Segment3DChainArray<N,
 
 			std::array<Point3D, D - 1> midPoints = SubdivideInPoints<D - 1>(currentSegment);
 
+			const FlowNode& node = flow[i][j];
+
 			// If the current segment's length is more than 0, we can subdivide and smooth it
-			if (currentSegment.a != currentSegment.b)
+			if (node.flows)
 			{
 				// Segments ending in A
-				Segment3D lastEndingInA;
-				const int numberSegmentEndingInA = SegmentsEndingInP(cell, segments, currentSegment.a, lastEndingInA);
+				const int numberSegmentEndingInA = node.upstreamCount;
+				const Segment3D lastEndingInA = (numberSegmentEndingInA > 0) ? segments[node.lastUpstreamI][node.lastUpstreamJ][0] : Segment3D();
 
-				// Segments starting in B
-				Segment3D lastStartingInB;
-				const int numberStartingInB = SegmentsStartingInP(cell, segments, currentSegment.b, lastStartingInB);
+				// Segments starting in B: the segment of the downstream cell, if it has a length
+				const FlowNode& downstreamNode = flow[node.downstreamI][node.downstreamJ];
+				const int numberStartingInB = downstreamNode.flows ? 1 : 0;
+				const Segment3D lastStartingInB = segments[node.downstreamI][node.downstreamJ][0];
 
 				if (numberSegmentEndingInA == 1 && numberStartingInB == 1)
 				{
@@ -1485,7 +2843,7 @@ void Noise<I>::CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, cons
 
 template <typename I>
 template <size_t N, size_t D, typename ...Tail>
-typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegments(const ConnectionStrategy& connectionStrategy, double minSlope, const Point2DArray<N>& points, Tail&&... tail) const
+typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegments(const ConnectionStrategy& connectionStrategy, double minSlope, const Cell& cell, const Point2DArray<N>& points, Tail&&... tail) const
 {
 	// Ensure that there is enough segments around to connect sub points
 	CheckEnoughSegmentInVicinity(points, std::forward<Tail>(tail)...);
@@ -1496,42 +2854,48 @@ typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegm
 	{
 		for (unsigned int j = 0; j < points[i].size(); j++)
 		{
-			// The current point
-			const Point2D point = points[i][j];
+			subSegments[i][j] = ConnectSubPoint<D>(connectionStrategy, minSlope, cell, points[i][j], tail...);
+		}
+	}
 
-			// Find the nearest segment
-			Segment3D nearestSegment;
-			double nearestSegmentDist = NearestSegmentProjectionZ(1, point, nearestSegment, std::forward<Tail>(tail)...);
+	return subSegments;
+}
 
-			const double u = pointLineSegmentProjection(point, ProjectionZ(nearestSegment));
-			const Point3D nearestPointOnSegment = lerp(nearestSegment, u);
+/// <summary>
+/// Connect a point to the nearest segment of the coarser levels.
+/// </summary>
+/// <param name="tail">Coarser levels, either cells and arrays of segments, or a network and its number of levels to search</param>
+template <typename I>
+template <size_t D, typename ...Tail>
+typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectSubPoint(const ConnectionStrategy& connectionStrategy, double minSlope, const Cell& cell, const Point2D& point, Tail&&... tail) const
+{
+	// Find the nearest segment
+	Segment3D nearestSegment;
+	double nearestSegmentDist = NearestSegmentProjectionZ(1, point, nearestSegment, std::forward<Tail>(tail)...);
 
-			// Compute elevation of the point on the control function
-			const double elevationControlFunction = EvaluateControlFunction(point);
-			// Compute elevation with a constraint on slope
-			// Warning, the actual slope may change if the connection point is changed in ConnectPointToSegment
-			const double elevationWithMinSlope = nearestPointOnSegment.z + minSlope * nearestSegmentDist;
+	const double u = pointLineSegmentProjection(point, ProjectionZ(nearestSegment));
+	const Point3D nearestPointOnSegment = lerp(nearestSegment, u);
 
-			const double elevation = std::max(elevationWithMinSlope, elevationControlFunction);
+	// Compute elevation of the point on the control function
+	const double elevationControlFunction = EvaluateControlFunction(point, cell.resolution);
+	// Compute elevation with a constraint on slope
+	// Warning, the actual slope may change if the connection point is changed in ConnectPointToSegment
+	const double elevationWithMinSlope = nearestPointOnSegment.z + minSlope * nearestSegmentDist;
 
-			const Point3D p(point.x, point.y, elevation);
+	const double elevation = std::max(elevationWithMinSlope, elevationControlFunction);
 
-			const Segment3DChain<D> segmentChain = ConnectPointToSegment<D>(connectionStrategy, p, nearestSegmentDist, nearestSegment);
+	const Point3D p(point.x, point.y, elevation);
 
-			if (length_sq(nearestSegment) > 0.0 && InsideDomain(segmentChain.front().a) && InsideDomain(segmentChain.back().b))
-			{
-				subSegments[i][j] = segmentChain;
-			}
-			else
-			{
-				// Warning, in some cases, even if length_sq(nearestSegment) == 0.0, we would want to connect the point to the segment
-				// It happens we a point is generated exactly on a segment. The segment starting from this point has a null length.
-				subSegments[i][j] = SubdivideInSegments<D>(Segment3D(p, p));
-			}
-		}
+	const Segment3DChain<D> segmentChain = ConnectPointToSegment<D>(connectionStrategy, p, nearestSegmentDist, nearestSegment);
+
+	if (length_sq(nearestSegment) > 0.0 && InsideDomain(segmentChain.front().a) && InsideDomain(segmentChain.back().b))
+	{
+		return segmentChain;
 	}
 
-	return subSegments;
+	// Warning, in some cases, even if length_sq(nearestSegment) == 0.0, we would want to connect the point to the segment
+	// It happens we a point is generated exactly on a segment. The segment starting from this point has a null length.
+	return SubdivideInSegments<D>(Segment3D(p, p));
 }
 
 template <typename I>
@@ -1647,9 +3011,85 @@ double Noise<I>::ComputeColor(double x, double y, const Cell& cell, const Segmen
 	return std::max(valueCurrentLevel, valueTail);
 }
 
+template <typename I>
+double Noise<I>::ComputeColor(double x, double y, const RiverNetwork& network) const
+{
+	double value = 0.0;
+
+	for (int level = 1; level <= m_resolution; level++)
+	{
+		const Cell cell = GetCell(x, y, network.resolution(level));
+
+		const double radius = 1.0 / (26 * std::exp(0.085 * cell.resolution));
+
+		if (m_displayPoints)
+		{
+			// Points of the neighboring cells
+			for (int i = cell.y - 1; i <= cell.y + 1; i++)
+			{
+				for (int j = cell.x - 1; j <= cell.x + 1; j++)
+				{
+					value = std::max(value, ComputeColorPoint(x, y, network.point(level, j, i), radius));
+				}
+			}
+
+			// Points of the segments generated around the cell
+			for (int i = cell.y - 2; i <= cell.y + 2; i++)
+			{
+				for (int j = cell.x - 2; j <= cell.x + 2; j++)
+				{
+					const int firstEdge = network.firstEdge(level, j, i);
+					for (int k = 0; k < network.segmentsPerCell(level); k++)
+					{
+						const Segment3D segment = network.segment(firstEdge + k);
+						value = std::max(value, ComputeColorPoint(x, y, ProjectionZ(segment.a), radius / 2.0));
+						value = std::max(value, ComputeColorPoint(x, y, ProjectionZ(segment.b), radius / 2.0));
+					}
+				}
+			}
+		}
+
+		if (m_displaySegments)
+		{
+			Cell nearestSegmentCell;
+			Segment3D nearestSegment;
+			const double nearestSegmentDistance = NearestSegmentInLevel(2, Point2D(x, y), level, network, nearestSegmentCell, nearestSegment);
+
+			// If the segment has a length greater than zero
+			if (length_sq(nearestSegment) > 0.0)
+			{
+				value = std::max(value, ComputeColorBase(nearestSegmentDistance, radius / 4.0));
+			}
+		}
+
+		if (m_displayGrid)
+		{
+			for (int i = 0; i <= cell.resolution; i++)
+			{
+				const double grid = double(i) / cell.resolution;
+				value = std::max(value, ComputeColorGrid(x, y, grid, grid, radius / 8.0));
+			}
+		}
+	}
+
+	return value;
+}
+
 template <typename I>
 template <size_t N, typename ...Tail>
 double Noise<I>::ComputeColorPrimitives(double x, double y, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const
+{
+	return ComputeColorPrimitives(x, y, nullptr, higherResCell, higherResPoints, std::forward<Tail>(tail)...);
+}
+
+/// <summary>
+/// Blend of the primitives at a point, and optionally its analytic gradient.
+/// Centers of the primitives only depend on the cell of the point, so the gradient comes from
+/// the Wyvill-Galin weights and the Perlin noise, which are differentiated analytically.
+/// </summary>
+template <typename I>
+template <size_t N, typename ...Tail>
+double Noise<I>::ComputeColorPrimitives(double x, double y, Vec2D* gradientOut, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const
 {
 	const Point2D point(x, y);
 
@@ -1675,6 +3115,10 @@ double Noise<I>::ComputeColorPrimitives(double x, double y, const Cell& higherRe
 	double numerator = 0.0;
 	double denominator = 0.0;
 
+	// Gradients of the numerator and of the denominator
+	Vec2D numeratorGradient;
+	Vec2D denominatorGradient;
+
 	for (unsigned int i = 0; i < highestResPoints.size(); i++)
 	{
 		for (unsigned int j = 0; j < highestResPoints[i].size(); j++)
@@ -1706,22 +3150,124 @@ double Noise<I>::ComputeColorPrimitives(double x, double y, const Cell& higherRe
 			const double amplitude = amplitudeMax * smootherstep(0.0, higherResCellSize / 4.0, distancePrimitiveCenter);
 			const double wavelengthX = highestResCellSizeX / periodPerCell;
 			const double wavelengthY = highestResCellSizeY / periodPerCell;
-			const double noise = amplitude * Perlin(x / wavelengthX, y / wavelengthY)
-							   + 0.5 * amplitude * Perlin(x / (2.0 * wavelengthX), y / (2.0 * wavelengthY))
-							   + 0.25 * amplitude * Perlin(x / (4.0 * wavelengthX), y / (4.0 * wavelengthY));
 
-			// Final elevation
-			const double elevation = nearestPointOnSegmentHeight + adaptiveSlope * distancePrimitiveCenter + noise;
+			if (gradientOut == nullptr)
+			{
+				const double noise = amplitude * Perlin(x / wavelengthX, y / wavelengthY)
+								   + 0.5 * amplitude * Perlin(x / (2.0 * wavelengthX), y / (2.0 * wavelengthY))
+								   + 0.25 * amplitude * Perlin(x / (4.0 * wavelengthX), y / (4.0 * wavelengthY));
+
+				// Final elevation
+				const double elevation = nearestPointOnSegmentHeight + adaptiveSlope * distancePrimitiveCenter + noise;
+
+				numerator += alphaPrimitive * elevation;
+				denominator += alphaPrimitive;
+			}
+			else
+			{
+				std::array<Vec2D, 3> noiseGradients;
+				const double noise = amplitude * Perlin(x / wavelengthX, y / wavelengthY, noiseGradients[0].x, noiseGradients[0].y)
+								   + 0.5 * amplitude * Perlin(x / (2.0 * wavelengthX), y / (2.0 * wavelengthY), noiseGradients[1].x, noiseGradients[1].y)
+								   + 0.25 * amplitude * Perlin(x / (4.0 * wavelengthX), y / (4.0 * wavelengthY), noiseGradients[2].x, noiseGradients[2].y);
+
+				// Final elevation
+				const double elevation = nearestPointOnSegmentHeight + adaptiveSlope * distancePrimitiveCenter + noise;
+
+				numerator += alphaPrimitive * elevation;
+				denominator += alphaPrimitive;
+
+				// Only the noise depends on the point, octaves are scaled by their wavelength
+				const Vec2D elevationGradient(amplitude * (noiseGradients[0].x / wavelengthX + 0.25 * noiseGradients[1].x / wavelengthX + 0.0625 * noiseGradients[2].x / wavelengthX),
+											  amplitude * (noiseGradients[0].y / wavelengthY + 0.25 * noiseGradients[1].y / wavelengthY + 0.0625 * noiseGradients[2].y / wavelengthY));
 
-			numerator += alphaPrimitive * elevation;
-			denominator += alphaPrimitive;
+				// The weight depends on the distance to the center
+				Vec2D alphaGradient;
+				if (distancePrimitive > 0.0)
+				{
+					alphaGradient = Vec2D(highestResPoints[i][j], point) * (WyvillGalinFunctionDerivative(distancePrimitive, R, P) / distancePrimitive);
+				}
+
+				numeratorGradient += alphaGradient * elevation + elevationGradient * alphaPrimitive;
+				denominatorGradient += alphaGradient;
+			}
 		}
 	}
 
 	// denominator shouldn't be equal to zero if there is enough primitives around the point.
 	assert(denominator != 0.0);
 
-	return numerator / denominator;
+	const double value = numerator / denominator;
+
+	if (gradientOut != nullptr)
+	{
+		// Quotient rule
+		*gradientOut = (numeratorGradient - denominatorGradient * value) / denominator;
+	}
+
+	return value;
+}
+
+template <typename I>
+double Noise<I>::ComputeColorPrimitives(double x, double y, const RiverNetwork& network) const
+{
+	// Points of the highest level, which are replaced by the points of the network
+	const Cell cell = GetCell(x, y, network.resolution(m_resolution));
+
+	if (m_resolution == 1)
+	{
+		return ComputeColorPrimitives(x, y, cell, NetworkNeighboringPoints<9>(network, m_resolution, cell), network);
+	}
+
+	return ComputeColorPrimitives(x, y, cell, NetworkNeighboringPoints<5>(network, m_resolution, cell), network);
+}
+
+/// <summary>
+/// Compute the channels of a point from the arrays of a hierarchy.
+/// The nearest segment is searched for once for the distance, level, direction and flow channels.
+/// </summary>
+template <typename I>
+template <size_t N, typename ...Tail>
+typename Noise<I>::Channels Noise<I>::ComputeChannels(double x, double y, unsigned int channels, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const
+{
+	Channels values;
+
+	if (channels & (ChannelGradient | ChannelNormal))
+	{
+		values.elevation = ComputeColorPrimitives(x, y, &values.gradient, higherResCell, higherResPoints, tail...);
+
+		if (channels & ChannelNormal)
+		{
+			values.normal = normalized(Vec3D(-values.gradient.x, -values.gradient.y, 1.0));
+		}
+	}
+	else if (channels & ChannelElevation)
+	{
+		values.elevation = ComputeColorPrimitives(x, y, higherResCell, higherResPoints, tail...);
+	}
+
+	if (channels & (ChannelDistance | ChannelLevel | ChannelDirection | ChannelFlowTo))
+	{
+		Cell nearestSegmentCell;
+		Segment3D nearestSegment;
+		values.distance = NearestSegmentAndCellProjectionZ(1, Point2D(x, y), nearestSegmentCell, nearestSegment, tail...);
+
+		// Resolution of level n is 2^(n-1)
+		values.level = 1;
+		while ((1 << (values.level - 1)) < nearestSegmentCell.resolution)
+		{
+			values.level++;
+		}
+
+		if (length_sq(ProjectionZ(nearestSegment)) > 0.0)
+		{
+			values.direction = normalized(Vec2D(ProjectionZ(nearestSegment.a), ProjectionZ(nearestSegment.b)));
+		}
+
+		// Segments go from a point to its downstream point
+		values.flowTo = ProjectionZ(nearestSegment.b);
+	}
+
+	return values;
 }
 
 template <typename I>
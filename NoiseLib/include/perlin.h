@@ -3,4 +3,7 @@
 
 double Perlin(double x, double y);
 
+// Perlin noise and its partial derivatives
+double Perlin(double x, double y, double& dx, double& dy);
+
 #endif // PERLIN_H
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef POINTCACHE_H
+#define POINTCACHE_H
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "math2d.h"
+
+/// <summary>
+/// Cache of the points generated in the cells around the origin.
+/// Points only depend on the seed and on eps, so a cache is shared by all noises with the same parameters.
+/// The cache is divided in blocks of cells, a block is generated the first time one of its points is used.
+/// Reading points concurrently is safe.
+/// </summary>
+class PointCache
+{
+public:
+	typedef std::mt19937_64 RandomGenerator;
+
+	PointCache(int seed, double eps);
+
+	PointCache(const PointCache&) = delete;
+	PointCache& operator=(const PointCache&) = delete;
+
+	/// <summary>
+	/// Cache shared by the whole process for a seed and eps.
+	/// The cache lives as long as one of the noises using it.
+	/// </summary>
+	static std::shared_ptr<const PointCache> shared(int seed, double eps);
+
+	/// <summary>
+	/// Random generator of a cell, with a fixed seed for internal consistency
+	/// </summary>
+	static RandomGenerator randomGenerator(int seed, int i, int j);
+
+	/// <summary>
+	/// Generate a point in a cell.
+	/// This function is reproducible.
+	/// </summary>
+	/// <param name="seed">Seed of the noise</param>
+	/// <param name="eps">Epsilon used to bias the area where points are generated in cells</param>
+	/// <param name="x">x coordinate of the cell</param>
+	/// <param name="y">y coordinate of the cell</param>
+	/// <returns>A Point2D in this cell</returns>
+	static Point2D generatePoint(int seed, double eps, int x, int y);
+
+	bool contains(int x, int y) const
+	{
+		return x >= -CACHE_X / 2 && x < CACHE_X / 2 && y >= -CACHE_Y / 2 && y < CACHE_Y / 2;
+	}
+
+	/// <summary>
+	/// Point of a cell in the cache, generate the block of the cell if needed
+	/// </summary>
+	Point2D point(int x, int y) const
+	{
+		assert(contains(x, y));
+
+		const int i = x + CACHE_X / 2;
+		const int j = y + CACHE_Y / 2;
+		const int block = (i / BLOCK_SIZE) * BLOCKS_Y + j / BLOCK_SIZE;
+
+		if (!m_blockReady[block].load(std::memory_order_acquire))
+		{
+			GenerateBlock(block);
+		}
+
+		return m_points[i * CACHE_Y + j];
+	}
+
+private:
+	void GenerateBlock(int block) const;
+
+	static const int CACHE_X = 128;
+	static const int CACHE_Y = 128;
+	static const int BLOCK_SIZE = 16;
+	static const int BLOCKS_X = CACHE_X / BLOCK_SIZE;
+	static const int BLOCKS_Y = CACHE_Y / BLOCK_SIZE;
+
+	const int m_seed;
+	const double m_eps;
+
+	// Points are generated by the first thread using them, other threads wait on the mutex
+	mutable std::mutex m_mutex;
+	mutable std::array<std::atomic<bool>, BLOCKS_X * BLOCKS_Y> m_blockReady;
+	mutable std::vector<Point2D> m_points;
+};
+
+#endif // POINTCACHE_H
@@ -0,0 +1,182 @@
+#ifndef RAWHEIGHTMAPCONTROLFUNCTION_H
+#define RAWHEIGHTMAPCONTROLFUNCTION_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "controlfunction.h"
+#include "math2d.h"
+#include "memorymappedfile.h"
+#include "utils.h"
+
+/// <summary>
+/// Header of a raw heightmap file.
+/// The header is followed by the metadata, a text describing how the heightmap was generated,
+/// and by the samples, either row by row or tile by tile.
+/// In tiled files, tiles are stored row by row and each tile is stored row by row.
+/// Tiles on the right and bottom borders are padded to the full tile size.
+/// </summary>
+struct RawHeightmapHeader
+{
+	enum Format : uint32_t
+	{
+		Uint16 = 0,
+		Float32 = 1
+	};
+
+	char magic[4];
+	uint32_t version;
+	uint32_t rows;
+	uint32_t cols;
+	uint32_t format;
+	// Size of a tile, 0 if samples are stored row by row
+	uint32_t tileRows;
+	uint32_t tileCols;
+	// Range of Float32 samples, remapped between 0 and 1
+	float minimum;
+	float maximum;
+	// Size in bytes of the metadata, a multiple of 64 so that samples stay aligned (version 2)
+	uint32_t metadataSize;
+	uint8_t padding[24];
+};
+
+static_assert(sizeof(RawHeightmapHeader) == 64, "The raw heightmap header should be 64 bytes long.");
+
+/// <summary>
+/// A control function backed by a memory mapped raw heightmap.
+/// Only the pages touched by the evaluation are loaded in memory.
+/// Sampling and domain are the same as ImageControlFunction.
+/// </summary>
+class RawHeightmapControlFunction : public ControlFunction<RawHeightmapControlFunction>
+{
+	friend class ControlFunction<RawHeightmapControlFunction>;
+
+public:
+	explicit RawHeightmapControlFunction(const std::string& filename);
+
+	/// <summary>
+	/// Check whether the file has been mapped and has a valid header
+	/// </summary>
+	bool isOpen() const
+	{
+		return m_samples != nullptr;
+	}
+
+	int rows() const
+	{
+		return int(m_header.rows);
+	}
+
+	int cols() const
+	{
+		return int(m_header.cols);
+	}
+
+	/// <summary>
+	/// Text stored with the heightmap, empty if there is none
+	/// </summary>
+	const std::string& metadata() const
+	{
+		return m_metadata;
+	}
+
+	/// <summary>
+	/// Save an image (CV_8U, CV_16U or CV_32F) in a raw heightmap file
+	/// </summary>
+	/// <param name="filename">Name of the file</param>
+	/// <param name="image">Image to save</param>
+	/// <param name="tileSize">Size of square tiles, 0 to store samples row by row</param>
+	/// <param name="metadata">Text stored with the heightmap</param>
+	/// <returns>True if the file has been successfully written</returns>
+	static bool save(const std::string& filename, const cv::Mat& image, int tileSize = 0, const std::string& metadata = std::string());
+
+protected:
+	double EvaluateImpl(double x, double y) const
+	{
+		x = std::clamp(x, 0.0, 1.0);
+		y = std::clamp(y, 0.0, 1.0);
+
+		return sample(y, x);
+	}
+
+	bool InsideDomainImpl(double x, double y) const
+	{
+		return x >= 0.0 && x <= 1.0 && y >= 0.0 && y <= 1.0;
+	}
+
+	double DistToDomainImpl(double x, double y) const
+	{
+		if (InsideDomainImpl(x, y))
+		{
+			return 0.0;
+		}
+
+		return distToRectangle(Point2D(x, y), Point2D(0.0, 0.0), Point2D(1.0, 1.0));
+	}
+
+	double MinimumImpl() const
+	{
+		return 0.0;
+	}
+
+	double MaximumImpl() const
+	{
+		return 1.0;
+	}
+
+private:
+	std::size_t offset(int i, int j) const
+	{
+		if (m_header.tileRows == 0 || m_header.tileCols == 0)
+		{
+			return std::size_t(i) * m_header.cols + j;
+		}
+
+		const std::size_t tileI = i / m_header.tileRows;
+		const std::size_t tileJ = j / m_header.tileCols;
+		const std::size_t tileIndex = tileI * m_tilesPerRow + tileJ;
+		const std::size_t tileSize = std::size_t(m_header.tileRows) * m_header.tileCols;
+
+		return tileIndex * tileSize + (i % m_header.tileRows) * m_header.tileCols + (j % m_header.tileCols);
+	}
+
+	double get(int i, int j) const
+	{
+		double value = 0.0;
+
+		switch (m_header.format)
+		{
+		case RawHeightmapHeader::Uint16:
+		{
+			uint16_t sample;
+			std::memcpy(&sample, m_samples + offset(i, j) * sizeof(uint16_t), sizeof(uint16_t));
+			value = double(sample) / std::numeric_limits<uint16_t>::max();
+			break;
+		}
+		case RawHeightmapHeader::Float32:
+		{
+			float sample;
+			std::memcpy(&sample, m_samples + offset(i, j) * sizeof(float), sizeof(float));
+			value = (double(sample) - m_header.minimum) * m_scale;
+			break;
+		}
+		}
+
+		return value;
+	}
+
+	double sample(double ri, double rj) const;
+
+	MemoryMappedFile m_file;
+	RawHeightmapHeader m_header{};
+	std::string m_metadata;
+	const uint8_t* m_samples = nullptr;
+	std::size_t m_tilesPerRow = 0;
+	double m_scale = 1.0;
+};
+
+#endif // RAWHEIGHTMAPCONTROLFUNCTION_H
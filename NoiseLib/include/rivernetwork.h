@@ -0,0 +1,163 @@
+#ifndef RIVERNETWORK_H
+#define RIVERNETWORK_H
+
+#include <array>
+#include <vector>
+#include <cassert>
+
+#include "math2d.h"
+#include "math3d.h"
+
+/// <summary>
+/// Network of segments generated by a Noise over a bounded domain, baked once to be queried many times.
+/// Each level covers a rectangle of cells. Each cell stores its point and the chain of segments starting from it.
+/// Segments are stored as a compact graph: edges are pairs of indices in the array of nodes,
+/// and the elevation of a node is its z coordinate.
+/// The cells of a level are a uniform grid index: segments near to a point are found in the cells around it.
+/// </summary>
+class RiverNetwork
+{
+public:
+	struct Edge
+	{
+		int a;
+		int b;
+		int level;
+	};
+
+	RiverNetwork() = default;
+
+	/// <summary>
+	/// Add a level to the network, levels are numbered from 1
+	/// </summary>
+	/// <param name="resolution">Resolution of the cells of the level</param>
+	/// <param name="segmentsPerCell">Number of segments in the chain of each cell</param>
+	/// <param name="minX">Smallest x coordinate of the cells covered by the level</param>
+	/// <param name="minY">Smallest y coordinate of the cells covered by the level</param>
+	/// <param name="maxX">Largest x coordinate of the cells covered by the level</param>
+	/// <param name="maxY">Largest y coordinate of the cells covered by the level</param>
+	/// <returns>The number of the new level</returns>
+	int addLevel(int resolution, int segmentsPerCell, int minX, int minY, int maxX, int maxY);
+
+	/// <summary>
+	/// Add a level to the network with the cells of a level of another network, which must contain all of them
+	/// </summary>
+	/// <param name="source">Network the cells are copied from</param>
+	/// <param name="level">Level of the source network, and of the new level</param>
+	/// <param name="minX">Smallest x coordinate of the cells covered by the level</param>
+	/// <param name="minY">Smallest y coordinate of the cells covered by the level</param>
+	/// <param name="maxX">Largest x coordinate of the cells covered by the level</param>
+	/// <param name="maxY">Largest y coordinate of the cells covered by the level</param>
+	/// <returns>The number of the new level</returns>
+	int addLevel(const RiverNetwork& source, int level, int minX, int minY, int maxX, int maxY);
+
+	/// <summary>
+	/// Set the point and the chain of segments of a cell.
+	/// Setting different cells concurrently is safe.
+	/// </summary>
+	template <size_t D>
+	void setCell(int level, int x, int y, const Point2D& point, const std::array<Segment3D, D>& chain);
+
+	int levels() const
+	{
+		return int(m_levels.size());
+	}
+
+	int resolution(int level) const
+	{
+		return Level(level).resolution;
+	}
+
+	int segmentsPerCell(int level) const
+	{
+		return Level(level).segmentsPerCell;
+	}
+
+	bool containsCell(int level, int x, int y) const;
+
+	Point2D point(int level, int x, int y) const
+	{
+		const LevelGrid& grid = Level(level);
+		return m_points[grid.firstPoint + CellIndex(grid, x, y)];
+	}
+
+	/// <summary>
+	/// Index of the first edge of the chain of a cell, the others follow it
+	/// </summary>
+	int firstEdge(int level, int x, int y) const
+	{
+		const LevelGrid& grid = Level(level);
+		return grid.firstEdge + CellIndex(grid, x, y) * grid.segmentsPerCell;
+	}
+
+	Segment3D segment(int edge) const
+	{
+		return Segment3D(m_nodes[m_edges[edge].a], m_nodes[m_edges[edge].b]);
+	}
+
+	const std::vector<Point3D>& nodes() const
+	{
+		return m_nodes;
+	}
+
+	const std::vector<Edge>& edges() const
+	{
+		return m_edges;
+	}
+
+private:
+	struct LevelGrid
+	{
+		int resolution;
+		int segmentsPerCell;
+		int minX;
+		int minY;
+		int width;
+		int height;
+		// Offsets of the level in the arrays of the network
+		int firstPoint;
+		int firstNode;
+		int firstEdge;
+	};
+
+	const LevelGrid& Level(int level) const
+	{
+		assert(level >= 1 && level <= levels());
+		return m_levels[level - 1];
+	}
+
+	int CellIndex(const LevelGrid& grid, int x, int y) const
+	{
+		assert(x >= grid.minX && x < grid.minX + grid.width);
+		assert(y >= grid.minY && y < grid.minY + grid.height);
+		return (y - grid.minY) * grid.width + (x - grid.minX);
+	}
+
+	std::vector<LevelGrid> m_levels;
+
+	// Point of each cell of each level
+	std::vector<Point2D> m_points;
+
+	std::vector<Point3D> m_nodes;
+	std::vector<Edge> m_edges;
+};
+
+template <size_t D>
+void RiverNetwork::setCell(int level, int x, int y, const Point2D& point, const std::array<Segment3D, D>& chain)
+{
+	const LevelGrid& grid = Level(level);
+	assert(grid.segmentsPerCell == int(D));
+
+	const int cell = CellIndex(grid, x, y);
+	m_points[grid.firstPoint + cell] = point;
+
+	// Consecutive segments of a chain share their nodes
+	const int firstNode = grid.firstNode + cell * (int(D) + 1);
+	for (unsigned int d = 0; d < chain.size(); d++)
+	{
+		m_nodes[firstNode + d] = chain[d].a;
+	}
+	m_nodes[firstNode + D] = chain.back().b;
+}
+
+#endif // RIVERNETWORK_H
@@ -1,6 +1,8 @@
 #ifndef SPLINE_H
 #define SPLINE_H
 
+#include <cassert>
+
 #include "math2d.h"
 #include "math3d.h"
 
@@ -14,16 +16,77 @@ Point3D CatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2
 Point2D SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3, double x);
 Point3D SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3, double x);
 
+// Knots of a chordal Catmull-Rom spline and the reciprocals of their differences
+// They only depend on the control points and are shared by all the points evaluated on the spline
+struct CatmullRomKnots
+{
+	double t0;
+	double t1;
+	double t2;
+	double t3;
+
+	double inv10; // 1 / (t1 - t0)
+	double inv21; // 1 / (t2 - t1)
+	double inv32; // 1 / (t3 - t2)
+	double inv20; // 1 / (t2 - t0)
+	double inv31; // 1 / (t3 - t1)
+};
+
+template <typename Point>
+CatmullRomKnots ChordalCatmullRomKnots(const Point& p0, const Point& p1, const Point& p2, const Point& p3)
+{
+	CatmullRomKnots knots;
+
+	knots.t0 = 0.0;
+	knots.t1 = dist(p0, p1) + knots.t0;
+	knots.t2 = dist(p1, p2) + knots.t1;
+	knots.t3 = dist(p2, p3) + knots.t2;
+
+	assert(knots.t0 != knots.t1);
+	assert(knots.t0 != knots.t2);
+	assert(knots.t1 != knots.t3);
+	assert(knots.t2 != knots.t3);
+
+	knots.inv10 = 1.0 / (knots.t1 - knots.t0);
+	knots.inv21 = 1.0 / (knots.t2 - knots.t1);
+	knots.inv32 = 1.0 / (knots.t3 - knots.t2);
+	knots.inv20 = 1.0 / (knots.t2 - knots.t0);
+	knots.inv31 = 1.0 / (knots.t3 - knots.t1);
+
+	return knots;
+}
+
+// Evaluate a chordal Catmull-Rom spline at the absolute time t using precomputed knots
+// Only multiplications are needed, divisions are replaced by the reciprocals in knots
+template <typename Point>
+Point CatmullRomSpline(const CatmullRomKnots& k, const Point& p0, const Point& p1, const Point& p2, const Point& p3, double t)
+{
+	const Point a1 = p0 * ((k.t1 - t) * k.inv10) + p1 * ((t - k.t0) * k.inv10);
+	const Point a2 = p1 * ((k.t2 - t) * k.inv21) + p2 * ((t - k.t1) * k.inv21);
+	const Point a3 = p2 * ((k.t3 - t) * k.inv32) + p3 * ((t - k.t2) * k.inv32);
+
+	const Point b1 = a1 * ((k.t2 - t) * k.inv20) + a2 * ((t - k.t0) * k.inv20);
+	const Point b2 = a2 * ((k.t3 - t) * k.inv31) + a3 * ((t - k.t1) * k.inv31);
+
+	return b1 * ((k.t2 - t) * k.inv21) + b2 * ((t - k.t1) * k.inv21);
+}
+
 // Subdivide the segment between p1 and p2 using a chordal Catmull-Rom spline in N points
-template <size_t N>
-std::array<Point2D, N> SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3)
+// Knots are computed once for the N points. Compared to N calls to the scalar SubdivideCatmullRomSpline,
+// the points differ by a few ulps only, because divisions are replaced by multiplications by reciprocals:
+// the relative difference is below 1e-14 of the length of the spline (checked by tests/test_spline.cpp).
+template <typename Point, size_t N>
+std::array<Point, N> SubdivideCatmullRomSplineBatch(const Point& p0, const Point& p1, const Point& p2, const Point& p3)
 {
-	std::array<Point2D, N> points;
+	const CatmullRomKnots knots = ChordalCatmullRomKnots(p0, p1, p2, p3);
+
+	std::array<Point, N> points;
 
-	for (int n = 0; n < points.size(); n++)
+	for (size_t n = 0; n < points.size(); n++)
 	{
-		const double t = double(n + 1) / (N + 1);
-		points[n] = SubdivideCatmullRomSpline(p0, p1, p2, p3, t);
+		// Evaluate the Spline between p1 and p2
+		const double t = lerp(knots.t1, knots.t2, double(n + 1) / (N + 1));
+		points[n] = CatmullRomSpline(knots, p0, p1, p2, p3, t);
 	}
 
 	return points;
@@ -31,17 +94,16 @@ std::array<Point2D, N> SubdivideCatmullRomSpline(const Point2D& p0, const Point2
 
 // Subdivide the segment between p1 and p2 using a chordal Catmull-Rom spline in N points
 template <size_t N>
-std::array<Point3D, N> SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3)
+std::array<Point2D, N> SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3)
 {
-	std::array<Point3D, N> points;
-
-	for (int n = 0; n < points.size(); n++)
-	{
-		const double t = double(n + 1) / (N + 1);
-		points[n] = SubdivideCatmullRomSpline(p0, p1, p2, p3, t);
-	}
+	return SubdivideCatmullRomSplineBatch<Point2D, N>(p0, p1, p2, p3);
+}
 
-	return points;
+// Subdivide the segment between p1 and p2 using a chordal Catmull-Rom spline in N points
+template <size_t N>
+std::array<Point3D, N> SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3)
+{
+	return SubdivideCatmullRomSplineBatch<Point3D, N>(p0, p1, p2, p3);
 }
 
 #endif // SPLINE_H
\ No newline at end of file
@@ -2,7 +2,9 @@
 #define UTILS_H
 
 #include <cassert>
+#include <cmath>
 #include <array>
+#include <algorithm>
 
 template<typename T>
 T remap(const T& x, const T& in_start, const T& in_end, const T& out_start, const T& out_end)
@@ -61,6 +63,12 @@ T smoother(T x)
 	return x * x * x * (x * (x * 6.0 - 15.0) + 10.0);
 }
 
+template<typename T>
+T smoother_derivative(T x)
+{
+	return 30.0 * x * x * (x - 1.0) * (x - 1.0);
+}
+
 template<typename T>
 T robust_mod(T a, T b)
 {
@@ -96,12 +104,84 @@ T WyvillGalinFunction(const T& distance, const T& R, const T& N)
 	return alpha;
 }
 
+// Derivative of WyvillGalinFunction with respect to the distance
+template<typename T>
+T WyvillGalinFunctionDerivative(const T& distance, const T& R, const T& N)
+{
+	T derivative = 0.0;
+
+	if (distance < R)
+	{
+		derivative = -2.0 * N * distance / (R * R) * pow(1 - (distance / R) * (distance / R), N - 1);
+	}
+
+	return derivative;
+}
+
 double cubic_interpolate(double p0, double p1, double p2, double p3, double t);
 
 double cubic_interpolate(const std::array<double, 4>& p, double t);
 
 double bi_cubic_interpolate(const std::array<std::array<double, 4>, 4>& p, double u, double v);
 
+/// <summary>
+/// Bi-cubic sampling of a grid of rows x cols values in relative coordinates.
+/// Values outside the grid are clamped to the border.
+/// </summary>
+/// <param name="rows">Number of rows in the grid</param>
+/// <param name="cols">Number of columns in the grid</param>
+/// <param name="ri">Relative row coordinate in [0, 1]</param>
+/// <param name="rj">Relative column coordinate in [0, 1]</param>
+/// <param name="get">Function returning the value at integer coordinates (i, j)</param>
+/// <returns>The interpolated value clamped between 0 and 1</returns>
+template<typename Getter>
+double bi_cubic_sample(int rows, int cols, double ri, double rj, const Getter& get)
+{
+	assert(0.0 <= ri && ri <= 1.0);
+	assert(0.0 <= rj && rj <= 1.0);
+
+	ri *= rows - 1;
+	rj *= cols - 1;
+
+	// If the coordinates are integer, return directly the value
+	if (nearbyint(ri) == ri && nearbyint(rj) == rj)
+	{
+		return get(int(ri), int(rj));
+	}
+
+	const auto i1 = int(floor(ri));
+	const auto j1 = int(floor(rj));
+
+	// i = {i1 - 1, i1, i1 + 1, i1 + 2}
+	const std::array<int, 4> i = {
+		std::max(i1 - 1, 0),
+		i1,
+		std::min(i1 + 1, rows - 1),
+		std::min(i1 + 2, rows - 1)
+	};
+
+	// j = {j1 - 1, j1, j1 + 1, j1 + 2}
+	const std::array<int, 4> j = {
+		std::max(j1 - 1, 0),
+		j1,
+		std::min(j1 + 1, cols - 1),
+		std::min(j1 + 2, cols - 1)
+	};
+
+	std::array<std::array<double, 4>, 4> p{};
+	for (int k = 0; k < 4; k++)
+	{
+		for (int l = 0; l < 4; l++)
+		{
+			p[k][l] = get(i[k], j[l]);
+		}
+	}
+
+	const double interpolation = bi_cubic_interpolate(p, ri - floor(ri), rj - floor(rj));
+
+	return std::clamp(interpolation, 0.0, 1.0);
+}
+
 // Equivalent of the Jet coloring in Matlab.
 std::array<double, 3> matlab_jet(double u);
 
@@ -0,0 +1,184 @@
+#include "distancetransform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+	/// <summary>
+	/// One dimensional squared distance transform: lower envelope of parabolas rooted at each sample.
+	/// f and d are accessed with a stride so that rows and columns can be transformed in place.
+	/// If fl and dl are not null, the label of the sample at the root of the nearest parabola is copied from fl to dl.
+	/// </summary>
+	void SquaredDistanceTransform1D(const double* f, double* d, const int* fl, int* dl, int n, int stride, double spacing, std::vector<int>& v, std::vector<double>& z, std::vector<double>& buffer, std::vector<int>& labelBuffer)
+	{
+		const double inf = std::numeric_limits<double>::infinity();
+		const double w = spacing * spacing;
+
+		// Copy the input so that f and d may alias
+		for (int q = 0; q < n; q++)
+		{
+			buffer[q] = f[q * stride];
+		}
+
+		if (fl != nullptr)
+		{
+			for (int q = 0; q < n; q++)
+			{
+				labelBuffer[q] = fl[q * stride];
+			}
+		}
+
+		// Index of the first parabola rooted on a finite sample
+		int k = -1;
+		for (int q = 0; q < n; q++)
+		{
+			if (buffer[q] == inf)
+			{
+				continue;
+			}
+
+			if (k < 0)
+			{
+				k = 0;
+				v[0] = q;
+				z[0] = -inf;
+				z[1] = inf;
+				continue;
+			}
+
+			// Intersection between the parabola rooted at q and the last parabola of the envelope
+			double s = ((buffer[q] + w * q * q) - (buffer[v[k]] + w * v[k] * v[k])) / (2.0 * w * (q - v[k]));
+			while (s <= z[k])
+			{
+				k--;
+				s = ((buffer[q] + w * q * q) - (buffer[v[k]] + w * v[k] * v[k])) / (2.0 * w * (q - v[k]));
+			}
+
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = inf;
+		}
+
+		// No feature on this line
+		if (k < 0)
+		{
+			for (int q = 0; q < n; q++)
+			{
+				d[q * stride] = inf;
+			}
+
+			if (dl != nullptr)
+			{
+				for (int q = 0; q < n; q++)
+				{
+					dl[q * stride] = -1;
+				}
+			}
+
+			return;
+		}
+
+		k = 0;
+		for (int q = 0; q < n; q++)
+		{
+			while (z[k + 1] < q)
+			{
+				k++;
+			}
+
+			d[q * stride] = w * (q - v[k]) * (q - v[k]) + buffer[v[k]];
+
+			if (dl != nullptr)
+			{
+				dl[q * stride] = labelBuffer[v[k]];
+			}
+		}
+	}
+
+	std::vector<double> SquaredDistanceTransform2D(const std::vector<double>& f, int rows, int cols, double spacingI, double spacingJ, std::vector<int>* nearest)
+	{
+		assert(f.size() == std::size_t(rows) * cols);
+
+		std::vector<double> d(f.size());
+
+		const int n = std::max(rows, cols);
+		std::vector<int> v(n);
+		std::vector<double> z(n + 1);
+		std::vector<double> buffer(n);
+		std::vector<int> labelBuffer(n);
+
+		// Features are labelled with their own index
+		std::vector<int> labels;
+		int* l = nullptr;
+		if (nearest != nullptr)
+		{
+			labels.resize(f.size());
+			for (std::size_t k = 0; k < f.size(); k++)
+			{
+				labels[k] = (f[k] != std::numeric_limits<double>::infinity()) ? int(k) : -1;
+			}
+
+			nearest->resize(f.size());
+			l = nearest->data();
+		}
+
+		// Transform along columns, then along rows.
+		// Columns are transformed by blocks copied row by row, so that their samples are read and written in order instead of with the stride of a row.
+		const int blockCols = 16;
+		std::vector<double> block(std::size_t(rows) * blockCols);
+		std::vector<int> labelBlock(l ? std::size_t(rows) * blockCols : 0);
+		for (int j0 = 0; j0 < cols; j0 += blockCols)
+		{
+			const int n = std::min(blockCols, cols - j0);
+
+			for (int i = 0; i < rows; i++)
+			{
+				std::copy_n(f.data() + std::size_t(i) * cols + j0, n, block.data() + std::size_t(i) * blockCols);
+				if (l)
+				{
+					std::copy_n(labels.data() + std::size_t(i) * cols + j0, n, labelBlock.data() + std::size_t(i) * blockCols);
+				}
+			}
+
+			for (int j = 0; j < n; j++)
+			{
+				SquaredDistanceTransform1D(block.data() + j, block.data() + j, l ? labelBlock.data() + j : nullptr, l ? labelBlock.data() + j : nullptr, rows, blockCols, spacingI, v, z, buffer, labelBuffer);
+			}
+
+			for (int i = 0; i < rows; i++)
+			{
+				std::copy_n(block.data() + std::size_t(i) * blockCols, n, d.data() + std::size_t(i) * cols + j0);
+				if (l)
+				{
+					std::copy_n(labelBlock.data() + std::size_t(i) * blockCols, n, l + std::size_t(i) * cols + j0);
+				}
+			}
+		}
+
+		for (int i = 0; i < rows; i++)
+		{
+			const std::size_t row = std::size_t(i) * cols;
+			SquaredDistanceTransform1D(d.data() + row, d.data() + row, l ? l + row : nullptr, l ? l + row : nullptr, cols, 1, spacingJ, v, z, buffer, labelBuffer);
+		}
+
+		return d;
+	}
+}
+
+std::vector<double> SquaredDistanceTransform(const std::vector<double>& f, int rows, int cols, double spacingI, double spacingJ)
+{
+	return SquaredDistanceTransform2D(f, rows, cols, spacingI, spacingJ, nullptr);
+}
+
+std::vector<double> SquaredDistanceTransform(const std::vector<double>& f, int rows, int cols, std::vector<int>& nearest, double spacingI, double spacingJ)
+{
+	return SquaredDistanceTransform2D(f, rows, cols, spacingI, spacingJ, &nearest);
+}
+
+double DistanceTransformInfinity()
+{
+	return std::numeric_limits<double>::infinity();
+}
@@ -0,0 +1,127 @@
+#include "domainmask.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "distancetransform.h"
+
+DomainMask::DomainMask(const cv::Mat& mask, const Point2D& topLeft, const Point2D& bottomRight) :
+	m_topLeft(topLeft),
+	m_bottomRight(bottomRight),
+	m_rows(mask.rows),
+	m_cols(mask.cols),
+	m_pixelSizeX((bottomRight.x - topLeft.x) / mask.cols),
+	m_pixelSizeY((bottomRight.y - topLeft.y) / mask.rows)
+{
+	assert(mask.data != nullptr);
+	assert(mask.channels() == 1);
+
+	ComputeSignedDistance(mask);
+}
+
+DomainMask::DomainMask(const std::vector<Point2D>& polygon, const Point2D& topLeft, const Point2D& bottomRight, int rows, int cols) :
+	m_topLeft(topLeft),
+	m_bottomRight(bottomRight),
+	m_rows(rows),
+	m_cols(cols),
+	m_pixelSizeX((bottomRight.x - topLeft.x) / cols),
+	m_pixelSizeY((bottomRight.y - topLeft.y) / rows)
+{
+	assert(polygon.size() >= 3);
+
+	// Rasterize the polygon in pixel coordinates
+	std::vector<cv::Point> vertices;
+	vertices.reserve(polygon.size());
+	for (const auto& p : polygon)
+	{
+		vertices.emplace_back(
+			int(std::lround((p.x - topLeft.x) / m_pixelSizeX - 0.5)),
+			int(std::lround((p.y - topLeft.y) / m_pixelSizeY - 0.5))
+		);
+	}
+
+	cv::Mat mask(rows, cols, CV_8U, cv::Scalar(0));
+	cv::fillPoly(mask, std::vector<std::vector<cv::Point> >{ vertices }, cv::Scalar(255));
+
+	ComputeSignedDistance(mask);
+}
+
+void DomainMask::ComputeSignedDistance(const cv::Mat& mask)
+{
+	assert(m_rows > 1 && m_cols > 1);
+	assert(m_pixelSizeX > 0.0 && m_pixelSizeY > 0.0);
+
+	const std::size_t size = std::size_t(m_rows) * m_cols;
+	const double inf = DistanceTransformInfinity();
+
+	// Features are the inside pixels for the outside distance and conversely
+	std::vector<double> inside(size);
+	std::vector<double> outside(size);
+	for (int i = 0; i < m_rows; i++)
+	{
+		for (int j = 0; j < m_cols; j++)
+		{
+			const bool isInside = mask.depth() == CV_8U ? mask.at<uint8_t>(i, j) != 0
+				: mask.depth() == CV_16U ? mask.at<uint16_t>(i, j) != 0
+				: mask.at<float>(i, j) != 0.0f;
+
+			inside[std::size_t(i) * m_cols + j] = isInside ? 0.0 : inf;
+			outside[std::size_t(i) * m_cols + j] = isInside ? inf : 0.0;
+		}
+	}
+
+	const std::vector<double> distToInside = SquaredDistanceTransform(inside, m_rows, m_cols, m_pixelSizeY, m_pixelSizeX);
+	const std::vector<double> distToOutside = SquaredDistanceTransform(outside, m_rows, m_cols, m_pixelSizeY, m_pixelSizeX);
+
+	// The border of the domain lies half a pixel away from the center of the pixels
+	const double halfPixel = std::min(m_pixelSizeX, m_pixelSizeY) / 2.0;
+	// If the mask is fully inside, or fully outside, the distance to the border of the mask is used instead
+	const double maskSize = std::max(m_bottomRight.x - m_topLeft.x, m_bottomRight.y - m_topLeft.y);
+
+	m_signedDistance.resize(size);
+	for (std::size_t k = 0; k < size; k++)
+	{
+		if (outside[k] == inf)
+		{
+			m_signedDistance[k] = (distToOutside[k] == inf) ? -maskSize : -(std::sqrt(distToOutside[k]) - halfPixel);
+		}
+		else
+		{
+			m_signedDistance[k] = (distToInside[k] == inf) ? maskSize : std::sqrt(distToInside[k]) - halfPixel;
+		}
+	}
+}
+
+double DomainMask::signedDistance(double x, double y) const
+{
+	// Continuous coordinates in the mask, the center of pixel (i, j) is (i, j)
+	const double ri = (y - m_topLeft.y) / m_pixelSizeY - 0.5;
+	const double rj = (x - m_topLeft.x) / m_pixelSizeX - 0.5;
+
+	const double ci = std::clamp(ri, 0.0, double(m_rows - 1));
+	const double cj = std::clamp(rj, 0.0, double(m_cols - 1));
+
+	const int i0 = std::min(int(ci), m_rows - 2);
+	const int j0 = std::min(int(cj), m_cols - 2);
+	const double u = ci - i0;
+	const double v = cj - j0;
+
+	const double* row0 = m_signedDistance.data() + std::size_t(i0) * m_cols;
+	const double* row1 = row0 + m_cols;
+
+	const double distance = lerp(lerp(row0[j0], row0[j0 + 1], v), lerp(row1[j0], row1[j0 + 1], v), u);
+
+	// Outside of the pixel centers, add the distance to the nearest pixel center
+	if (ri != ci || rj != cj)
+	{
+		const double dx = (rj - cj) * m_pixelSizeX;
+		const double dy = (ri - ci) * m_pixelSizeY;
+
+		return std::max(distance, 0.0) + std::sqrt(dx * dx + dy * dy);
+	}
+
+	return distance;
+}
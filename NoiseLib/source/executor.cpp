@@ -0,0 +1,514 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+	// Whether the current thread is running a chunk of a loop, nested loops then run on this thread only
+	thread_local bool t_insideLoop = false;
+
+	class InsideLoopScope
+	{
+	public:
+		InsideLoopScope() :
+			m_previous(t_insideLoop)
+		{
+			t_insideLoop = true;
+		}
+
+		~InsideLoopScope()
+		{
+			t_insideLoop = m_previous;
+		}
+
+	private:
+		const bool m_previous;
+	};
+
+	/// <summary>
+	/// First exception thrown by the chunks of a loop.
+	/// Chunks starting after it are skipped, and it is rethrown on the calling thread once the running chunks are done.
+	/// </summary>
+	class FirstException
+	{
+	public:
+		FirstException() :
+			m_thrown(false)
+		{
+		}
+
+		template <typename F>
+		void run(F&& chunk)
+		{
+			if (m_thrown.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			try
+			{
+				chunk();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_exception)
+				{
+					m_exception = std::current_exception();
+				}
+				m_thrown.store(true, std::memory_order_relaxed);
+			}
+		}
+
+		bool thrown() const
+		{
+			return m_thrown.load(std::memory_order_relaxed);
+		}
+
+		void rethrow()
+		{
+			if (m_exception)
+			{
+				std::rethrow_exception(m_exception);
+			}
+		}
+
+	private:
+		std::atomic<bool> m_thrown;
+		std::mutex m_mutex;
+		std::exception_ptr m_exception;
+	};
+
+	std::mutex globalMutex;
+	std::unique_ptr<Executor> globalExecutor;
+
+	int EnvironmentInteger(const char* name, int defaultValue)
+	{
+		const char* value = std::getenv(name);
+
+		return value != nullptr ? std::atoi(value) : defaultValue;
+	}
+
+	int CoreCount()
+	{
+		return std::max(1, int(std::thread::hardware_concurrency()));
+	}
+}
+
+/// <summary>
+/// A loop running on the threads of the executor.
+/// Chunks of a dynamic loop are taken in order by any thread.
+/// A static loop has one chunk per thread, the indices of the thread.
+/// </summary>
+struct Executor::Loop
+{
+	// Function of a dynamic loop, called on chunks
+	const std::function<void(int, int)>* body;
+	// Function of a static loop, called on indices
+	const std::function<void(int)>* function;
+	const int begin;
+	const int end;
+	const int grain;
+	// Number of threads of a static loop, 0 for a dynamic loop
+	const int threads;
+	// First index of the next chunk of a dynamic loop
+	std::atomic<int> next;
+	// Whether the chunk of each thread of a static loop is taken
+	std::unique_ptr<std::atomic<bool>[]> taken;
+	// Chunks not finished yet
+	std::atomic<int> remaining;
+	// First exception thrown by a chunk, rethrown by the calling thread
+	FirstException exception;
+
+	std::mutex mutex;
+	std::condition_variable finished;
+
+	Loop(int begin, int end, int grain, const std::function<void(int, int)>& body) :
+		body(&body),
+		function(nullptr),
+		begin(begin),
+		end(end),
+		grain(grain),
+		threads(0),
+		next(begin),
+		remaining((end - begin + grain - 1) / grain)
+	{
+	}
+
+	Loop(int begin, int end, int threads, const std::function<void(int)>& function) :
+		body(nullptr),
+		function(&function),
+		begin(begin),
+		end(end),
+		grain(1),
+		// Threads after the last index have no chunk
+		threads(std::min(threads, end - begin)),
+		next(begin),
+		taken(new std::atomic<bool>[this->threads]),
+		remaining(this->threads)
+	{
+		for (int thread = 0; thread < this->threads; thread++)
+		{
+			taken[thread].store(false, std::memory_order_relaxed);
+		}
+	}
+
+	bool isStatic() const
+	{
+		return threads > 0;
+	}
+};
+
+Executor::Executor(const Configuration& configuration) :
+	m_configuration(configuration),
+	m_stopping(false)
+{
+	if (m_configuration.threads <= 0)
+	{
+		m_configuration.threads = CoreCount();
+	}
+
+	// The calling thread of a loop is one of the threads running it
+	if (m_configuration.backend == Backend::Threads)
+	{
+		for (int worker = 0; worker < m_configuration.threads - 1; worker++)
+		{
+			m_workers.emplace_back(&Executor::WorkerMain, this, worker);
+		}
+	}
+}
+
+Executor::~Executor()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_loopsAvailable.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+Executor& Executor::global()
+{
+	std::lock_guard<std::mutex> lock(globalMutex);
+
+	if (!globalExecutor)
+	{
+		globalExecutor = std::make_unique<Executor>(environmentConfiguration());
+	}
+
+	return *globalExecutor;
+}
+
+void Executor::configureGlobal(const Configuration& configuration)
+{
+	std::lock_guard<std::mutex> lock(globalMutex);
+
+	globalExecutor.reset();
+	globalExecutor = std::make_unique<Executor>(configuration);
+}
+
+Executor::Configuration Executor::environmentConfiguration()
+{
+	Configuration configuration;
+
+	const char* backend = std::getenv("NOISE_EXECUTOR");
+	if (backend != nullptr && std::string(backend) == "openmp")
+	{
+		configuration.backend = Backend::OpenMP;
+	}
+
+	configuration.threads = EnvironmentInteger("NOISE_THREADS", EnvironmentInteger("OMP_NUM_THREADS", 0));
+	configuration.pinThreads = EnvironmentInteger("NOISE_PIN_THREADS", 0) != 0;
+
+	return configuration;
+}
+
+Executor::Backend Executor::backend() const
+{
+	return m_configuration.backend;
+}
+
+int Executor::threads() const
+{
+	return m_configuration.threads;
+}
+
+void Executor::parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body)
+{
+	assert(grain > 0);
+
+	if (begin >= end)
+	{
+		return;
+	}
+
+	// Nested loops and loops of a single chunk do not need other threads
+	if (t_insideLoop || end - begin <= grain || m_configuration.threads == 1)
+	{
+		InsideLoopScope scope;
+		body(begin, end);
+		return;
+	}
+
+	if (m_configuration.backend == Backend::OpenMP)
+	{
+		RunOpenMP(begin, end, grain, body);
+	}
+	else
+	{
+		RunThreads(std::make_shared<Loop>(begin, end, grain, body));
+	}
+}
+
+void Executor::parallelForStatic(int begin, int end, const std::function<void(int)>& function)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	if (t_insideLoop || m_configuration.threads == 1)
+	{
+		InsideLoopScope scope;
+		for (int i = begin; i < end; i++)
+		{
+			function(i);
+		}
+		return;
+	}
+
+	if (m_configuration.backend == Backend::OpenMP)
+	{
+		const int threads = m_configuration.threads;
+
+		// Exceptions cannot leave an OpenMP region, they are rethrown after it
+		FirstException exception;
+
+		// Iterations are given in turn to the threads of the team, the calling thread is the thread 0
+		// Pinned threads keep their place between loops, so that first-touched memory stays on their node
+#if _OPENMP >= 201307
+		if (m_configuration.pinThreads)
+		{
+#pragma omp parallel for schedule(static, 1) num_threads(threads) proc_bind(close)
+			for (int i = begin; i < end; i++)
+			{
+				InsideLoopScope scope;
+				exception.run([&]() { function(i); });
+			}
+
+			exception.rethrow();
+			return;
+		}
+#endif
+
+#pragma omp parallel for schedule(static, 1) num_threads(threads)
+		for (int i = begin; i < end; i++)
+		{
+			InsideLoopScope scope;
+			exception.run([&]() { function(i); });
+		}
+
+		exception.rethrow();
+	}
+	else
+	{
+		RunThreads(std::make_shared<Loop>(begin, end, m_configuration.threads, function));
+	}
+}
+
+void Executor::RunOpenMP(int begin, int end, int grain, const std::function<void(int, int)>& body) const
+{
+	const int chunks = (end - begin + grain - 1) / grain;
+	const int threads = m_configuration.threads;
+
+	// Exceptions cannot leave an OpenMP region, they are rethrown after it
+	FirstException exception;
+
+	const auto runChunk = [&](int chunk)
+	{
+		InsideLoopScope scope;
+
+		const int first = begin + chunk * grain;
+		exception.run([&]() { body(first, std::min(first + grain, end)); });
+	};
+
+	// The proc_bind clause needs OpenMP 4.0
+#if _OPENMP >= 201307
+	if (m_configuration.pinThreads)
+	{
+#pragma omp parallel for schedule(dynamic) num_threads(threads) proc_bind(close)
+		for (int chunk = 0; chunk < chunks; chunk++)
+		{
+			runChunk(chunk);
+		}
+
+		exception.rethrow();
+		return;
+	}
+#endif
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for (int chunk = 0; chunk < chunks; chunk++)
+	{
+		runChunk(chunk);
+	}
+
+	exception.rethrow();
+}
+
+void Executor::RunThreads(const std::shared_ptr<Loop>& loop)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loops.push_back(loop);
+	}
+	m_loopsAvailable.notify_all();
+
+	// The calling thread is the thread 0
+	{
+		InsideLoopScope scope;
+		while (RunChunk(*loop, 0))
+		{
+		}
+	}
+
+	// Workers may still be running the last chunks
+	{
+		std::unique_lock<std::mutex> lock(loop->mutex);
+		loop->finished.wait(lock, [&loop]() { return loop->remaining.load(std::memory_order_acquire) == 0; });
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loops.remove(loop);
+	}
+
+	loop->exception.rethrow();
+}
+
+void Executor::WorkerMain(int worker)
+{
+	// Workers are pinned to the cores after the first one, the calling thread belongs to the application and is not pinned
+	if (m_configuration.pinThreads)
+	{
+		PinThread((worker + 1) % CoreCount());
+	}
+
+	t_insideLoop = true;
+
+	// The calling thread of a loop is the thread 0
+	const int thread = worker + 1;
+
+	while (true)
+	{
+		std::shared_ptr<Loop> loop;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loopsAvailable.wait(lock, [this, worker, &loop]()
+			{
+				loop = NextLoop(worker);
+				return m_stopping || loop;
+			});
+
+			if (m_stopping)
+			{
+				return;
+			}
+		}
+
+		// Exhausted dynamic loops are removed, static loops are removed by their calling thread
+		if (!RunChunk(*loop, thread) && !loop->isStatic())
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_loops.remove(loop);
+		}
+	}
+}
+
+std::shared_ptr<Executor::Loop> Executor::NextLoop(int worker)
+{
+	const int thread = worker + 1;
+
+	for (auto it = m_loops.begin(); it != m_loops.end(); ++it)
+	{
+		const std::shared_ptr<Loop> loop = *it;
+
+		if (loop->isStatic() && (thread >= loop->threads || loop->taken[thread].load(std::memory_order_relaxed)))
+		{
+			continue;
+		}
+
+		// Loops running at the same time share the workers
+		m_loops.splice(m_loops.end(), m_loops, it);
+
+		return loop;
+	}
+
+	return nullptr;
+}
+
+bool Executor::RunChunk(Loop& loop, int thread)
+{
+	if (loop.isStatic())
+	{
+		if (thread >= loop.threads || loop.taken[thread].exchange(true, std::memory_order_relaxed))
+		{
+			return false;
+		}
+
+		for (int i = loop.begin + thread; i < loop.end && !loop.exception.thrown(); i += loop.threads)
+		{
+			loop.exception.run([&loop, i]() { (*loop.function)(i); });
+		}
+	}
+	else
+	{
+		const int first = loop.next.fetch_add(loop.grain, std::memory_order_relaxed);
+		if (first >= loop.end)
+		{
+			return false;
+		}
+
+		// Chunks are still taken after an exception, but skipped, so that the loop finishes
+		loop.exception.run([&loop, first]() { (*loop.body)(first, std::min(first + loop.grain, loop.end)); });
+	}
+
+	if (loop.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		std::lock_guard<std::mutex> lock(loop.mutex);
+		loop.finished.notify_all();
+	}
+
+	return true;
+}
+
+void Executor::PinThread(int core)
+{
+#if defined(__linux__)
+	cpu_set_t cores;
+	CPU_ZERO(&cores);
+	CPU_SET(core, &cores);
+	pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+#elif defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#endif
+}
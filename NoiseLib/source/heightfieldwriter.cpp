@@ -0,0 +1,112 @@
+#include "heightfieldwriter.h"
+
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "rawheightmapcontrolfunction.h"
+
+namespace
+{
+	const char NPY_MAGIC[6] = { '\x93', 'N', 'U', 'M', 'P', 'Y' };
+	// Size of the magic, the version and the length of the dictionary
+	const std::size_t NPY_PREAMBLE_SIZE = 10;
+	// The dictionary is padded so that the data is aligned
+	const std::size_t NPY_ALIGNMENT = 64;
+
+	/// <summary>
+	/// Write all the samples of an image, with a single write if the image is continuous
+	/// </summary>
+	bool WriteFloat32Samples(std::ofstream& file, const cv::Mat& image)
+	{
+		if (image.isContinuous())
+		{
+			file.write(reinterpret_cast<const char*>(image.ptr<float>(0)), std::streamsize(image.total() * sizeof(float)));
+
+			return bool(file);
+		}
+
+		for (int i = 0; i < image.rows; i++)
+		{
+			file.write(reinterpret_cast<const char*>(image.ptr<float>(i)), std::streamsize(image.cols * sizeof(float)));
+		}
+
+		return bool(file);
+	}
+}
+
+bool SaveRawFloat32(const std::string& filename, const cv::Mat& image)
+{
+	assert(image.data != nullptr);
+	assert(image.type() == CV_32F);
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	return WriteFloat32Samples(file, image);
+}
+
+bool SaveNpy(const std::string& filename, const cv::Mat& image)
+{
+	assert(image.data != nullptr);
+	assert(image.type() == CV_32F);
+
+	std::ostringstream dictionary;
+	dictionary << "{'descr': '<f4', 'fortran_order': False, 'shape': (" << image.rows << ", " << image.cols << "), }";
+
+	// The dictionary ends with a new line and is padded with spaces
+	std::string header = dictionary.str();
+	const std::size_t size = NPY_PREAMBLE_SIZE + header.size() + 1;
+	header.append((NPY_ALIGNMENT - size % NPY_ALIGNMENT) % NPY_ALIGNMENT, ' ');
+	header.push_back('\n');
+
+	if (header.size() > std::numeric_limits<uint16_t>::max())
+	{
+		return false;
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	// Version 1.0 of the format, the length of the dictionary is little endian
+	const uint16_t headerSize = uint16_t(header.size());
+	const char preamble[4] = { 1, 0, char(headerSize & 0xFF), char(headerSize >> 8) };
+
+	file.write(NPY_MAGIC, sizeof(NPY_MAGIC));
+	file.write(preamble, sizeof(preamble));
+	file.write(header.data(), std::streamsize(header.size()));
+
+	return WriteFloat32Samples(file, image);
+}
+
+bool SaveTiledHeightfield(const std::string& filename, const cv::Mat& image, const HeightfieldMetadata& metadata, int tileSize)
+{
+	assert(image.data != nullptr);
+	assert(image.type() == CV_32F);
+	assert(tileSize > 0);
+
+	return RawHeightmapControlFunction::save(filename, image, tileSize, HeightfieldMetadataText(metadata));
+}
+
+std::string HeightfieldMetadataText(const HeightfieldMetadata& metadata)
+{
+	std::ostringstream text;
+	text.precision(std::numeric_limits<double>::max_digits10);
+	text << "bounds=" << metadata.topLeft.x << "," << metadata.topLeft.y << "," << metadata.bottomRight.x << "," << metadata.bottomRight.y;
+	text << " seed=" << metadata.seed;
+
+	if (!metadata.parameters.empty())
+	{
+		text << " " << metadata.parameters;
+	}
+
+	return text.str();
+}
@@ -1,50 +1,40 @@
 #include "imagecontrolfunction.h"
 
-#include <algorithm>
-
-double ImageControlFunction::sample(double ri, double rj) const
+double ImageControlFunction::sample(const cv::Mat& image, double ri, double rj)
 {
-	assert(0.0 <= ri && ri <= 1.0);
-	assert(0.0 <= rj && rj <= 1.0);
+	return bi_cubic_sample(image.rows, image.cols, ri, rj, [&image](int i, int j) {
+		return get(image, i, j);
+	});
+}
 
-	ri *= m_image.rows - 1;
-	rj *= m_image.cols - 1;
+void ImageControlFunction::BuildPyramid()
+{
+	m_pyramid.clear();
+	m_pyramid.push_back(m_image);
 
-	// If the coordinates are integer, return directly the value
-	if (nearbyint(ri) == ri && nearbyint(rj) == rj)
+	// Stop when the next level would not have enough pixels to be sampled
+	while (m_pyramid.back().rows > 3 && m_pyramid.back().cols > 3)
 	{
-		return get(int(ri), int(rj));
+		const cv::Mat& previous = m_pyramid.back();
+
+		cv::Mat level;
+		cv::resize(previous, level, cv::Size((previous.cols + 1) / 2, (previous.rows + 1) / 2), 0.0, 0.0, cv::INTER_AREA);
+
+		m_pyramid.push_back(level);
 	}
+}
+
+std::size_t ImageControlFunction::PyramidLevel(double footprint) const
+{
+	// Size of the footprint in pixels of the full resolution image
+	const double footprintPixels = footprint * std::max(m_image.rows - 1, m_image.cols - 1);
 
-	const auto i1 = int(floor(ri));
-	const auto j1 = int(floor(rj));
-
-	// i = {i1 - 1, i1, i1 + 1, i1 + 2}
-	const std::array<int, 4> i = {
-		std::max(i1 - 1, 0),
-		i1,
-		std::min(i1 + 1, m_image.rows - 1),
-		std::min(i1 + 2, m_image.rows - 1)
-	};
-
-	// j = {j1 - 1, j1, j1 + 1, j1 + 2}
-	const std::array<int, 4> j = {
-		std::max(j1 - 1, 0),
-		j1,
-		std::min(j1 + 1, m_image.cols - 1),
-		std::min(j1 + 2, m_image.cols - 1)
-	};
-
-	std::array<std::array<double, 4>, 4> p{};
-	for (int k = 0; k < 4; k++)
+	if (footprintPixels <= 1.0)
 	{
-		for (int l = 0; l < 4; l++)
-		{
-			p[k][l] = get(i[k], j[l]);
-		}
+		return 0;
 	}
 
-	const double interpolation = bi_cubic_interpolate(p, ri - floor(ri), rj - floor(rj));
+	const auto level = std::size_t(floor(log2(footprintPixels)));
 
-	return std::clamp(interpolation, 0.0, 1.0);
+	return std::min(level, m_pyramid.size() - 1);
 }
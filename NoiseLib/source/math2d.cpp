@@ -1,6 +1,7 @@
 #include "math2d.h"
 
 #include <algorithm>
+#include <limits>
 
 Point2D& Point2D::operator+=(const Vec2D& v)
 {
@@ -94,3 +95,20 @@ double distToLineSegment(const Point2D& p, const Segment2D& s, Point2D& c)
 {
 	return distToLineSegment(p, s.a, s.b, c);
 }
+
+double distToRectangle(const Point2D& p, const Point2D& topLeft, const Point2D& bottomRight)
+{
+	const Point2D topRight(bottomRight.x, topLeft.y);
+	const Point2D bottomLeft(topLeft.x, bottomRight.y);
+
+	Point2D c; // Useless point for distToLineSegment
+
+	auto dist = std::numeric_limits<double>::max();
+
+	dist = std::min(dist, distToLineSegment(p, topLeft, topRight, c));
+	dist = std::min(dist, distToLineSegment(p, topRight, bottomRight, c));
+	dist = std::min(dist, distToLineSegment(p, bottomRight, bottomLeft, c));
+	dist = std::min(dist, distToLineSegment(p, bottomLeft, topLeft, c));
+
+	return dist;
+}
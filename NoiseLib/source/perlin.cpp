@@ -33,16 +33,22 @@ const uint8_t HashTable[256] = {
 	 61, 156, 180, 219
 };
 
-// Computes the dot product of the distance and gradient vectors.
-double dotGridGradient(int ix, int iy, double x, double y)
+// Index of the gradient of a grid point
+int gridGradient(int ix, int iy)
 {
 	const int mx = robust_mod(ix, 256);
 	const int my = robust_mod(iy, 256);
 
 	const int index = robust_mod(mx + HashTable[my], 256);
 
+	return HashTable[index] % 8;
+}
+
+// Computes the dot product of the distance and gradient vectors.
+double dotGridGradient(int ix, int iy, double x, double y)
+{
 	// Index of the gradient
-	int g = HashTable[index] % 8;
+	int g = gridGradient(ix, iy);
 
 	// Compute the distance vector
 	double dx = x - (double)ix;
@@ -76,3 +82,47 @@ double Perlin(double x, double y)
 	double ix1 = lerp(u, v, smoother(sx));
 	return lerp(ix0, ix1, smoother(sy));
 }
+
+// Compute Perlin noise and its partial derivatives at coordinates x, y
+double Perlin(double x, double y, double& dx, double& dy)
+{
+	// Determine grid cell coordinates
+	int x0 = int(floor(x));
+	int x1 = x0 + 1;
+	int y0 = int(floor(y));
+	int y1 = y0 + 1;
+
+	// Determine interpolation weights
+	double sx = x - floor(x);
+	double sy = y - floor(y);
+
+	double s = dotGridGradient(x0, y0, x, y);
+	double t = dotGridGradient(x1, y0, x, y);
+	double u = dotGridGradient(x0, y1, x, y);
+	double v = dotGridGradient(x1, y1, x, y);
+
+	// Derivatives of the dot products are the gradients
+	const double* gs = Gradients[gridGradient(x0, y0)];
+	const double* gt = Gradients[gridGradient(x1, y0)];
+	const double* gu = Gradients[gridGradient(x0, y1)];
+	const double* gv = Gradients[gridGradient(x1, y1)];
+
+	const double wx = smoother(sx);
+	const double wy = smoother(sy);
+	const double dwx = smoother_derivative(sx);
+	const double dwy = smoother_derivative(sy);
+
+	// Interpolate between grid point gradients
+	double ix0 = lerp(s, t, wx);
+	double ix1 = lerp(u, v, wx);
+
+	const double ix0dx = lerp(gs[0], gt[0], wx) + (t - s) * dwx;
+	const double ix0dy = lerp(gs[1], gt[1], wx);
+	const double ix1dx = lerp(gu[0], gv[0], wx) + (v - u) * dwx;
+	const double ix1dy = lerp(gu[1], gv[1], wx);
+
+	dx = lerp(ix0dx, ix1dx, wy);
+	dy = lerp(ix0dy, ix1dy, wy) + (ix1 - ix0) * dwy;
+
+	return lerp(ix0, ix1, wy);
+}
@@ -0,0 +1,90 @@
+#include "pointcache.h"
+
+#include <limits>
+#include <map>
+#include <utility>
+
+PointCache::PointCache(int seed, double eps) :
+	m_seed(seed),
+	m_eps(eps),
+	m_points(CACHE_X * CACHE_Y)
+{
+	for (std::atomic<bool>& ready : m_blockReady)
+	{
+		ready.store(false, std::memory_order_relaxed);
+	}
+}
+
+std::shared_ptr<const PointCache> PointCache::shared(int seed, double eps)
+{
+	static std::mutex mutex;
+	static std::map<std::pair<int, double>, std::weak_ptr<const PointCache> > caches;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Forget the caches which are not used by any noise anymore
+	for (auto it = caches.begin(); it != caches.end();)
+	{
+		if (it->second.expired())
+		{
+			it = caches.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	std::weak_ptr<const PointCache>& cache = caches[std::make_pair(seed, eps)];
+	std::shared_ptr<const PointCache> pointCache = cache.lock();
+	if (!pointCache)
+	{
+		pointCache = std::make_shared<const PointCache>(seed, eps);
+		cache = pointCache;
+	}
+
+	return pointCache;
+}
+
+PointCache::RandomGenerator PointCache::randomGenerator(int seed, int i, int j)
+{
+	// TODO: implement a better permutation method
+	const int cellSeed = (541 * i + 79 * j + seed) % std::numeric_limits<int>::max();
+	// Fixed seed for internal consistency
+	return RandomGenerator(cellSeed);
+}
+
+Point2D PointCache::generatePoint(int seed, double eps, int x, int y)
+{
+	RandomGenerator generator = randomGenerator(seed, x, y);
+
+	std::uniform_real_distribution<double> distribution(eps, 1.0 - eps);
+	const double px = distribution(generator);
+	const double py = distribution(generator);
+
+	return { double(x) + px, double(y) + py };
+}
+
+void PointCache::GenerateBlock(int block) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Another thread may have generated the block while this one was waiting
+	if (m_blockReady[block].load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	const int firstI = (block / BLOCKS_Y) * BLOCK_SIZE;
+	const int firstJ = (block % BLOCKS_Y) * BLOCK_SIZE;
+
+	for (int i = firstI; i < firstI + BLOCK_SIZE; i++)
+	{
+		for (int j = firstJ; j < firstJ + BLOCK_SIZE; j++)
+		{
+			m_points[i * CACHE_Y + j] = generatePoint(m_seed, m_eps, i - CACHE_X / 2, j - CACHE_Y / 2);
+		}
+	}
+
+	m_blockReady[block].store(true, std::memory_order_release);
+}
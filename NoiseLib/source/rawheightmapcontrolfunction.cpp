@@ -0,0 +1,209 @@
+#include "rawheightmapcontrolfunction.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "executor.h"
+
+namespace
+{
+	const char RAW_HEIGHTMAP_MAGIC[4] = { 'D', 'R', 'H', 'M' };
+	// Version 2 adds the metadata after the header
+	const uint32_t RAW_HEIGHTMAP_VERSION = 2;
+	const uint32_t RAW_HEIGHTMAP_METADATA_ALIGNMENT = 64;
+
+	std::size_t SampleSize(uint32_t format)
+	{
+		switch (format)
+		{
+		case RawHeightmapHeader::Uint16:
+			return sizeof(uint16_t);
+		case RawHeightmapHeader::Float32:
+			return sizeof(float);
+		default:
+			return 0;
+		}
+	}
+
+	std::size_t DivideRoundUp(std::size_t a, std::size_t b)
+	{
+		return (a + b - 1) / b;
+	}
+
+	template<typename T>
+	bool WriteSamples(std::ofstream& file, const cv::Mat& image, int tileSize)
+	{
+		if (tileSize <= 0)
+		{
+			// A continuous image is written at once
+			if (image.isContinuous())
+			{
+				file.write(reinterpret_cast<const char*>(image.ptr<T>(0)), std::streamsize(image.total() * sizeof(T)));
+
+				return bool(file);
+			}
+
+			for (int i = 0; i < image.rows; i++)
+			{
+				file.write(reinterpret_cast<const char*>(image.ptr<T>(i)), std::streamsize(image.cols * sizeof(T)));
+			}
+
+			return bool(file);
+		}
+
+		// Tiles are consecutive in the file, so a whole row of tiles is gathered then written at once.
+		// Tiles are padded with the last sample of the image.
+		const int tilesPerRow = int(DivideRoundUp(image.cols, tileSize));
+		const std::size_t tileSamples = std::size_t(tileSize) * tileSize;
+		std::vector<T> band(tilesPerRow * tileSamples);
+		for (int ti = 0; ti < image.rows; ti += tileSize)
+		{
+			Executor::global().parallelFor(0, tilesPerRow, [&](int k)
+			{
+				const int tj = k * tileSize;
+				const int copied = std::min(tileSize, image.cols - tj);
+
+				for (int i = 0; i < tileSize; i++)
+				{
+					const T* row = image.ptr<T>(std::min(ti + i, image.rows - 1));
+					T* tileRow = band.data() + k * tileSamples + std::size_t(i) * tileSize;
+
+					std::memcpy(tileRow, row + tj, copied * sizeof(T));
+					std::fill(tileRow + copied, tileRow + tileSize, row[image.cols - 1]);
+				}
+			});
+
+			file.write(reinterpret_cast<const char*>(band.data()), std::streamsize(band.size() * sizeof(T)));
+		}
+
+		return bool(file);
+	}
+}
+
+RawHeightmapControlFunction::RawHeightmapControlFunction(const std::string& filename) :
+	m_file(filename)
+{
+	if (!m_file.isOpen() || m_file.size() < sizeof(RawHeightmapHeader))
+	{
+		return;
+	}
+
+	std::memcpy(&m_header, m_file.data(), sizeof(RawHeightmapHeader));
+
+	// Version 1 files do not have metadata
+	if (m_header.version == 1)
+	{
+		m_header.metadataSize = 0;
+	}
+
+	const bool validHeader = std::memcmp(m_header.magic, RAW_HEIGHTMAP_MAGIC, sizeof(RAW_HEIGHTMAP_MAGIC)) == 0
+		&& m_header.version >= 1 && m_header.version <= RAW_HEIGHTMAP_VERSION
+		&& m_header.rows > 1
+		&& m_header.cols > 1
+		&& SampleSize(m_header.format) > 0
+		&& (m_header.tileRows == 0) == (m_header.tileCols == 0);
+
+	if (!validHeader)
+	{
+		return;
+	}
+
+	std::size_t numberSamples = std::size_t(m_header.rows) * m_header.cols;
+	if (m_header.tileRows > 0)
+	{
+		m_tilesPerRow = DivideRoundUp(m_header.cols, m_header.tileCols);
+		numberSamples = DivideRoundUp(m_header.rows, m_header.tileRows) * m_tilesPerRow * m_header.tileRows * m_header.tileCols;
+	}
+
+	// The file should contain the metadata and all the samples announced in the header
+	const std::size_t samplesOffset = sizeof(RawHeightmapHeader) + m_header.metadataSize;
+	if (m_file.size() < samplesOffset + numberSamples * SampleSize(m_header.format))
+	{
+		return;
+	}
+
+	// The metadata is padded with null characters
+	const char* metadata = reinterpret_cast<const char*>(m_file.data() + sizeof(RawHeightmapHeader));
+	m_metadata.assign(metadata, std::find(metadata, metadata + m_header.metadataSize, '\0'));
+
+	if (m_header.format == RawHeightmapHeader::Float32 && m_header.maximum > m_header.minimum)
+	{
+		m_scale = 1.0 / (double(m_header.maximum) - double(m_header.minimum));
+	}
+
+	m_samples = m_file.data() + samplesOffset;
+}
+
+double RawHeightmapControlFunction::sample(double ri, double rj) const
+{
+	assert(isOpen());
+
+	return bi_cubic_sample(rows(), cols(), ri, rj, [this](int i, int j) {
+		return get(i, j);
+	});
+}
+
+bool RawHeightmapControlFunction::save(const std::string& filename, const cv::Mat& image, int tileSize, const std::string& metadata)
+{
+	assert(image.data != nullptr);
+	assert(image.channels() == 1);
+
+	RawHeightmapHeader header{};
+	std::memcpy(header.magic, RAW_HEIGHTMAP_MAGIC, sizeof(RAW_HEIGHTMAP_MAGIC));
+	header.version = RAW_HEIGHTMAP_VERSION;
+	header.rows = uint32_t(image.rows);
+	header.cols = uint32_t(image.cols);
+	header.tileRows = uint32_t(std::max(tileSize, 0));
+	header.tileCols = uint32_t(std::max(tileSize, 0));
+	header.metadataSize = uint32_t(DivideRoundUp(metadata.size(), RAW_HEIGHTMAP_METADATA_ALIGNMENT) * RAW_HEIGHTMAP_METADATA_ALIGNMENT);
+
+	cv::Mat samples;
+	switch (image.depth())
+	{
+	case CV_8U:
+		// Same normalization as ImageControlFunction: 255 is remapped to 65535
+		header.format = RawHeightmapHeader::Uint16;
+		image.convertTo(samples, CV_16U, double(std::numeric_limits<uint16_t>::max()) / std::numeric_limits<uint8_t>::max());
+		break;
+
+	case CV_16U:
+		header.format = RawHeightmapHeader::Uint16;
+		samples = image;
+		break;
+
+	case CV_32F:
+	{
+		double minimum, maximum;
+		cv::minMaxLoc(image, &minimum, &maximum);
+
+		header.format = RawHeightmapHeader::Float32;
+		header.minimum = float(minimum);
+		header.maximum = float(maximum);
+		samples = image;
+		break;
+	}
+
+	default:
+		return false;
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<char> paddedMetadata(header.metadataSize, '\0');
+	std::copy(metadata.begin(), metadata.end(), paddedMetadata.begin());
+	file.write(paddedMetadata.data(), std::streamsize(paddedMetadata.size()));
+
+	if (header.format == RawHeightmapHeader::Uint16)
+	{
+		return WriteSamples<uint16_t>(file, samples, tileSize);
+	}
+
+	return WriteSamples<float>(file, samples, tileSize);
+}
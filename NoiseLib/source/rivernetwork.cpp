@@ -0,0 +1,72 @@
+#include "rivernetwork.h"
+
+#include <algorithm>
+
+int RiverNetwork::addLevel(int resolution, int segmentsPerCell, int minX, int minY, int maxX, int maxY)
+{
+	assert(resolution > 0);
+	assert(segmentsPerCell > 0);
+	assert(minX <= maxX && minY <= maxY);
+
+	LevelGrid grid;
+	grid.resolution = resolution;
+	grid.segmentsPerCell = segmentsPerCell;
+	grid.minX = minX;
+	grid.minY = minY;
+	grid.width = maxX - minX + 1;
+	grid.height = maxY - minY + 1;
+	grid.firstPoint = int(m_points.size());
+	grid.firstNode = int(m_nodes.size());
+	grid.firstEdge = int(m_edges.size());
+
+	m_levels.push_back(grid);
+
+	const int cells = grid.width * grid.height;
+	m_points.resize(m_points.size() + cells);
+	m_nodes.resize(m_nodes.size() + cells * (segmentsPerCell + 1));
+
+	// Edges only depend on the layout of the level, nodes are set later
+	m_edges.reserve(m_edges.size() + cells * segmentsPerCell);
+	for (int cell = 0; cell < cells; cell++)
+	{
+		const int firstNode = grid.firstNode + cell * (segmentsPerCell + 1);
+		for (int d = 0; d < segmentsPerCell; d++)
+		{
+			m_edges.push_back({ firstNode + d, firstNode + d + 1, levels() });
+		}
+	}
+
+	return levels();
+}
+
+int RiverNetwork::addLevel(const RiverNetwork& source, int level, int minX, int minY, int maxX, int maxY)
+{
+	assert(level == levels() + 1);
+	assert(source.containsCell(level, minX, minY) && source.containsCell(level, maxX, maxY));
+
+	const LevelGrid& sourceGrid = source.Level(level);
+	addLevel(sourceGrid.resolution, sourceGrid.segmentsPerCell, minX, minY, maxX, maxY);
+
+	const LevelGrid& grid = Level(level);
+	const int nodesPerCell = grid.segmentsPerCell + 1;
+
+	// Cells of a row are contiguous in both networks
+	for (int y = minY; y <= maxY; y++)
+	{
+		const int sourceCell = source.CellIndex(sourceGrid, minX, y);
+		const int cell = CellIndex(grid, minX, y);
+
+		std::copy_n(source.m_points.begin() + sourceGrid.firstPoint + sourceCell, grid.width, m_points.begin() + grid.firstPoint + cell);
+		std::copy_n(source.m_nodes.begin() + sourceGrid.firstNode + sourceCell * nodesPerCell, grid.width * nodesPerCell, m_nodes.begin() + grid.firstNode + cell * nodesPerCell);
+	}
+
+	return level;
+}
+
+bool RiverNetwork::containsCell(int level, int x, int y) const
+{
+	const LevelGrid& grid = Level(level);
+
+	return x >= grid.minX && x < grid.minX + grid.width
+		&& y >= grid.minY && y < grid.minY + grid.height;
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "noise.h"
+#include "planecontrolfunction.h"
+
+// Distances are computed with the same functions, only rounding differs
+const double TOLERANCE = 1e-12;
+
+// Distance to the nearest segment of the whole network
+double NearestSegmentDistance(const RiverNetwork& network, const Point2D& point)
+{
+	double distance = std::numeric_limits<double>::max();
+	for (std::size_t edge = 0; edge < network.edges().size(); edge++)
+	{
+		Point2D c;
+		distance = std::min(distance, distToLineSegment(point, ProjectionZ(network.segment(int(edge))), c));
+	}
+
+	return distance;
+}
+
+// Compare evaluateDistanceTile with evaluateTerrain in the displayDistance mode for every pixel of a tile
+// evaluateTerrain only searches the segments of the neighboring cells of each level, so it may miss the nearest segment:
+// the tile may then be nearer, but only if it is the distance to the nearest segment of the whole network.
+// Return the number of pixels which are wrong
+int CompareDistanceTile(int resolution, int seed, int width, int height)
+{
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(1.5, 1.5);
+	const Point2D controlFunctionTopLeft(0.0, 0.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+
+	std::unique_ptr<PlaneControlFunction> controlFunction(std::make_unique<PlaneControlFunction>());
+	const Noise<PlaneControlFunction> noise(std::move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, 0.25, resolution, 0.075, 3, 0.5, 0.0, false, false, false, false, true);
+
+	const RiverNetwork network = noise.bakeTerrainNetwork(noiseTopLeft, noiseBottomRight);
+	const std::vector<std::vector<double> > tile = noise.evaluateDistanceTile(network, noiseTopLeft, noiseBottomRight, width, height);
+
+	int failures = 0;
+	int nearer = 0;
+	double maxError = 0.0;
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			const Point2D point(remap(double(j), 0.0, double(width), noiseTopLeft.x, noiseBottomRight.x), remap(double(i), 0.0, double(height), noiseTopLeft.y, noiseBottomRight.y));
+			const double expected = noise.evaluateTerrain(point.x, point.y, network);
+
+			if (std::abs(tile[i][j] - expected) <= TOLERANCE)
+			{
+				continue;
+			}
+
+			if (tile[i][j] < expected && std::abs(tile[i][j] - NearestSegmentDistance(network, point)) <= TOLERANCE)
+			{
+				nearer++;
+				continue;
+			}
+
+			failures++;
+			maxError = std::max(maxError, std::abs(tile[i][j] - expected));
+		}
+	}
+
+	std::cout << "Resolution " << resolution << ", seed " << seed << ": " << failures << " wrong pixels (maximum error " << maxError << "), "
+		<< nearer << " pixels nearer to a segment outside of the neighborhood of evaluateTerrain" << std::endl;
+
+	return failures;
+}
+
+int main()
+{
+	int failures = 0;
+	for (int resolution = 1; resolution <= 5; resolution++)
+	{
+		for (int seed = 0; seed < 3; seed++)
+		{
+			failures += CompareDistanceTile(resolution, seed, 96, 96);
+		}
+	}
+
+	// A tile which is not square, smaller than the cells of the network
+	failures += CompareDistanceTile(1, 7, 40, 24);
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
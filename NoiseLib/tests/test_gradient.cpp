@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "noise.h"
+#include "planecontrolfunction.h"
+
+// Step of the central differences, and largest difference with the analytic gradient
+const double STEP = 1e-6;
+const double TOLERANCE = 1e-6;
+
+// Compare the gradient of evaluateTerrainChannels with central differences of the elevation on a grid of points
+// Return the number of points whose gradient is wrong
+int CompareGradient(int resolution, int seed, int samples)
+{
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(1.5, 1.5);
+	const Point2D controlFunctionTopLeft(0.0, 0.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+
+	std::unique_ptr<PlaneControlFunction> controlFunction(std::make_unique<PlaneControlFunction>());
+	const Noise<PlaneControlFunction> noise(std::move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, 0.25, resolution, 0.075, 3, 0.5, 0.05);
+
+	const auto elevation = [&](double x, double y)
+	{
+		return noise.evaluateTerrainChannels(x, y, Noise<PlaneControlFunction>::ChannelElevation).elevation;
+	};
+
+	int failures = 0;
+	double maxError = 0.0;
+	for (int i = 0; i < samples; i++)
+	{
+		for (int j = 0; j < samples; j++)
+		{
+			const double x = remap(j + 0.5, 0.0, double(samples), noiseTopLeft.x, noiseBottomRight.x);
+			const double y = remap(i + 0.5, 0.0, double(samples), noiseTopLeft.y, noiseBottomRight.y);
+
+			const Noise<PlaneControlFunction>::Channels channels = noise.evaluateTerrainChannels(x, y, Noise<PlaneControlFunction>::ChannelElevation | Noise<PlaneControlFunction>::ChannelGradient);
+			const double dx = (elevation(x + STEP, y) - elevation(x - STEP, y)) / (2.0 * STEP);
+			const double dy = (elevation(x, y + STEP) - elevation(x, y - STEP)) / (2.0 * STEP);
+
+			const double error = std::max(std::abs(channels.gradient.x - dx), std::abs(channels.gradient.y - dy));
+			maxError = std::max(maxError, error);
+			if (error > TOLERANCE)
+			{
+				failures++;
+			}
+
+			// The elevation is the same with and without the gradient
+			if (channels.elevation != elevation(x, y))
+			{
+				failures++;
+			}
+		}
+	}
+
+	std::cout << "Resolution " << resolution << ", seed " << seed << ": " << failures << " wrong points (maximum error " << maxError << ")" << std::endl;
+
+	return failures;
+}
+
+int main()
+{
+	int failures = 0;
+	for (int resolution = 1; resolution <= 4; resolution++)
+	{
+		for (int seed = 0; seed < 3; seed++)
+		{
+			failures += CompareGradient(resolution, seed, 16);
+		}
+	}
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
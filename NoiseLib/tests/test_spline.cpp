@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "spline.h"
+
+// Tolerance of SubdivideCatmullRomSplineBatch, relative to the length of the spline
+const double TOLERANCE = 1e-14;
+
+// Length of the polyline p0 p1 p2 p3, which is the last knot of the chordal spline
+template <typename Point>
+double ChordalLength(const Point& p0, const Point& p1, const Point& p2, const Point& p3)
+{
+	return dist(p0, p1) + dist(p1, p2) + dist(p2, p3);
+}
+
+// Compare the batched subdivision in N points with N calls to the scalar subdivision
+// Return the number of points farther than the tolerance
+template <typename Point, size_t N>
+int CompareSubdivision(const Point& p0, const Point& p1, const Point& p2, const Point& p3, double& maxError)
+{
+	const std::array<Point, N> batch = SubdivideCatmullRomSplineBatch<Point, N>(p0, p1, p2, p3);
+	const double length = ChordalLength(p0, p1, p2, p3);
+
+	int failures = 0;
+	for (size_t n = 0; n < N; n++)
+	{
+		const Point scalar = SubdivideCatmullRomSpline(p0, p1, p2, p3, double(n + 1) / (N + 1));
+		const double error = dist(batch[n], scalar) / length;
+
+		maxError = std::max(maxError, error);
+		if (error > TOLERANCE)
+		{
+			failures++;
+		}
+	}
+
+	return failures;
+}
+
+// Compare the subdivisions in 1 to 5 points of a set of control points
+template <typename Point>
+int CompareSubdivisions(const std::vector<std::array<Point, 4> >& splines, const char* name)
+{
+	int failures = 0;
+	double maxError = 0.0;
+	for (const std::array<Point, 4>& p : splines)
+	{
+		failures += CompareSubdivision<Point, 1>(p[0], p[1], p[2], p[3], maxError);
+		failures += CompareSubdivision<Point, 2>(p[0], p[1], p[2], p[3], maxError);
+		failures += CompareSubdivision<Point, 3>(p[0], p[1], p[2], p[3], maxError);
+		failures += CompareSubdivision<Point, 4>(p[0], p[1], p[2], p[3], maxError);
+		failures += CompareSubdivision<Point, 5>(p[0], p[1], p[2], p[3], maxError);
+	}
+
+	std::cout << name << ": " << splines.size() << " splines, maximum relative error " << maxError << ", " << failures << " failures" << std::endl;
+
+	return failures;
+}
+
+int main()
+{
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<double> coordinate(-1.0, 1.0);
+
+	// Hand-picked splines: straight line, sharp turns, very unequal chords and large coordinates
+	std::vector<std::array<Point2D, 4> > splines2D = {
+		{ Point2D(0.0, 0.0), Point2D(1.0, 0.0), Point2D(2.0, 0.0), Point2D(3.0, 0.0) },
+		{ Point2D(0.0, 0.0), Point2D(1.0, 0.0), Point2D(1.0, 1.0), Point2D(0.0, 1.0) },
+		{ Point2D(0.0, 0.0), Point2D(1e-3, 0.0), Point2D(1.0, 1.0), Point2D(1.0, 1.001) },
+		{ Point2D(1e4, 1e4), Point2D(1e4 + 0.5, 1e4), Point2D(1e4 + 0.5, 1e4 + 0.25), Point2D(1e4 - 3.0, 1e4 + 2.0) },
+	};
+	std::vector<std::array<Point3D, 4> > splines3D = {
+		{ Point3D(0.0, 0.0, 0.0), Point3D(1.0, 0.0, 0.5), Point3D(2.0, 0.0, 0.25), Point3D(3.0, 0.0, 1.0) },
+		{ Point3D(0.0, 0.0, 0.0), Point3D(1.0, 0.0, 0.0), Point3D(1.0, 1.0, 1.0), Point3D(0.0, 1.0, 0.0) },
+	};
+
+	// Random splines
+	for (int i = 0; i < 10000; i++)
+	{
+		splines2D.push_back({
+			Point2D(coordinate(generator), coordinate(generator)),
+			Point2D(coordinate(generator), coordinate(generator)),
+			Point2D(coordinate(generator), coordinate(generator)),
+			Point2D(coordinate(generator), coordinate(generator))
+		});
+		splines3D.push_back({
+			Point3D(coordinate(generator), coordinate(generator), coordinate(generator)),
+			Point3D(coordinate(generator), coordinate(generator), coordinate(generator)),
+			Point3D(coordinate(generator), coordinate(generator), coordinate(generator)),
+			Point3D(coordinate(generator), coordinate(generator), coordinate(generator))
+		});
+	}
+
+	int failures = 0;
+	failures += CompareSubdivisions(splines2D, "2D");
+	failures += CompareSubdivisions(splines3D, "3D");
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
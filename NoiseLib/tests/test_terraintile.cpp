@@ -0,0 +1,59 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "noise.h"
+#include "planecontrolfunction.h"
+
+// Compare evaluateTerrainTile with evaluateTerrain for every pixel of a tile
+// Primitives reach the pixels in the same order as in the arrays of the gather path, so the values must be identical, not only close.
+// Return the number of pixels which are different
+int CompareTerrainTile(int resolution, int seed, int width, int height)
+{
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(1.5, 1.5);
+	const Point2D controlFunctionTopLeft(0.0, 0.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+
+	std::unique_ptr<PlaneControlFunction> controlFunction(std::make_unique<PlaneControlFunction>());
+	const Noise<PlaneControlFunction> noise(std::move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, 0.25, resolution, 0.075, 3, 0.5, 0.05);
+
+	const RiverNetwork network = noise.bakeTerrainNetwork(noiseTopLeft, noiseBottomRight);
+	const std::vector<std::vector<double> > tile = noise.evaluateTerrainTile(network, noiseTopLeft, noiseBottomRight, width, height);
+
+	int failures = 0;
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			const Point2D point(remap(double(j), 0.0, double(width), noiseTopLeft.x, noiseBottomRight.x), remap(double(i), 0.0, double(height), noiseTopLeft.y, noiseBottomRight.y));
+
+			if (tile[i][j] != noise.evaluateTerrain(point.x, point.y, network))
+			{
+				failures++;
+			}
+		}
+	}
+
+	std::cout << "Resolution " << resolution << ", seed " << seed << ": " << failures << " different pixels" << std::endl;
+
+	return failures;
+}
+
+int main()
+{
+	int failures = 0;
+	for (int resolution = 1; resolution <= 5; resolution++)
+	{
+		for (int seed = 0; seed < 3; seed++)
+		{
+			failures += CompareTerrainTile(resolution, seed, 48, 48);
+		}
+	}
+
+	// A tile which is not square
+	failures += CompareTerrainTile(2, 7, 40, 24);
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}